@@ -23,7 +23,7 @@ if [ $? != 0 ]; then
 fi
 
 echo "---------- Running unit-tests -------------"
-platformio test -e unit_test
+platformio test -e unit_test -e unit_test_multiphase
 if [ $? != 0 ]; then
         exit 1;
 fi
@@ -15,6 +15,7 @@ LOG_MODULE_REGISTER(bat_charger, CONFIG_BAT_LOG_LEVEL);
 
 #include <math.h>       // for fabs function
 #include <stdio.h>
+#include <string.h>
 
 #include "board.h"
 #include "helper.h"
@@ -30,6 +31,282 @@ extern LoadOutput load;
 #define DISCHARGE_CURRENT_MAX DT_PROP(DT_PATH(pcb), dcdc_current_max)
 #endif
 
+// battery is considered at rest (i.e. OCV valid) below this current (A) ...
+#define SOC_REST_CURRENT 0.2F
+
+// ... for this period of time (s)
+#define SOC_REST_TIME (10 * 60)
+
+// time constant (s) of the low-pass filter for OCV-based SOC correction at rest
+#define SOC_OCV_FILTER_TIME 100
+
+/*
+ * Cell-level OCV-SOC tables (mV) at 25°C for SOC from 0% to 100% in equidistant steps
+ */
+typedef struct {
+    uint16_t mv[OCV_TABLE_POINTS];
+} OcvCellTable;
+
+static constexpr OcvCellTable ocv_cell_flooded = {{
+    1900, 1922, 1943, 1963, 1983, 2003, 2023, 2043, 2063, 2082, 2100
+}};
+
+static constexpr OcvCellTable ocv_cell_vrla = {{
+    1900, 1927, 1953, 1978, 2003, 2028, 2053, 2078, 2102, 2126, 2150
+}};
+
+// very flat curve between 30% and 90%
+static constexpr OcvCellTable ocv_cell_lfp = {{
+    3000, 3200, 3250, 3275, 3290, 3300, 3305, 3315, 3330, 3340, 3400
+}};
+
+static constexpr OcvCellTable ocv_cell_nmc = {{
+    3000, 3450, 3550, 3610, 3650, 3700, 3760, 3830, 3910, 3990, 4150
+}};
+
+static constexpr OcvCellTable ocv_cell_nmc_hv = {{
+    3000, 3450, 3560, 3620, 3670, 3730, 3800, 3880, 3970, 4080, 4300
+}};
+
+/**
+ * Generates the cold variant of an OCV table based on the temperature coefficient of the cell
+ * open circuit voltage (uV/K)
+ */
+static constexpr OcvCellTable ocv_cell_table_cold(const OcvCellTable &table, int coeff_uv_k)
+{
+    OcvCellTable cold = {};
+    for (int i = 0; i < OCV_TABLE_POINTS; i++) {
+        cold.mv[i] = table.mv[i] + coeff_uv_k * (OCV_TABLE_TEMP_COLD - 25) / 1000;
+    }
+    return cold;
+}
+
+static constexpr bool ocv_cell_table_valid(const OcvCellTable &table)
+{
+    for (int i = 1; i < OCV_TABLE_POINTS; i++) {
+        if (table.mv[i] <= table.mv[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static constexpr OcvCellTable ocv_cell_flooded_cold = ocv_cell_table_cold(ocv_cell_flooded, 200);
+static constexpr OcvCellTable ocv_cell_vrla_cold = ocv_cell_table_cold(ocv_cell_vrla, 200);
+static constexpr OcvCellTable ocv_cell_lfp_cold = ocv_cell_table_cold(ocv_cell_lfp, -100);
+static constexpr OcvCellTable ocv_cell_nmc_cold = ocv_cell_table_cold(ocv_cell_nmc, -100);
+static constexpr OcvCellTable ocv_cell_nmc_hv_cold = ocv_cell_table_cold(ocv_cell_nmc_hv, -100);
+
+static_assert(ocv_cell_table_valid(ocv_cell_flooded) && ocv_cell_table_valid(ocv_cell_vrla) &&
+    ocv_cell_table_valid(ocv_cell_lfp) && ocv_cell_table_valid(ocv_cell_nmc) &&
+    ocv_cell_table_valid(ocv_cell_nmc_hv), "OCV tables must be strictly increasing");
+
+static void ocv_table_install(BatConf *bat, const OcvCellTable &table,
+    const OcvCellTable &table_cold, int num_cells)
+{
+    for (int i = 0; i < OCV_TABLE_POINTS; i++) {
+        bat->ocv_points[i] = 0.001F * static_cast<float>(num_cells * table.mv[i]);
+        bat->ocv_points_cold[i] = 0.001F * static_cast<float>(num_cells * table_cold.mv[i]);
+    }
+    bat->ocv_empty = bat->ocv_points[0];
+    bat->ocv_full = bat->ocv_points[OCV_TABLE_POINTS - 1];
+}
+
+static bool ocv_table_valid(const float *points)
+{
+    for (int i = 1; i < OCV_TABLE_POINTS; i++) {
+        if (points[i] <= points[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// weight of the 25°C table for interpolation with the cold variant
+static float ocv_table_weight(float temperature)
+{
+    float w = (temperature - OCV_TABLE_TEMP_COLD) / (25.0F - OCV_TABLE_TEMP_COLD);
+    if (w > 1.0F) {
+        return 1.0F;
+    }
+    else if (w < 0.0F) {
+        return 0.0F;
+    }
+    return w;
+}
+
+static inline float ocv_point(const BatConf *bat, int i, float w)
+{
+    return bat->ocv_points_cold[i] + w * (bat->ocv_points[i] - bat->ocv_points_cold[i]);
+}
+
+float ocv_soc_lookup(const BatConf *bat, float voltage, float temperature)
+{
+    float w = ocv_table_weight(temperature);
+
+    if (voltage <= ocv_point(bat, 0, w)) {
+        return 0.0F;
+    }
+    else if (voltage >= ocv_point(bat, OCV_TABLE_POINTS - 1, w)) {
+        return 1.0F;
+    }
+
+    // find segment with point[low] <= voltage < point[high]
+    int low = 0;
+    int high = OCV_TABLE_POINTS - 1;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (voltage < ocv_point(bat, mid, w)) {
+            high = mid;
+        }
+        else {
+            low = mid;
+        }
+    }
+
+    float v_low = ocv_point(bat, low, w);
+    float v_high = ocv_point(bat, high, w);
+
+    return (static_cast<float>(low) + (voltage - v_low) / (v_high - v_low)) /
+        (OCV_TABLE_POINTS - 1);
+}
+
+float ocv_lookup(const BatConf *bat, float soc, float temperature)
+{
+    float w = ocv_table_weight(temperature);
+
+    if (soc <= 0.0F) {
+        return ocv_point(bat, 0, w);
+    }
+    else if (soc >= 1.0F) {
+        return ocv_point(bat, OCV_TABLE_POINTS - 1, w);
+    }
+
+    float pos = soc * (OCV_TABLE_POINTS - 1);
+    int i = static_cast<int>(pos);
+    float v_low = ocv_point(bat, i, w);
+
+    return v_low + (pos - static_cast<float>(i)) * (ocv_point(bat, i + 1, w) - v_low);
+}
+
+void ocv_table_at(const BatConf *bat, float temperature, float *points)
+{
+    float w = ocv_table_weight(temperature);
+
+    for (int i = 0; i < OCV_TABLE_POINTS; i++) {
+        points[i] = ocv_point(bat, i, w);
+    }
+}
+
+static bool trickle_enabled(const Charger *charger, const BatConf *bat_conf)
+{
+    return bat_conf->trickle_enabled;
+}
+
+static bool equalization_due(const Charger *charger, const BatConf *bat_conf)
+{
+    return bat_conf->equalization_enabled && (
+        (uptime() - charger->time_last_equalization) / (24*60*60)
+        >= bat_conf->equalization_trigger_days ||
+        charger->num_deep_discharges - charger->deep_dis_last_equalization
+        >= bat_conf->equalization_trigger_deep_cycles);
+}
+
+const ChargeProfile charge_profile_lead_acid = {
+    {
+        // CHG_STATE_IDLE (not used)
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+        // CHG_STATE_BULK
+        {
+            &BatConf::topping_voltage, &BatConf::charge_current_max, NULL, NULL,
+            CHG_EXIT_TARGET_VOLTAGE,
+            CHG_STATE_TOPPING, CHG_STATE_BULK, 0
+        },
+        // CHG_STATE_TOPPING (absorption)
+        {
+            &BatConf::topping_voltage, &BatConf::charge_current_max, &BatConf::topping_duration,
+            NULL,
+            CHG_EXIT_CUTOFF_CURRENT | CHG_EXIT_TIME_AT_TARGET | CHG_EXIT_FULL,
+            CHG_STATE_EQUALIZATION, CHG_STATE_BULK, 8 * 60 * 60
+        },
+        // CHG_STATE_TRICKLE (float, kept until battery is discharged again)
+        {
+            &BatConf::trickle_voltage, &BatConf::charge_current_max,
+            &BatConf::trickle_recharge_time, &trickle_enabled,
+            CHG_EXIT_VOLTAGE_LOST,
+            CHG_STATE_IDLE, CHG_STATE_BULK, 0
+        },
+        // CHG_STATE_EQUALIZATION
+        {
+            &BatConf::equalization_voltage, &BatConf::equalization_current_limit,
+            &BatConf::equalization_duration, &equalization_due,
+            CHG_EXIT_DURATION,
+            CHG_STATE_TRICKLE, CHG_STATE_BULK, 0
+        },
+    },
+    NULL, 0
+};
+
+// reduced charge current at low temperatures to prevent lithium plating
+static const ChargeDerating charge_derating_lithium[] = {
+    { 0.0F, 0.2F },
+    { 10.0F, 1.0F },
+    { 40.0F, 1.0F },
+    { 50.0F, 0.5F },
+};
+
+const ChargeProfile charge_profile_lithium = {
+    {
+        // CHG_STATE_IDLE (not used)
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+        // CHG_STATE_BULK (CC)
+        {
+            &BatConf::topping_voltage, &BatConf::charge_current_max, NULL, NULL,
+            CHG_EXIT_TARGET_VOLTAGE,
+            CHG_STATE_TOPPING, CHG_STATE_BULK, 0
+        },
+        // CHG_STATE_TOPPING (CV with current taper until cut-off)
+        {
+            &BatConf::topping_voltage, &BatConf::charge_current_max, &BatConf::topping_duration,
+            NULL,
+            CHG_EXIT_CUTOFF_CURRENT | CHG_EXIT_TIME_AT_TARGET | CHG_EXIT_FULL,
+            CHG_STATE_IDLE, CHG_STATE_BULK, 8 * 60 * 60
+        },
+        // CHG_STATE_TRICKLE (not used: no float charging for lithium-ion batteries)
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+        // CHG_STATE_EQUALIZATION (not used)
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+    },
+    charge_derating_lithium,
+    sizeof(charge_derating_lithium) / sizeof(ChargeDerating)
+};
+
+float charge_current_derating(const ChargeProfile *profile, float temperature)
+{
+    if (profile == NULL || profile->derating == NULL || profile->num_derating_points <= 0) {
+        return 1.0F;
+    }
+
+    const ChargeDerating *points = profile->derating;
+    int last = profile->num_derating_points - 1;
+
+    if (temperature <= points[0].temperature) {
+        return points[0].factor;
+    }
+    else if (temperature >= points[last].temperature) {
+        return points[last].factor;
+    }
+
+    int i = 1;
+    while (temperature > points[i].temperature) {
+        i++;
+    }
+
+    return points[i - 1].factor + (points[i].factor - points[i - 1].factor) *
+        (temperature - points[i - 1].temperature) /
+        (points[i].temperature - points[i - 1].temperature);
+}
+
 void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capacity)
 {
     bat->nominal_capacity = nominal_capacity;
@@ -63,12 +340,19 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             bat->internal_resistance     = static_cast<float>(num_cells) * (1.95F - 1.80F) /
                 DISCHARGE_CURRENT_MAX;
 
+            // slow diffusion processes in lead-acid batteries
+            bat->rc_resistance           = bat->internal_resistance;
+            bat->rc_time_constant        = 120;
+
             bat->voltage_absolute_min    = static_cast<float>(num_cells) * 1.6F;
 
             // Voltages during idle (no charging/discharging current)
-            bat->ocv_full                = static_cast<float>(num_cells) *
-                ((type == BAT_TYPE_FLOODED) ? 2.10F : 2.15F);
-            bat->ocv_empty               = static_cast<float>(num_cells) * 1.90F;
+            if (type == BAT_TYPE_FLOODED) {
+                ocv_table_install(bat, ocv_cell_flooded, ocv_cell_flooded_cold, num_cells);
+            }
+            else {
+                ocv_table_install(bat, ocv_cell_vrla, ocv_cell_vrla_cold, num_cells);
+            }
 
             // https://batteryuniversity.com/learn/article/charging_the_lead_acid_battery
             bat->topping_current_cutoff  = bat->nominal_capacity * 0.04F;  // 3-5 % of C/1
@@ -91,6 +375,8 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             bat->equalization_trigger_deep_cycles = 10;
 
             bat->temperature_compensation = -0.003F;     // -3 mV/°C/cell
+
+            bat->charge_profile = &charge_profile_lead_acid;
             break;
 
         case BAT_TYPE_LFP:
@@ -104,11 +390,11 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             // 5% voltage drop at max current
             bat->internal_resistance    = bat->voltage_load_disconnect * 0.05F /
                                           DISCHARGE_CURRENT_MAX;
+            bat->rc_resistance          = bat->internal_resistance * 0.5F;
+            bat->rc_time_constant       = 60;
             bat->voltage_absolute_min   = static_cast<float>(num_cells) * 2.0F;
 
-            // will give really nonlinear SOC calculation because of flat OCV of LFP cells...
-            bat->ocv_full   = static_cast<float>(num_cells) * 3.4F;
-            bat->ocv_empty  = static_cast<float>(num_cells) * 3.0F;
+            ocv_table_install(bat, ocv_cell_lfp, ocv_cell_lfp_cold, num_cells);
 
             // C/10 cut-off at end of CV phase by default
             bat->topping_current_cutoff = bat->nominal_capacity / 10;
@@ -117,6 +403,8 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             bat->equalization_enabled = false;
             bat->temperature_compensation = 0;
             bat->charge_temp_min = 0;
+
+            bat->charge_profile = &charge_profile_lithium;
             break;
 
         case BAT_TYPE_NMC:
@@ -133,11 +421,17 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             // 5% voltage drop at max current
             bat->internal_resistance     = bat->voltage_load_disconnect * 0.05F /
                 DISCHARGE_CURRENT_MAX;
+            bat->rc_resistance           = bat->internal_resistance * 0.5F;
+            bat->rc_time_constant        = 40;
 
             bat->voltage_absolute_min    = static_cast<float>(num_cells) * 2.5F;
 
-            bat->ocv_full                = static_cast<float>(num_cells) * 4.0F;
-            bat->ocv_empty               = static_cast<float>(num_cells) * 3.0F;
+            if (type == BAT_TYPE_NMC_HV) {
+                ocv_table_install(bat, ocv_cell_nmc_hv, ocv_cell_nmc_hv_cold, num_cells);
+            }
+            else {
+                ocv_table_install(bat, ocv_cell_nmc, ocv_cell_nmc_cold, num_cells);
+            }
 
             // C/10 cut-off at end of CV phase by default
             bat->topping_current_cutoff  = bat->nominal_capacity / 10;
@@ -146,6 +440,8 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             bat->equalization_enabled = false;
             bat->temperature_compensation = 0;
             bat->charge_temp_min = 0;
+
+            bat->charge_profile = &charge_profile_lithium;
             break;
 
         case BAT_TYPE_CUSTOM:
@@ -166,6 +462,8 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
 
             bat->internal_resistance = 0.001F *
                 static_cast<float>(CONFIG_BAT_NUM_CELLS * CONFIG_CELL_INTERNAL_RESISTANCE_MOHM);
+            bat->rc_resistance = bat->internal_resistance * 0.5F;
+            bat->rc_time_constant = 60;
 
             bat->voltage_absolute_min = 0.001F *
                 static_cast<float>(CONFIG_BAT_NUM_CELLS * CONFIG_CELL_ABS_MIN_VOLTAGE_MV);
@@ -176,6 +474,13 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             bat->ocv_empty = 0.001F *
                 static_cast<float>(CONFIG_BAT_NUM_CELLS * CONFIG_CELL_OCV_EMPTY_MV);
 
+            // linear OCV curve by default, can be changed via ThingSet
+            for (int i = 0; i < OCV_TABLE_POINTS; i++) {
+                bat->ocv_points[i] = bat->ocv_empty +
+                    (bat->ocv_full - bat->ocv_empty) * i / (OCV_TABLE_POINTS - 1);
+                bat->ocv_points_cold[i] = bat->ocv_points[i];
+            }
+
             // https://batteryuniversity.com/learn/article/charging_the_lead_acid_battery
             bat->topping_current_cutoff = bat->nominal_capacity * 0.04F;  // 3-5 % of C/1
 
@@ -199,6 +504,9 @@ void battery_conf_init(BatConf *bat, int type, int num_cells, float nominal_capa
             bat->charge_temp_min    = CONFIG_BAT_CHARGE_TEMP_MIN;
             bat->discharge_temp_max = CONFIG_BAT_DISCHARGE_TEMP_MAX;
             bat->discharge_temp_min = CONFIG_BAT_DISCHARGE_TEMP_MIN;
+
+            // generic profile, stages are enabled/disabled via trickle and equalization settings
+            bat->charge_profile = &charge_profile_lead_acid;
 #else
             LOG_ERR("Custom battery type cannot be initialized at runtime.");
 #endif
@@ -241,7 +549,9 @@ bool battery_conf_check(BatConf *bat_conf)
         bat_conf->topping_current_cutoff > 0.01 &&
         (bat_conf->trickle_enabled == false ||
             (bat_conf->trickle_voltage < bat_conf->topping_voltage &&
-             bat_conf->trickle_voltage > bat_conf->voltage_load_disconnect))
+             bat_conf->trickle_voltage > bat_conf->voltage_load_disconnect)) &&
+        ocv_table_valid(bat_conf->ocv_points) &&
+        ocv_table_valid(bat_conf->ocv_points_cold)
     );
 }
 
@@ -267,14 +577,30 @@ void battery_conf_overwrite(BatConf *source, BatConf *destination, Charger *char
     destination->discharge_temp_min             = source->discharge_temp_min;
     destination->temperature_compensation       = source->temperature_compensation;
     destination->internal_resistance            = source->internal_resistance;
+    destination->rc_resistance                  = source->rc_resistance;
+    destination->rc_time_constant               = source->rc_time_constant;
+    destination->charge_profile                 = source->charge_profile;
+
+    for (int i = 0; i < OCV_TABLE_POINTS; i++) {
+        destination->ocv_points[i]              = source->ocv_points[i];
+        destination->ocv_points_cold[i]         = source->ocv_points_cold[i];
+    }
+    destination->ocv_empty                      = source->ocv_points[0];
+    destination->ocv_full                       = source->ocv_points[OCV_TABLE_POINTS - 1];
     destination->wire_resistance                = source->wire_resistance;
 
+    // battery model parameters might have changed
+    if (charger != NULL) {
+        charger->soc_reset(SOC_RESET_MODEL);
+    }
+
     // reset Ah counter and SOH if battery nominal capacity was changed
     if (destination->nominal_capacity != source->nominal_capacity) {
         destination->nominal_capacity = source->nominal_capacity;
         if (charger != NULL) {
-            charger->discharged_Ah = 0;
+            charger->soc_reset(SOC_RESET_COUNTER);
             charger->usable_capacity = 0;
+            charger->full_reference = false;
             charger->soh = 0;
         }
     }
@@ -305,7 +631,9 @@ bool battery_conf_changed(BatConf *a, BatConf *b)
         a->discharge_temp_min             != b->discharge_temp_min ||
         a->temperature_compensation       != b->temperature_compensation ||
         a->internal_resistance            != b->internal_resistance ||
-        a->wire_resistance                != b->wire_resistance
+        a->wire_resistance                != b->wire_resistance ||
+        memcmp(a->ocv_points, b->ocv_points, sizeof(a->ocv_points)) != 0 ||
+        memcmp(a->ocv_points_cold, b->ocv_points_cold, sizeof(a->ocv_points_cold)) != 0
     );
 }
 
@@ -324,31 +652,176 @@ void Charger::detect_num_batteries(BatConf *bat) const
 
 void Charger::update_soc(BatConf *bat_conf)
 {
-    static int soc_filtered = 0;       // SOC / 100 for better filtering
+    // usable capacity is not known before the first full-to-empty cycle
+    float capacity = (usable_capacity > 0.0F) ? usable_capacity : bat_conf->nominal_capacity;
+
+    // voltage of a single battery
+    float voltage = port->bus->voltage / port->bus->series_multiplier;
+
+    // current-compensated open circuit voltage
+    float ocv = voltage - port->current * bat_conf->internal_resistance;
+    float soc_ocv = ocv_soc_lookup(bat_conf, ocv, bat_temperature);
+
+    unsigned int key = irq_lock();
+    uint8_t reset = soc_reset_pending;
+    soc_reset_pending = 0;
+    irq_unlock(key);
+
+    if (!soc_initialized) {
+        // no information available after startup except for the voltage
+        soc_estimate = soc_ocv;
+        soc_initialized = true;
+        reset |= SOC_RESET_MODEL;
+    }
 
-    if (fabs(port->current) < 0.2) {
-        int soc_new = (int)((port->bus->voltage - bat_conf->ocv_empty) /
-                   (bat_conf->ocv_full - bat_conf->ocv_empty) * 10000.0);
+#if CONFIG_BAT_SOC_EKF
+    if (reset & SOC_RESET_MODEL) {
+        // keep the actual SOC estimate, only the model parameters are updated
+        ocv_table_at(bat_conf, bat_temperature, ekf_ocv_points);
+        BatEkfModel model;
+        model.ocv_points = ekf_ocv_points;
+        model.ocv_num_points = OCV_TABLE_POINTS;
+        model.r0_nominal = bat_conf->internal_resistance;
+        model.rc_resistance = bat_conf->rc_resistance;
+        model.rc_time_constant = bat_conf->rc_time_constant;
+        ekf.init(&model, soc_estimate);
+    }
+#endif
 
-        if (soc_new > 500 && soc_filtered == 0) {
-            // bypass filter during initialization
-            soc_filtered = soc_new;
-        }
-        else {
-            // filtering to adjust SOC very slowly
-            soc_filtered += (soc_new - soc_filtered) / 100;
-        }
+    if (reset & SOC_RESET_COUNTER) {
+        discharged_Ah = 0.0F;
+    }
+    if (reset & SOC_RESET_FULL) {
+        soc_estimate = 1.0F;
+    }
+    else if (reset & SOC_RESET_EMPTY) {
+        soc_estimate = 0.0F;
+    }
 
-        if (soc_filtered > 10000) {
-            soc_filtered = 10000;
+    if (fabs(port->current) < SOC_REST_CURRENT) {
+        if (rest_counter < SOC_REST_TIME * CONFIG_CONTROL_FREQUENCY) {
+            rest_counter++;
         }
-        else if (soc_filtered < 0) {
-            soc_filtered = 0;
+    }
+    else {
+        rest_counter = 0;
+    }
+
+    // coulomb counting (charged current is positive)
+    charge_acc_As += port->current / CONFIG_CONTROL_FREQUENCY;
+#if CONFIG_BAT_SOC_EKF
+    voltage_acc_Vs += voltage / CONFIG_CONTROL_FREQUENCY;
+#endif
+    if (++charge_acc_cycles >= CONFIG_CONTROL_FREQUENCY) {
+        float delta_Ah = charge_acc_As / 3600.0F;
+        discharged_Ah -= delta_Ah;
+#if CONFIG_BAT_SOC_EKF
+        // the filter runs once per second with average current and voltage
+        ocv_table_at(bat_conf, bat_temperature, ekf_ocv_points);
+        ekf.soc = soc_estimate;     // take over resets at full or empty battery
+        ekf.update(charge_acc_As, voltage_acc_Vs, 1.0F, capacity);
+        soc_estimate = ekf.soc;
+        soh = ekf.soh();
+        voltage_acc_Vs = 0.0F;
+#else
+        if (capacity > 0.0F) {
+            soc_estimate += delta_Ah / capacity;
         }
-        soc = soc_filtered / 100;
+#endif
+        charge_acc_As = 0.0F;
+        charge_acc_cycles = 0;
+    }
+
+#if !CONFIG_BAT_SOC_EKF
+    if (rest_counter >= SOC_REST_TIME * CONFIG_CONTROL_FREQUENCY) {
+        // battery is relaxed: slowly correct drift of the coulomb counter
+        soc_estimate += (soc_ocv - soc_estimate) /
+            (SOC_OCV_FILTER_TIME * CONFIG_CONTROL_FREQUENCY);
+    }
+#endif
+
+    if (soc_estimate > 1.0F) {
+        soc_estimate = 1.0F;
+    }
+    else if (soc_estimate < 0.0F) {
+        soc_estimate = 0.0F;
+    }
+    soc = static_cast<uint16_t>(soc_estimate * 100.0F + 0.5F);
+}
+
+void Charger::soc_reset(uint8_t flags)
+{
+    // called from the main thread, which can be preempted by the control thread
+    unsigned int key = irq_lock();
+    soc_reset_pending |= flags;
+    irq_unlock(key);
+}
+
+void Charger::bms_limits_update(float voltage, float charge_current, float discharge_current)
+{
+    bms_voltage_limit = voltage;
+    bms_charge_current_limit = charge_current;
+    bms_discharge_current_limit = discharge_current;
+    time_bms_limits_received = uptime();
+    bms_connected = true;
+}
+
+void Charger::bms_limits_decode(const uint8_t *data, int len)
+{
+    if (len < 6) {
+        return;
     }
 
-    discharged_Ah += -port->current / 3600.0F;   // charged current is positive: change sign
+    uint16_t cvl = data[0] | (data[1] << 8);
+    int16_t ccl = data[2] | (data[3] << 8);
+    int16_t dcl = data[4] | (data[5] << 8);
+
+    bms_limits_update(cvl * 0.1F, (ccl > 0) ? ccl * 0.1F : 0, (dcl > 0) ? dcl * 0.1F : 0);
+}
+
+void Charger::apply_bms_limits()
+{
+    port->pos_current_limit = pos_current_limit;
+    port->neg_current_limit = neg_current_limit;
+    port->bus->sink_voltage_intercept = sink_voltage_intercept;
+
+    // limits may be updated from the CAN ISR at any time, so get a consistent snapshot
+    unsigned int key = irq_lock();
+    bool connected = bms_connected;
+    time_t time_received = time_bms_limits_received;
+    float voltage_limit = bms_voltage_limit;
+    float charge_current_limit = bms_charge_current_limit;
+    float discharge_current_limit = bms_discharge_current_limit;
+    irq_unlock(key);
+
+    if (!connected) {
+        return;
+    }
+
+    if (uptime() - time_received > CONFIG_BAT_BMS_TIMEOUT) {
+        // BMS communication lost: charging without knowledge of the cell voltages is not safe
+        // and discharging stays restricted to the last known limit
+        charge_current_limit = 0;
+        dev_stat.set_error(ERR_BAT_BMS_TIMEOUT);
+    }
+    else {
+        dev_stat.clear_error(ERR_BAT_BMS_TIMEOUT);
+    }
+
+    if (port->pos_current_limit > charge_current_limit) {
+        port->pos_current_limit = charge_current_limit;
+    }
+
+    // discharge current is stored as absolute value, but defined as negative current for port
+    if (port->neg_current_limit < -discharge_current_limit) {
+        port->neg_current_limit = -discharge_current_limit;
+    }
+
+    // BMS limit is valid for the entire pack, intercept for a single battery
+    voltage_limit /= port->bus->series_multiplier;
+    if (port->bus->sink_voltage_intercept > voltage_limit) {
+        port->bus->sink_voltage_intercept = voltage_limit;
+    }
 }
 
 void Charger::enter_state(int next_state)
@@ -370,19 +843,28 @@ void Charger::discharge_control(BatConf *bat_conf)
             empty = true;
             num_deep_discharges++;
 
-            if (usable_capacity == 0.0F) {
-                // reset to measured value if discharged the first time
-                usable_capacity = discharged_Ah;
-            }
-            else {
-                // slowly adapt new measurements with low-pass filter
-                usable_capacity =
-                    0.8F * usable_capacity +
-                    0.2F * discharged_Ah;
+            // discharged_Ah only represents the usable capacity if the coulomb counter was
+            // started at a full battery
+            if (full_reference) {
+                if (usable_capacity == 0.0F) {
+                    // reset to measured value if discharged the first time
+                    usable_capacity = discharged_Ah;
+                }
+                else {
+                    // slowly adapt new measurements with low-pass filter
+                    usable_capacity =
+                        0.8F * usable_capacity +
+                        0.2F * discharged_Ah;
+                }
+                full_reference = false;
+
+#if !CONFIG_BAT_SOC_EKF
+                // simple SOH estimation (Kalman filter estimates SOH based on resistance instead)
+                soh = usable_capacity / bat_conf->nominal_capacity * 100.0F + 0.5F;
+#endif
             }
 
-            // simple SOH estimation
-            soh = usable_capacity / bat_conf->nominal_capacity;
+            soc_reset(SOC_RESET_EMPTY);
         }
     }
     else {
@@ -392,22 +874,22 @@ void Charger::discharge_control(BatConf *bat_conf)
     }
 
     // negative current limit = allowed battery discharge current
-    if (port->neg_current_limit < 0) {
+    if (neg_current_limit < 0) {
 
         // This limit should normally never be reached, as the load output settings should be
         // higher. The flag can be used to trigger actions of last resort, e.g. deep-sleep
         // of the charge controller itself.
         if (port->bus->voltage < port->bus->src_control_voltage(bat_conf->voltage_absolute_min)) {
-            port->neg_current_limit = 0;
+            neg_current_limit = 0;
             dev_stat.set_error(ERR_BAT_UNDERVOLTAGE);
         }
 
         if (bat_temperature > bat_conf->discharge_temp_max) {
-            port->neg_current_limit = 0;
+            neg_current_limit = 0;
             dev_stat.set_error(ERR_BAT_DIS_OVERTEMP);
         }
         else if (bat_temperature < bat_conf->discharge_temp_min) {
-            port->neg_current_limit = 0;
+            neg_current_limit = 0;
             dev_stat.set_error(ERR_BAT_DIS_UNDERTEMP);
         }
     }
@@ -431,23 +913,76 @@ void Charger::discharge_control(BatConf *bat_conf)
         {
             // discharge current is stored as absolute value in bat_conf, but defined
             // as negative current for power port
-            port->neg_current_limit = -bat_conf->discharge_current_max;
+            neg_current_limit = -bat_conf->discharge_current_max;
 
         }
     }
 #endif
 }
 
+void Charger::apply_stage_limits(BatConf *bat_conf, const ChargeStage *stage)
+{
+    // continuously adjust voltage setting for temperature compensation
+    sink_voltage_intercept = bat_conf->*stage->voltage +
+        bat_conf->temperature_compensation * (bat_temperature - 25);
+
+    pos_current_limit = bat_conf->*stage->current *
+        charge_current_derating(bat_conf->charge_profile, bat_temperature);
+}
+
+void Charger::enter_stage(BatConf *bat_conf, int next_state)
+{
+    const ChargeProfile *profile = bat_conf->charge_profile;
+
+    // number of iterations limited to catch circular chains of disabled stages
+    for (int i = 0; i < CHG_NUM_STATES && next_state != CHG_STATE_IDLE; i++) {
+        const ChargeStage *stage = &profile->stages[next_state];
+        if (stage->voltage != NULL &&
+            (stage->enabled == NULL || stage->enabled(this, bat_conf)))
+        {
+            apply_stage_limits(bat_conf, stage);
+            target_voltage_timer = 0;
+            time_target_voltage_reached = uptime();
+            enter_state(next_state);
+            return;
+        }
+        next_state = stage->next;
+    }
+
+    pos_current_limit = 0;
+    enter_state(CHG_STATE_IDLE);
+}
+
+void Charger::finish_stage(BatConf *bat_conf)
+{
+    const ChargeStage *stage = &bat_conf->charge_profile->stages[state];
+
+    if (stage->exit & CHG_EXIT_FULL) {
+        full = true;
+        num_full_charges++;
+        soc_reset(SOC_RESET_COUNTER | SOC_RESET_FULL);
+        full_reference = true;
+    }
+
+    if (state == CHG_STATE_EQUALIZATION) {
+        // reset triggers
+        time_last_equalization = uptime();
+        deep_dis_last_equalization = num_deep_discharges;
+
+        soc_reset(SOC_RESET_COUNTER);   // reset coulomb counter again
+    }
+}
+
 void Charger::charge_control(BatConf *bat_conf)
 {
     // check battery temperature for charging direction
     if (bat_temperature > bat_conf->charge_temp_max) {
-        port->pos_current_limit = 0;
+        pos_current_limit = 0;
         dev_stat.set_error(ERR_BAT_CHG_OVERTEMP);
         enter_state(CHG_STATE_IDLE);
     }
     else if (bat_temperature < bat_conf->charge_temp_min) {
-        port->pos_current_limit = 0;
+        pos_current_limit = 0;
         dev_stat.set_error(ERR_BAT_CHG_UNDERTEMP);
         enter_state(CHG_STATE_IDLE);
     }
@@ -458,140 +993,103 @@ void Charger::charge_control(BatConf *bat_conf)
         dev_stat.clear_error(ERR_BAT_OVERVOLTAGE);
     }
 
-    // state machine
-    switch (state) {
-        case CHG_STATE_IDLE: {
-            if  (port->bus->voltage < port->bus->sink_control_voltage(bat_conf->voltage_recharge)
-                && port->bus->voltage > port->bus->sink_control_voltage(bat_conf->voltage_absolute_min) // ToDo set error flag otherwise
-                && (uptime() - time_state_changed) > bat_conf->time_limit_recharge
-                && bat_temperature < bat_conf->charge_temp_max - 1
-                && bat_temperature > bat_conf->charge_temp_min + 1)
-            {
-                port->bus->sink_voltage_intercept = bat_conf->topping_voltage +
-                    bat_conf->temperature_compensation * (bat_temperature - 25);
-                port->pos_current_limit = bat_conf->charge_current_max;
-                full = false;
-                dev_stat.clear_error(ERR_BAT_CHG_OVERTEMP);
-                dev_stat.clear_error(ERR_BAT_CHG_UNDERTEMP);
-                dev_stat.clear_error(ERR_BAT_OVERVOLTAGE);
-                enter_state(CHG_STATE_BULK);
-            }
-            break;
-        }
-        case CHG_STATE_BULK: {
-            // continuously adjust voltage setting for temperature compensation
-            port->bus->sink_voltage_intercept = bat_conf->topping_voltage +
-                bat_conf->temperature_compensation * (bat_temperature - 25);
-
-            if (port->bus->voltage > port->bus->sink_control_voltage()) {
-                target_voltage_timer = 0;
-                enter_state(CHG_STATE_TOPPING);
-            }
-            break;
-        }
-        case CHG_STATE_TOPPING: {
-            // continuously adjust voltage setting for temperature compensation
-            port->bus->sink_voltage_intercept = bat_conf->topping_voltage +
-                bat_conf->temperature_compensation * (bat_temperature - 25);
-
-            if (port->bus->voltage_filtered >= port->bus->sink_control_voltage() - 0.05F) {
-                // battery is full if topping target voltage is still reached (i.e. sufficient
-                // solar power available) and time limit or cut-off current reached
-                if (port->current_filtered < bat_conf->topping_current_cutoff ||
-                    target_voltage_timer > bat_conf->topping_duration)
-                {
-                    full = true;
-                }
-                target_voltage_timer++;
-            }
-            else if (uptime() - time_state_changed > 8 * 60 * 60) {
-                // in topping phase already for 8 hours (i.e. not enough solar power available)
-                // --> go back to bulk charging for the next day
-                enter_state(CHG_STATE_BULK);
-            }
+    if (bat_conf->charge_profile == NULL) {
+        return;
+    }
 
-            if (full) {
-                num_full_charges++;
-                discharged_Ah = 0;         // reset coulomb counter
-
-                if (bat_conf->equalization_enabled && (
-                    (uptime() - time_last_equalization) / (24*60*60)
-                    >= bat_conf->equalization_trigger_days ||
-                    num_deep_discharges - deep_dis_last_equalization
-                    >= bat_conf->equalization_trigger_deep_cycles))
-                {
-                    port->bus->sink_voltage_intercept = bat_conf->equalization_voltage;
-                    port->pos_current_limit = bat_conf->equalization_current_limit;
-                    enter_state(CHG_STATE_EQUALIZATION);
-                }
-                else if (bat_conf->trickle_enabled) {
-                    port->bus->sink_voltage_intercept = bat_conf->trickle_voltage +
-                        bat_conf->temperature_compensation * (bat_temperature - 25);
-                    enter_state(CHG_STATE_TRICKLE);
-                }
-                else {
-                    port->pos_current_limit = 0;
-                    enter_state(CHG_STATE_IDLE);
-                }
-            }
-            break;
+    if (state == CHG_STATE_IDLE) {
+        if  (port->bus->voltage < port->bus->sink_control_voltage(bat_conf->voltage_recharge)
+            && port->bus->voltage > port->bus->sink_control_voltage(bat_conf->voltage_absolute_min) // ToDo set error flag otherwise
+            && (uptime() - time_state_changed) > bat_conf->time_limit_recharge
+            && bat_temperature < bat_conf->charge_temp_max - 1
+            && bat_temperature > bat_conf->charge_temp_min + 1)
+        {
+            full = false;
+            dev_stat.clear_error(ERR_BAT_CHG_OVERTEMP);
+            dev_stat.clear_error(ERR_BAT_CHG_UNDERTEMP);
+            dev_stat.clear_error(ERR_BAT_OVERVOLTAGE);
+            enter_stage(bat_conf, CHG_STATE_BULK);
         }
-        case CHG_STATE_TRICKLE: {
-            // continuously adjust voltage setting for temperature compensation
-            port->bus->sink_voltage_intercept = bat_conf->trickle_voltage +
-                bat_conf->temperature_compensation * (bat_temperature - 25);
+        return;
+    }
 
-            if (port->bus->voltage >= port->bus->sink_control_voltage()) {
-                time_target_voltage_reached = uptime();
-            }
+    const ChargeStage *stage = &bat_conf->charge_profile->stages[state];
+    if (stage->voltage == NULL) {
+        // state not part of the profile (e.g. after battery configuration was changed)
+        enter_stage(bat_conf, CHG_STATE_IDLE);
+        return;
+    }
+
+    apply_stage_limits(bat_conf, stage);
+
+    int32_t duration = (stage->duration != NULL) ? bat_conf->*stage->duration : 0;
+    bool finished = false;
+    bool fallback = false;
 
-            if (uptime() - time_target_voltage_reached > bat_conf->trickle_recharge_time)
+    if ((stage->exit & CHG_EXIT_TARGET_VOLTAGE) &&
+        port->bus->voltage > port->bus->sink_control_voltage())
+    {
+        finished = true;
+    }
+
+    if (stage->exit & (CHG_EXIT_CUTOFF_CURRENT | CHG_EXIT_TIME_AT_TARGET)) {
+        if (port->bus->voltage_filtered >= port->bus->sink_control_voltage() - 0.05F) {
+            // stage is finished if target voltage is still reached (i.e. sufficient solar power
+            // available) and time limit or cut-off current reached
+            if (((stage->exit & CHG_EXIT_CUTOFF_CURRENT) &&
+                    port->current_filtered < bat_conf->topping_current_cutoff) ||
+                ((stage->exit & CHG_EXIT_TIME_AT_TARGET) && target_voltage_timer > duration))
             {
-                // the battery was discharged: trickle voltage could not be reached anymore
-                port->pos_current_limit = bat_conf->charge_current_max;
-                full = false;
-                // assumption: trickle does not harm the battery --> never go back to idle
-                // (for Li-ion battery: disable trickle!)
-                enter_state(CHG_STATE_BULK);
+                finished = true;
             }
-            break;
+            target_voltage_timer++;
         }
-        case CHG_STATE_EQUALIZATION: {
-            // continuously adjust voltage setting for temperature compensation
-            port->bus->sink_voltage_intercept = bat_conf->equalization_voltage +
-                bat_conf->temperature_compensation * (bat_temperature - 25);
+        else if (stage->fallback_time > 0 &&
+            uptime() - time_state_changed > stage->fallback_time)
+        {
+            // target voltage not reached for a long time (i.e. not enough solar power available)
+            // --> go back to fallback stage for the next day
+            fallback = true;
+        }
+    }
 
-            // current or time limit for equalization reached
-            if (uptime() - time_state_changed > bat_conf->equalization_duration)
-            {
-                // reset triggers
-                time_last_equalization = uptime();
-                deep_dis_last_equalization = num_deep_discharges;
+    if ((stage->exit & CHG_EXIT_DURATION) && uptime() - time_state_changed > duration) {
+        finished = true;
+    }
 
-                discharged_Ah = 0;         // reset coulomb counter again
+    if (stage->exit & CHG_EXIT_VOLTAGE_LOST) {
+        if (port->bus->voltage >= port->bus->sink_control_voltage()) {
+            time_target_voltage_reached = uptime();
+        }
 
-                if (bat_conf->trickle_enabled) {
-                    port->bus->sink_voltage_intercept = bat_conf->trickle_voltage +
-                        bat_conf->temperature_compensation * (bat_temperature - 25);
-                    enter_state(CHG_STATE_TRICKLE);
-                }
-                else {
-                    port->pos_current_limit = 0;
-                    enter_state(CHG_STATE_IDLE);
-                }
-            }
-            break;
+        if (uptime() - time_target_voltage_reached > duration) {
+            // the battery was discharged: target voltage could not be reached anymore
+            full = false;
+            fallback = true;
         }
     }
+
+    if (finished) {
+        finish_stage(bat_conf);
+        enter_stage(bat_conf, stage->next);
+    }
+    else if (fallback) {
+        enter_stage(bat_conf, stage->fallback);
+    }
 }
 
-void Charger::init_terminal(BatConf *bat) const
+void Charger::init_terminal(BatConf *bat)
 {
-    port->bus->sink_voltage_intercept = bat->topping_voltage;
+    sink_voltage_intercept = bat->topping_voltage;
     port->bus->src_voltage_intercept = bat->voltage_load_disconnect;
 
-    port->neg_current_limit = -bat->discharge_current_max;
-    port->pos_current_limit = bat->charge_current_max;
+    neg_current_limit = -bat->discharge_current_max;
+    pos_current_limit = bat->charge_current_max;
+
+    soc_reset(SOC_RESET_MODEL);
+
+    // called during initialization before the control thread is started
+    apply_bms_limits();
 
     /*
      * Negative sign for compensation of actual resistance
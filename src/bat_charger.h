@@ -18,6 +18,7 @@
 #include <time.h>
 
 #include "power_port.h"
+#include "bat_ekf.h"
 
 /**
  * Battery cell types
@@ -35,6 +36,18 @@ enum BatType {
     BAT_TYPE_NMC_HV         ///< NMC/Graphite High Voltage Li-ion batteries (3.7V nominal, 4.35 max)
 };
 
+/**
+ * Number of points of the OCV-SOC lookup tables (equidistant SOC steps from 0% to 100%)
+ */
+#define OCV_TABLE_POINTS 11
+
+/**
+ * Battery temperature (°C) of the cold variant of the OCV-SOC lookup table
+ *
+ * The normal table is valid for 25°C. Values in between are interpolated.
+ */
+#define OCV_TABLE_TEMP_COLD 0
+
 /**
  * Battery configuration data
  *
@@ -214,6 +227,20 @@ typedef struct
      */
     float internal_resistance;
 
+    /**
+     * Polarization resistance of the battery equivalent circuit (Ohm)
+     *
+     * Resistance of the RC element used for model-based SOC estimation.
+     */
+    float rc_resistance;
+
+    /**
+     * Polarization time constant of the battery equivalent circuit (s)
+     *
+     * Time constant of the RC element used for model-based SOC estimation.
+     */
+    float rc_time_constant;
+
     /**
      * Resistance of wire between charge controller and battery (Ohm)
      *
@@ -227,17 +254,29 @@ typedef struct
     /**
      * Open circuit voltage of full battery (V)
      *
-     * Used for simple state of charge (SOC) algorithm.
+     * Equals the last point of the OCV-SOC table at 25°C.
      */
     float ocv_full;
 
     /**
      * Open circuit voltage of empty battery (V)
      *
-     * Used for simple state of charge (SOC) algorithm.
+     * Equals the first point of the OCV-SOC table at 25°C.
      */
     float ocv_empty;
 
+    /**
+     * Open circuit voltage (V) at 25°C for equidistant SOC steps from 0% to 100%
+     *
+     * Used for state of charge (SOC) estimation. The values must be strictly increasing.
+     */
+    float ocv_points[OCV_TABLE_POINTS];
+
+    /**
+     * Open circuit voltage (V) at OCV_TABLE_TEMP_COLD for equidistant SOC steps from 0% to 100%
+     */
+    float ocv_points_cold[OCV_TABLE_POINTS];
+
     /**
      * Maximum allowed charging temperature of the battery (°C)
      */
@@ -265,8 +304,225 @@ typedef struct
      */
     float temperature_compensation;
 
+    /**
+     * Charge profile defining the stages of the charger state machine
+     *
+     * Set in battery_conf_init depending on the battery type.
+     */
+    const struct ChargeProfile *charge_profile;
+
 } BatConf;
 
+class Charger;
+
+/**
+ * Possible charger states
+ *
+ * Further information:
+ * - https://en.wikipedia.org/wiki/IUoU_battery_charging
+ * - https://batteryuniversity.com/learn/article/charging_the_lead_acid_battery
+ */
+enum ChargerState {
+
+    /**
+     * Idle
+     *
+     * Initial state of the charge controller. If the solar voltage is high enough
+     * and the battery is not full, bulk charging mode is started.
+     */
+    CHG_STATE_IDLE,
+
+    /**
+     * Bulk / CC / MPPT charging
+     *
+     * The battery is charged with maximum possible current (MPPT algorithm is
+     * active) until the CV voltage limit is reached.
+     */
+    CHG_STATE_BULK,
+
+    /**
+     * Topping / CV / absorption charging
+     *
+     * Lead-acid batteries are charged for some time using a slightly higher charge
+     * voltage. After a current cutoff limit or a time limit is reached, the charger
+     * goes into trickle or equalization mode for lead-acid batteries or back into
+     * Standby for Li-ion batteries.
+     */
+    CHG_STATE_TOPPING,
+
+    /**
+     * Trickle charging
+     *
+     * This mode is kept forever for a lead-acid battery and keeps the battery at
+     * full state of charge. If too much power is drawn from the battery, the
+     * charger switches back into CC / bulk charging mode.
+     */
+    CHG_STATE_TRICKLE,
+
+    /**
+     * Equalization charging
+     *
+     * This mode is only used for lead-acid batteries after several deep-discharge
+     * cycles or a very long period of time with no equalization. Voltage is
+     * increased to 15V or above, so care must be taken for the other system
+     * components attached to the battery. (currently, no equalization charging is
+     * enabled in the software)
+     */
+    CHG_STATE_EQUALIZATION
+};
+
+/**
+ * Number of charger states (see enum ChargerState)
+ */
+#define CHG_NUM_STATES (CHG_STATE_EQUALIZATION + 1)
+
+/**
+ * Exit conditions of a charge stage
+ */
+enum ChargeExitFlag {
+    /**
+     * Stage is finished as soon as the target voltage is reached (CC stage)
+     */
+    CHG_EXIT_TARGET_VOLTAGE = 1U << 0,
+
+    /**
+     * Stage is finished if the current at target voltage drops below topping_current_cutoff
+     */
+    CHG_EXIT_CUTOFF_CURRENT = 1U << 1,
+
+    /**
+     * Stage is finished if the target voltage was reached for the stage duration (s)
+     */
+    CHG_EXIT_TIME_AT_TARGET = 1U << 2,
+
+    /**
+     * Stage is finished after the stage duration (s), independent of the voltage
+     */
+    CHG_EXIT_DURATION = 1U << 3,
+
+    /**
+     * Fall back if the target voltage could not be reached during the stage duration (s)
+     *
+     * Used to detect a discharged battery during float charging.
+     */
+    CHG_EXIT_VOLTAGE_LOST = 1U << 4,
+
+    /**
+     * The battery is considered full after this stage was finished
+     */
+    CHG_EXIT_FULL = 1U << 5,
+};
+
+/**
+ * Stage of a charge profile
+ *
+ * Voltage, current and time settings refer to members of BatConf, so that they can be
+ * changed by the user at runtime.
+ */
+typedef struct {
+    /**
+     * Target voltage (CV limit), temperature-compensated (NULL if stage is not used)
+     */
+    float BatConf::*voltage;
+
+    /**
+     * Current limit (CC limit) before temperature derating
+     */
+    float BatConf::*current;
+
+    /**
+     * Stage duration (s) used for the exit conditions
+     */
+    int32_t BatConf::*duration;
+
+    /**
+     * Additional condition to enter the stage (NULL: stage always enabled)
+     *
+     * Disabled stages are skipped and the next state is entered instead.
+     */
+    bool (*enabled)(const Charger *charger, const BatConf *bat_conf);
+
+    /**
+     * Exit conditions (see enum ChargeExitFlag)
+     */
+    uint8_t exit;
+
+    /**
+     * State entered after exit conditions were met
+     */
+    uint8_t next;
+
+    /**
+     * State entered if the target voltage was not reached for fallback_time or if the voltage
+     * was lost (CHG_EXIT_VOLTAGE_LOST)
+     */
+    uint8_t fallback;
+
+    /**
+     * Time (s) after which the fallback state is entered if target voltage is not reached
+     * (0 to disable)
+     */
+    int32_t fallback_time;
+} ChargeStage;
+
+/**
+ * Point of the piecewise-linear charge current derating curve
+ */
+typedef struct {
+    float temperature;      ///< Battery temperature (°C)
+    float factor;           ///< Factor applied to the current limit of the stage
+} ChargeDerating;
+
+/**
+ * Table-driven charge profile
+ */
+typedef struct ChargeProfile {
+    /**
+     * Stages indexed by ChargerState (CHG_STATE_IDLE entry is not used)
+     */
+    ChargeStage stages[CHG_NUM_STATES];
+
+    /**
+     * Charge current derating over temperature (sorted by temperature, NULL if not used)
+     */
+    const ChargeDerating *derating;
+
+    /**
+     * Number of points in the derating curve
+     */
+    int num_derating_points;
+} ChargeProfile;
+
+/**
+ * Charge profile for lead-acid batteries (IUoU with optional trickle and equalization)
+ */
+extern const ChargeProfile charge_profile_lead_acid;
+
+/**
+ * Charge profile for lithium-ion batteries (CC-CV without float stage, temperature derating)
+ */
+extern const ChargeProfile charge_profile_lithium;
+
+/**
+ * Charge current derating factor for the battery temperature
+ *
+ * @param profile Charge profile containing the derating curve
+ * @param temperature Battery temperature (°C)
+ *
+ * @returns Factor between 0.0 and 1.0 applied to the current limit
+ */
+float charge_current_derating(const ChargeProfile *profile, float temperature);
+
+/**
+ * Resets of the SOC estimation, requested by the charger state machine
+ */
+enum SocResetFlag {
+    SOC_RESET_COUNTER = 1U << 0,    ///< Reset coulomb counter (discharged_Ah)
+    SOC_RESET_FULL = 1U << 1,       ///< Set SOC to 100 %
+    SOC_RESET_EMPTY = 1U << 2,      ///< Set SOC to 0 %
+    SOC_RESET_MODEL = 1U << 3,      ///< Re-initialize the battery model after a config change
+};
+
 /**
  * Charger configuration and battery state
  */
@@ -300,9 +556,71 @@ public:
 
     /**
      * Coulomb counter for SOH calculation
+     *
+     * Net discharged charge (Ah) since the last full charge, integrated with control frequency.
      */
     float discharged_Ah;
 
+    /**
+     * State of Charge estimation (0.0 to 1.0)
+     *
+     * Based on coulomb counting and slowly recalibrated with the open circuit voltage if the
+     * battery is at rest.
+     */
+    float soc_estimate = 1.0F;
+
+    /**
+     * Charge (As) integrated during the current second, added to the coulomb counter once per
+     * second to avoid losing small currents due to float resolution
+     */
+    float charge_acc_As = 0.0F;
+
+    /**
+     * Number of control cycles integrated in charge_acc_As
+     */
+    int charge_acc_cycles = 0;
+
+#if CONFIG_BAT_SOC_EKF
+    /**
+     * Kalman filter for model-based SOC and SOH estimation
+     */
+    BatEkf ekf;
+
+    /**
+     * Battery voltage integrated during the current second (Vs) as input for the Kalman filter
+     */
+    float voltage_acc_Vs = 0.0F;
+
+    /**
+     * OCV table of the Kalman filter model, interpolated for the actual battery temperature
+     */
+    float ekf_ocv_points[OCV_TABLE_POINTS];
+#endif
+
+    /**
+     * Flag to indicate that soc_estimate was initialized from the open circuit voltage
+     */
+    bool soc_initialized = false;
+
+    /**
+     * Number of control cycles without significant battery current (saturated at rest time)
+     */
+    int rest_counter = 0;
+
+    /**
+     * Pending resets of the SOC estimation (see enum SocResetFlag)
+     *
+     * The SOC is updated in the control thread, so the state machine in the main thread must not
+     * write the SOC values directly. Resets are collected here and applied by update_soc.
+     */
+    uint8_t soc_reset_pending = 0;
+
+    /**
+     * Flag to indicate that the coulomb counter was reset at a full battery, i.e. discharged_Ah
+     * can be used to measure the usable capacity as soon as the battery is empty.
+     */
+    bool full_reference = false;
+
     /**
      * Number of full charge cycles
      */
@@ -359,6 +677,48 @@ public:
      */
     bool empty;
 
+    /**
+     * Flag to indicate that limits were received from an external BMS at least once
+     */
+    bool bms_connected = false;
+
+    /**
+     * Charge voltage limit (CVL) of the battery pack received from external BMS (V)
+     */
+    float bms_voltage_limit;
+
+    /**
+     * Charge current limit (CCL) received from external BMS (A, positive value)
+     */
+    float bms_charge_current_limit;
+
+    /**
+     * Discharge current limit (DCL) received from external BMS (A, positive value)
+     */
+    float bms_discharge_current_limit;
+
+    /**
+     * Timestamp of the last limits received from external BMS
+     */
+    time_t time_bms_limits_received;
+
+    /**
+     * Charge current limit determined by the charging algorithm (A)
+     *
+     * The power port limit is set to this value, restricted by the limits of an external BMS.
+     */
+    float pos_current_limit;
+
+    /**
+     * Discharge current limit determined by the discharge control (A, negative value)
+     */
+    float neg_current_limit;
+
+    /**
+     * Charge voltage of the current stage including temperature compensation (V)
+     */
+    float sink_voltage_intercept;
+
     /**
      * Detect if two batteries are connected in series (12V/24V auto-detection)
      */
@@ -375,78 +735,83 @@ public:
     void charge_control(BatConf *bat_conf);
 
     /**
-     * SOC estimation
+     * SOC estimation using coulomb counting and open circuit voltage (OCV) recalibration
      *
-     * Must be called exactly once per second, otherwise SOC calculation gets wrong.
+     * Must be called with CONFIG_CONTROL_FREQUENCY directly after the DAQ update, otherwise
+     * SOC calculation gets wrong.
      */
     void update_soc(BatConf *bat_conf);
 
     /**
-     * Initialize terminal and dc bus for battery connection
+     * Requests a reset of the SOC estimation, which is applied with the next call of update_soc
      *
-     * @param bat Configuration to be used for terminal setpoints
+     * @param flags Combination of SocResetFlag values
      */
-    void init_terminal(BatConf *bat) const;
-
-private:
-    void enter_state(int next_state);
-};
-
-
-/**
- * Possible charger states
- *
- * Further information:
- * - https://en.wikipedia.org/wiki/IUoU_battery_charging
- * - https://batteryuniversity.com/learn/article/charging_the_lead_acid_battery
- */
-enum ChargerState {
+    void soc_reset(uint8_t flags);
 
     /**
-     * Idle
+     * Stores charge and discharge limits received from an external battery management system
      *
-     * Initial state of the charge controller. If the solar voltage is high enough
-     * and the battery is not full, bulk charging mode is started.
+     * Can be called from an ISR, the limits are applied with the next call of apply_bms_limits.
+     *
+     * @param voltage Charge voltage limit (CVL) of the entire battery pack (V)
+     * @param charge_current Charge current limit (CCL) in A (positive value)
+     * @param discharge_current Discharge current limit (DCL) in A (positive value)
      */
-    CHG_STATE_IDLE,
+    void bms_limits_update(float voltage, float charge_current, float discharge_current);
 
     /**
-     * Bulk / CC / MPPT charging
+     * Decodes a charge/discharge limits message (CAN ID 0x351) of a Victron/SMA compatible BMS
      *
-     * The battery is charged with maximum possible current (MPPT algorithm is
-     * active) until the CV voltage limit is reached.
+     * Can be called from an ISR. Negative current limits are treated as zero.
+     *
+     * @param data Frame payload (little-endian, CVL in 0.1 V, CCL and DCL in 0.1 A)
+     * @param len Payload length in bytes, messages shorter than 6 bytes are ignored
      */
-    CHG_STATE_BULK,
+    void bms_limits_decode(const uint8_t *data, int len);
 
     /**
-     * Topping / CV / absorption charging
+     * Sets the power port setpoints to the limits of the charger, restricted by the limits
+     * received from an external BMS
      *
-     * Lead-acid batteries are charged for some time using a slightly higher charge
-     * voltage. After a current cutoff limit or a time limit is reached, the charger
-     * goes into trickle or equalization mode for lead-acid batteries or back into
-     * Standby for Li-ion batteries.
+     * The limits are recalculated from the charger values each time, so that the BMS can also
+     * raise them again. Must be called in each cycle of the control thread, which is the only
+     * thread that writes the power port setpoints. The charger state machine only changes
+     * pos_current_limit, neg_current_limit and sink_voltage_intercept of the charger.
+     *
+     * If the BMS limits were not updated within CONFIG_BAT_BMS_TIMEOUT, the following fallback
+     * limits are applied until new limits are received:
+     * - Charge current: 0 A (charging stopped)
+     * - Discharge current: last received DCL
+     * - Charge voltage: last received CVL
      */
-    CHG_STATE_TOPPING,
+    void apply_bms_limits();
 
     /**
-     * Trickle charging
+     * Initialize terminal and dc bus for battery connection
      *
-     * This mode is kept forever for a lead-acid battery and keeps the battery at
-     * full state of charge. If too much power is drawn from the battery, the
-     * charger switches back into CC / bulk charging mode.
+     * @param bat Configuration to be used for terminal setpoints
      */
-    CHG_STATE_TRICKLE,
+    void init_terminal(BatConf *bat);
+
+private:
+    void enter_state(int next_state);
 
     /**
-     * Equalization charging
-     *
-     * This mode is only used for lead-acid batteries after several deep-discharge
-     * cycles or a very long period of time with no equalization. Voltage is
-     * increased to 15V or above, so care must be taken for the other system
-     * components attached to the battery. (currently, no equalization charging is
-     * enabled in the software)
+     * Enters the first enabled stage of the charge profile, starting with the given state
+     * and following the next states of disabled stages.
      */
-    CHG_STATE_EQUALIZATION
+    void enter_stage(BatConf *bat_conf, int next_state);
+
+    /**
+     * Bookkeeping after the exit conditions of the current stage were met
+     */
+    void finish_stage(BatConf *bat_conf);
+
+    /**
+     * Sets temperature-compensated target voltage and derated current limit of a stage
+     */
+    void apply_stage_limits(BatConf *bat_conf, const ChargeStage *stage);
 };
 
 /**
@@ -476,6 +841,40 @@ bool battery_conf_check(BatConf *bat);
  */
 void battery_conf_overwrite(BatConf *source, BatConf *destination, Charger *charger = NULL);
 
+/**
+ * Determines the SOC corresponding to an open circuit voltage
+ *
+ * Binary search with linear interpolation in the OCV-SOC table. The tables for 25°C and
+ * OCV_TABLE_TEMP_COLD are interpolated based on the battery temperature.
+ *
+ * @param bat Battery configuration containing the OCV tables
+ * @param voltage Open circuit voltage of the battery (V)
+ * @param temperature Battery temperature (°C)
+ *
+ * @returns State of charge (0.0 to 1.0)
+ */
+float ocv_soc_lookup(const BatConf *bat, float voltage, float temperature);
+
+/**
+ * Determines the open circuit voltage corresponding to a SOC
+ *
+ * @param bat Battery configuration containing the OCV tables
+ * @param soc State of charge (0.0 to 1.0)
+ * @param temperature Battery temperature (°C)
+ *
+ * @returns Open circuit voltage of the battery (V)
+ */
+float ocv_lookup(const BatConf *bat, float soc, float temperature);
+
+/**
+ * Interpolates the OCV tables for 25°C and OCV_TABLE_TEMP_COLD for the battery temperature
+ *
+ * @param bat Battery configuration containing the OCV tables
+ * @param temperature Battery temperature (°C)
+ * @param points Destination array with OCV_TABLE_POINTS elements (V)
+ */
+void ocv_table_at(const BatConf *bat, float temperature, float *points);
+
 /**
  * Checks if incoming configuration is different to current configuration
  *
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "bat_ekf.h"
+
+#include <math.h>
+#include <stddef.h>
+
+// process noise variance of the SOC per second (considers current measurement errors)
+#define EKF_SOC_PROCESS_NOISE 1e-10F
+
+// process noise variance of the RC element voltage per second, relative to OCV of full battery
+#define EKF_VRC_PROCESS_NOISE 1e-8F
+
+// process noise variance of the series resistance per second, relative to nominal resistance
+#define EKF_R0_PROCESS_NOISE 1e-10F
+
+// standard deviation of the voltage measurement, relative to OCV of full battery
+#define EKF_VOLTAGE_NOISE 0.002F
+
+// series resistance estimation is limited to this range, relative to nominal resistance
+#define EKF_R0_MIN 0.5F
+#define EKF_R0_MAX 4.0F
+
+void BatEkf::init(const BatEkfModel *bat_model, float soc_init)
+{
+    model = *bat_model;
+
+    soc = soc_init;
+    v_rc = 0.0F;
+    r0 = model.r0_nominal;
+
+    for (int i = 0; i < BAT_EKF_NUM_STATES; i++) {
+        for (int j = 0; j < BAT_EKF_NUM_STATES; j++) {
+            P[i][j] = 0.0F;
+        }
+    }
+
+    float ocv_full = model.ocv_points[model.ocv_num_points - 1];
+    float v_scale = EKF_VOLTAGE_NOISE * ocv_full;
+
+    P[0][0] = 0.2F * 0.2F;
+    P[1][1] = 10.0F * v_scale * v_scale;
+    P[2][2] = 0.01F * model.r0_nominal * model.r0_nominal;
+
+    meas_var = v_scale * v_scale;
+}
+
+// index of the OCV table segment containing the SOC
+static inline int ocv_segment(float soc_x, int num_points)
+{
+    int i = static_cast<int>(soc_x * (num_points - 1));
+    if (i < 0) {
+        return 0;
+    }
+    else if (i > num_points - 2) {
+        return num_points - 2;
+    }
+    return i;
+}
+
+float BatEkf::ocv(float soc_x) const
+{
+    int i = ocv_segment(soc_x, model.ocv_num_points);
+    return model.ocv_points[i] + ocv_slope(soc_x) *
+        (soc_x - static_cast<float>(i) / (model.ocv_num_points - 1));
+}
+
+float BatEkf::ocv_slope(float soc_x) const
+{
+    int i = ocv_segment(soc_x, model.ocv_num_points);
+    return (model.ocv_points[i + 1] - model.ocv_points[i]) * (model.ocv_num_points - 1);
+}
+
+void BatEkf::update(float current, float voltage, float dt, float capacity)
+{
+    if (model.ocv_points == NULL || capacity <= 0.0F || dt <= 0.0F) {
+        return;
+    }
+
+    /*
+     * Prediction step
+     */
+    float a = expf(-dt / model.rc_time_constant);
+
+    soc += current * dt / (3600.0F * capacity);
+    v_rc = a * v_rc + model.rc_resistance * (1.0F - a) * current;
+
+    // P = F * P * F^T + Q with F = diag(1, a, 1)
+    const float f[BAT_EKF_NUM_STATES] = { 1.0F, a, 1.0F };
+    for (int i = 0; i < BAT_EKF_NUM_STATES; i++) {
+        for (int j = 0; j < BAT_EKF_NUM_STATES; j++) {
+            P[i][j] *= f[i] * f[j];
+        }
+    }
+    P[0][0] += EKF_SOC_PROCESS_NOISE * dt;
+    float ocv_full = model.ocv_points[model.ocv_num_points - 1];
+    P[1][1] += EKF_VRC_PROCESS_NOISE * ocv_full * ocv_full * dt;
+    P[2][2] += EKF_R0_PROCESS_NOISE * model.r0_nominal * model.r0_nominal * dt;
+
+    /*
+     * Correction step
+     */
+    const float H[BAT_EKF_NUM_STATES] = { ocv_slope(soc), 1.0F, current };
+
+    float innovation = voltage - (ocv(soc) + v_rc + r0 * current);
+
+    float PH[BAT_EKF_NUM_STATES];
+    float S = meas_var;
+    for (int i = 0; i < BAT_EKF_NUM_STATES; i++) {
+        PH[i] = 0.0F;
+        for (int j = 0; j < BAT_EKF_NUM_STATES; j++) {
+            PH[i] += P[i][j] * H[j];
+        }
+        S += H[i] * PH[i];
+    }
+
+    float K[BAT_EKF_NUM_STATES];
+    for (int i = 0; i < BAT_EKF_NUM_STATES; i++) {
+        K[i] = PH[i] / S;
+    }
+
+    soc += K[0] * innovation;
+    v_rc += K[1] * innovation;
+    r0 += K[2] * innovation;
+
+    // P = (I - K * H) * P = P - K * (P * H^T)^T, kept symmetric
+    for (int i = 0; i < BAT_EKF_NUM_STATES; i++) {
+        for (int j = i; j < BAT_EKF_NUM_STATES; j++) {
+            P[i][j] -= 0.5F * (K[i] * PH[j] + K[j] * PH[i]);
+            P[j][i] = P[i][j];
+        }
+    }
+
+    // physical limits
+    if (soc > 1.0F) {
+        soc = 1.0F;
+    }
+    else if (soc < 0.0F) {
+        soc = 0.0F;
+    }
+
+    if (r0 > EKF_R0_MAX * model.r0_nominal) {
+        r0 = EKF_R0_MAX * model.r0_nominal;
+    }
+    else if (r0 < EKF_R0_MIN * model.r0_nominal) {
+        r0 = EKF_R0_MIN * model.r0_nominal;
+    }
+}
+
+uint16_t BatEkf::soh() const
+{
+    if (model.r0_nominal <= 0.0F) {
+        return 100;
+    }
+
+    // linear decrease from 100% at nominal resistance to 0% at double the nominal resistance
+    float soh_r = (2.0F - r0 / model.r0_nominal) * 100.0F;
+
+    if (soh_r > 100.0F) {
+        return 100;
+    }
+    else if (soh_r < 0.0F) {
+        return 0;
+    }
+    return static_cast<uint16_t>(soh_r + 0.5F);
+}
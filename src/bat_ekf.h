@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BAT_EKF_H
+#define BAT_EKF_H
+
+/** @file
+ *
+ * @brief Extended Kalman filter for battery state estimation
+ *
+ * The battery is modelled by a first-order equivalent circuit: open circuit voltage source
+ * (depending on SOC), series resistance R0 and one RC element for the polarization voltage.
+ *
+ * State vector: x = [ SOC, polarization voltage (V), R0 (Ohm) ]
+ *
+ * Only single precision and fixed 3x3 matrices are used, so that the filter fits into the
+ * RAM and computing budget of the smallest boards.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BAT_EKF_NUM_STATES 3
+
+/**
+ * Equivalent circuit model parameters used by the Kalman filter
+ */
+typedef struct {
+    const float *ocv_points;    ///< OCV (V) for equidistant SOC steps from 0% to 100%
+    int ocv_num_points;         ///< Number of points in the OCV table
+    float r0_nominal;           ///< Series resistance of a new battery (Ohm)
+    float rc_resistance;        ///< Resistance of the RC element (Ohm)
+    float rc_time_constant;     ///< Time constant of the RC element (s)
+} BatEkfModel;
+
+/**
+ * Battery state estimation using an extended Kalman filter (EKF)
+ */
+class BatEkf
+{
+public:
+    /**
+     * Initialize filter states and covariance
+     *
+     * @param model Equivalent circuit parameters of the battery (copied internally)
+     * @param soc Initial state of charge (0.0 to 1.0), e.g. determined from the OCV
+     */
+    void init(const BatEkfModel *model, float soc);
+
+    /**
+     * Prediction and correction step of the filter
+     *
+     * @param current Battery current (A), positive for charging
+     * @param voltage Measured battery terminal voltage (V)
+     * @param dt Time since last update (s)
+     * @param capacity Actual battery capacity (Ah)
+     */
+    void update(float current, float voltage, float dt, float capacity);
+
+    /**
+     * Estimated state of health (%) based on the increase of the series resistance
+     *
+     * A battery is considered at its end of life if the resistance has doubled.
+     */
+    uint16_t soh() const;
+
+    /**
+     * Estimated state of charge (0.0 to 1.0)
+     *
+     * Can be overwritten from outside, e.g. to reset the SOC if the battery is known to be full.
+     */
+    float soc;
+
+    /**
+     * Estimated voltage of the RC element (V)
+     */
+    float v_rc;
+
+    /**
+     * Estimated series resistance (Ohm)
+     */
+    float r0;
+
+private:
+    /**
+     * Open circuit voltage for given SOC
+     */
+    float ocv(float soc) const;
+
+    /**
+     * Derivative of the piecewise-linear OCV curve (V per 1.0 SOC)
+     */
+    float ocv_slope(float soc) const;
+
+    BatEkfModel model = {};
+
+    float P[BAT_EKF_NUM_STATES][BAT_EKF_NUM_STATES];    ///< Error covariance matrix
+
+    float meas_var;         ///< Variance of voltage measurement noise (V^2)
+};
+
+#endif /* BAT_EKF_H */
@@ -20,4 +20,10 @@
 #define BOARD_HAS_LOAD_OUTPUT   DT_NODE_EXISTS(DT_CHILD(DT_PATH(outputs), load))
 #define BOARD_HAS_USB_OUTPUT    DT_NODE_EXISTS(DT_CHILD(DT_PATH(outputs), usb_pwr))
 
+#if BOARD_HAS_DCDC
+#define HALF_BRIDGE_PHASES      DT_PROP(DT_INST(0, half_bridge), phases)
+#else
+#define HALF_BRIDGE_PHASES      1
+#endif
+
 #endif /* BOARD_H_ */
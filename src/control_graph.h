@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CONTROL_GRAPH_H_
+#define CONTROL_GRAPH_H_
+
+/**
+ * @file
+ *
+ * @brief Statically dispatched list of the power components of a board
+ */
+
+#include <stddef.h>
+
+/**
+ * Placeholder for a power component not existing on the board
+ *
+ * All functions are empty and inlined, so a NoComponent in a ControlGraph does not create any
+ * code or runtime checks.
+ */
+struct NoComponent
+{
+    static constexpr bool exists = false;
+
+    static inline void control() {}
+    static inline void energy_balance() {}
+    static inline bool charging() { return false; }
+};
+
+/**
+ * Control graph of the board
+ *
+ * Each component type must provide the following static members:
+ *
+ * - exists: true if the component is present on the board
+ * - control(): control function called in the control thread (10 Hz)
+ * - energy_balance(): energy calculation called exactly once per second
+ * - charging(): true if the component currently charges the battery
+ *
+ * The functions of all components are called in the order of the template parameters.
+ */
+template <typename... Components>
+struct ControlGraph
+{
+    /**
+     * Number of power components actually present on the board
+     */
+    static constexpr size_t size = (0 + ... + (Components::exists ? 1 : 0));
+
+    static inline void control()
+    {
+        (Components::control(), ...);
+    }
+
+    static inline void energy_balance()
+    {
+        (Components::energy_balance(), ...);
+    }
+
+    /**
+     * @returns true if any of the components is charging the battery
+     */
+    static inline bool charging()
+    {
+        return (false || ... || Components::charging());
+    }
+};
+
+#endif /* CONTROL_GRAPH_H_ */
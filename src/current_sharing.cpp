@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "current_sharing.h"
+
+#include <stddef.h>
+
+#include "helper.h"
+
+// resolution of current values in CAN frames (A)
+#define CURRENT_SHARING_CAN_RESOLUTION 0.01F
+
+void CurrentSharing::peer_update(uint8_t node_id, float peer_current, float peer_headroom)
+{
+    SharingPeer *entry = NULL;
+    uint32_t now = uptime();
+
+    for (int i = 0; i < CURRENT_SHARING_MAX_PEERS; i++) {
+        if (peers[i].valid && peers[i].node_id == node_id) {
+            entry = &peers[i];
+            break;
+        }
+        else if (entry == NULL &&
+            (!peers[i].valid || now - peers[i].time_received > timeout))
+        {
+            // free or outdated slot
+            entry = &peers[i];
+        }
+    }
+
+    if (entry != NULL) {
+        entry->node_id = node_id;
+        entry->valid = true;
+        entry->current = peer_current;
+        entry->headroom = peer_headroom;
+        entry->time_received = now;
+    }
+}
+
+void CurrentSharing::control(bool power_limited)
+{
+    current = port->current;
+    headroom = (power_limited || port->pos_current_limit < current) ?
+        0.0F : port->pos_current_limit - current;
+
+    // only units which could still increase their current take part in the balancing
+    float current_total = current;
+    float capability_total = current + headroom;
+    int num_units = 1;
+    uint32_t now = uptime();
+
+    for (int i = 0; i < CURRENT_SHARING_MAX_PEERS; i++) {
+        if (peers[i].valid) {
+            if (now - peers[i].time_received > timeout) {
+                peers[i].valid = false;
+            }
+            else if (peers[i].headroom > 0.0F) {
+                current_total += peers[i].current;
+                capability_total += peers[i].current + peers[i].headroom;
+                num_units++;
+            }
+        }
+    }
+
+    if (!enable || headroom <= 0.0F || num_units == 1) {
+        target_current = current;
+        port->bus->sink_voltage_offset = 0.0F;
+        return;
+    }
+
+    // each unit should contribute proportional to its capability
+    target_current = current_total * (current + headroom) / capability_total;
+
+    float offset = port->bus->sink_voltage_offset + gain * (target_current - current);
+    if (offset > 0.0F) {
+        offset = 0.0F;
+    }
+    else if (offset < -offset_max) {
+        offset = -offset_max;
+    }
+    port->bus->sink_voltage_offset = offset;
+}
+
+static inline void put_int16(uint8_t *data, float value)
+{
+    float scaled = value / CURRENT_SHARING_CAN_RESOLUTION;
+    int16_t raw;
+    if (scaled > INT16_MAX) {
+        raw = INT16_MAX;
+    }
+    else if (scaled < INT16_MIN) {
+        raw = INT16_MIN;
+    }
+    else {
+        raw = static_cast<int16_t>(scaled);
+    }
+    data[0] = static_cast<uint16_t>(raw) & 0xFF;
+    data[1] = static_cast<uint16_t>(raw) >> 8;
+}
+
+static inline float get_int16(const uint8_t *data)
+{
+    int16_t raw = static_cast<int16_t>(data[0] | (data[1] << 8));
+    return raw * CURRENT_SHARING_CAN_RESOLUTION;
+}
+
+int CurrentSharing::encode(uint8_t *data) const
+{
+    // little-endian signed 16-bit values in 10 mA resolution
+    put_int16(&data[0], current);
+    put_int16(&data[2], headroom);
+    return 4;
+}
+
+void CurrentSharing::decode(uint8_t node_id, const uint8_t *data, int len)
+{
+    if (len >= 4) {
+        peer_update(node_id, get_int16(&data[0]), get_int16(&data[2]));
+    }
+}
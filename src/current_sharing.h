@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CURRENT_SHARING_H
+#define CURRENT_SHARING_H
+
+/** @file
+ *
+ * @brief Current sharing between multiple charge controllers connected to the same battery
+ *
+ * Each unit publishes its output current and its current headroom (additional current it could
+ * deliver) via CAN. Based on the data of all units, the target share of each unit is calculated
+ * proportional to its current capability. Units delivering more than their share slowly decrease
+ * their voltage reference, so that the units with less current take over the load.
+ *
+ * Units which can't increase their current anymore (e.g. because of MPPT or current limits) keep
+ * their operating point and are excluded from the balancing.
+ *
+ * The voltage reference is only ever decreased, so the charge voltage set by the charger is
+ * never exceeded.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "power_port.h"
+
+/**
+ * Maximum number of other units considered for current sharing
+ */
+#define CURRENT_SHARING_MAX_PEERS 8
+
+/**
+ * Data of a unit connected to the same bus
+ */
+typedef struct {
+    uint8_t node_id;        ///< Node ID of the unit (e.g. ThingSet CAN node address)
+    bool valid;             ///< Flag to indicate that the entry is used
+    float current;          ///< Output current of the unit (A)
+    float headroom;         ///< Additional current the unit could deliver (A)
+    uint32_t time_received; ///< Timestamp of last update
+} SharingPeer;
+
+/**
+ * Current sharing controller
+ */
+class CurrentSharing
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param pwr_port Output port of this unit (e.g. the battery terminal)
+     */
+    CurrentSharing(PowerPort *pwr_port) :
+        port(pwr_port) {};
+
+    /**
+     * Stores data received from another unit
+     *
+     * @param node_id Node ID of the other unit
+     * @param current Output current of the other unit (A)
+     * @param headroom Additional current the other unit could deliver (A)
+     */
+    void peer_update(uint8_t node_id, float current, float headroom);
+
+    /**
+     * Adjusts the voltage offset of the bus, should be called in each control cycle
+     *
+     * @param power_limited True if this unit can't deliver more current, e.g. because MPPT is
+     *                      active or it is derating
+     */
+    void control(bool power_limited);
+
+    /**
+     * Encodes own current and headroom into the data of a CAN frame
+     *
+     * @param data Buffer with at least 4 bytes
+     *
+     * @returns Number of bytes used
+     */
+    int encode(uint8_t *data) const;
+
+    /**
+     * Decodes a CAN frame sent by another unit and stores the data
+     *
+     * @param node_id Node ID of the sending unit
+     * @param data Frame data
+     * @param len Length of frame data
+     */
+    void decode(uint8_t node_id, const uint8_t *data, int len);
+
+    /**
+     * Enable current sharing (if disabled, the voltage offset is reset)
+     */
+    bool enable = true;
+
+    /**
+     * Current of this unit as published to the other units (A)
+     */
+    float current;
+
+    /**
+     * Current headroom of this unit as published to the other units (A)
+     */
+    float headroom;
+
+    /**
+     * Target current of this unit calculated from the data of all units (A)
+     */
+    float target_current;
+
+    /**
+     * Change of voltage offset per control cycle and Ampere of current error (V/A)
+     */
+    float gain = 0.0005F;
+
+    /**
+     * Maximum reduction of the voltage reference for a single battery (V)
+     */
+    float offset_max = 0.5F;
+
+    /**
+     * Data is discarded if not updated for this period of time (s)
+     */
+    uint32_t timeout = 2;
+
+    /**
+     * Data received from other units
+     */
+    SharingPeer peers[CURRENT_SHARING_MAX_PEERS] = {};
+
+private:
+    PowerPort *port;
+};
+
+#endif /* CURRENT_SHARING_H */
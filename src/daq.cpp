@@ -31,6 +31,14 @@ LOG_MODULE_REGISTER(daq, CONFIG_DAQ_LOG_LEVEL);
 #if BOARD_HAS_DCDC
 static uint16_t dcdc_current_offset_raw;
 #endif
+#if HALF_BRIDGE_PHASES > 1 && DT_NODE_EXISTS(DT_CHILD(DT_PATH(adc_inputs), i_dcdc2))
+#define DCDC_HAS_PHASE_CURRENTS 1       // i_dcdc for first phase, i_dcdc2 for second phase
+static uint16_t dcdc2_current_offset_raw;
+#if HALF_BRIDGE_PHASES > 2
+// unmeasured phases would be seen with 0 A and driven to the maximum offset by phase balancing
+#error "Phase current measurement is only supported for 2 interleaved phases"
+#endif
+#endif
 #if BOARD_HAS_PWM_PORT
 static uint16_t pwm_current_offset_raw;
 #endif
@@ -44,6 +52,12 @@ volatile uint16_t adc_readings[NUM_ADC_CH] = {};
 // filtered raw readings left-shifted by additional adc_filter_const[channel] bits
 volatile uint32_t adc_filtered[NUM_ADC_CH] = {};
 
+// set by the DMA interrupt if the processed conversion was triggered in the PWM switch on-phase
+volatile bool adc_pwm_sync = false;
+
+// set by the DMA interrupt if the processed conversion was triggered by the 1 kHz timer
+volatile bool adc_timer_sync = true;
+
 static volatile AdcAlert adc_alerts_upper[NUM_ADC_CH] = {};
 static volatile AdcAlert adc_alerts_lower[NUM_ADC_CH] = {};
 
@@ -102,6 +116,9 @@ void calibrate_current_sensors()
 #if BOARD_HAS_DCDC
     dcdc_current_offset_raw = adc_raw_filtered(ADC_POS(i_dcdc));
 #endif
+#ifdef DCDC_HAS_PHASE_CURRENTS
+    dcdc2_current_offset_raw = adc_raw_filtered(ADC_POS(i_dcdc2));
+#endif
 #if BOARD_HAS_PWM_PORT
     pwm_current_offset_raw = adc_raw_filtered(ADC_POS(i_pwm));
 #endif
@@ -113,9 +130,13 @@ void calibrate_current_sensors()
 void adc_update_value(unsigned int pos)
 {
 #if BOARD_HAS_PWM_PORT
-    // only read input voltage and current when switch is on or permanently off
-    if ((pos != ADC_POS(v_pwm) && pos != ADC_POS(i_pwm)) ||
-        pwm_switch.signal_high() || pwm_switch.active() == false)
+    bool pwm_channel = (pos == ADC_POS(v_pwm) || pos == ADC_POS(i_pwm));
+
+    // while switching, input voltage and current are only valid for conversions synchronized
+    // with the on-phase of the PWM signal
+    if (pwm_channel ? (adc_pwm_sync || pwm_switch.active() == false) : adc_timer_sync)
+#else
+    if (adc_timer_sync)
 #endif
     {
         /*
@@ -137,6 +158,12 @@ void adc_update_value(unsigned int pos)
             adc_filtered[pos] - (adc_filtered[pos] >> adc_filter_const[pos]);
     }
 
+    if (!adc_timer_sync) {
+        // additional conversion for the PWM switch: alert debouncing and fast control of the
+        // load output are based on the 1 kHz sample rate of the timer-triggered conversions
+        return;
+    }
+
     // check upper alerts
     adc_alerts_upper[pos].debounce_ms++;
     if (adc_alerts_upper[pos].callback != NULL &&
@@ -165,6 +192,14 @@ void adc_update_value(unsigned int pos)
     else if (adc_alerts_lower[pos].debounce_ms > 0) {
         adc_alerts_lower[pos].debounce_ms = 0;
     }
+
+#if BOARD_HAS_LOAD_OUTPUT
+    if (pos == ADC_POS(i_load)) {
+        // unfiltered value needed for I²t fuse and soft-start current limitation
+        load.fast_control(adc_raw_to_voltage(adc_readings[pos] - load_current_offset_raw, VREF) *
+            ADC_GAIN(i_load));
+    }
+#endif
 }
 
 void daq_update()
@@ -202,8 +237,8 @@ void daq_update()
     float lv_terminal_current = -load_current;
 
 #if BOARD_HAS_PWM_PORT
-    // current multiplied with PWM duty cycle for PWM charger to get avg current for correct power
-    // calculation
+    // on-phase current multiplied with PWM duty cycle for PWM charger to get avg current for
+    // correct power calculation
     pwm_switch.current = -pwm_switch.get_duty_cycle() *
         adc_scaled(ADC_POS(i_pwm), vref, ADC_GAIN(i_pwm), pwm_current_offset_raw);
     pwm_switch.current_filtered = PWM_CURRENT_FILTER_CONST * pwm_switch.current +
@@ -215,8 +250,16 @@ void daq_update()
 #endif
 
 #if BOARD_HAS_DCDC
+#ifdef DCDC_HAS_PHASE_CURRENTS
+    dcdc.phase_current[0] =
+        adc_scaled(ADC_POS(i_dcdc), vref, ADC_GAIN(i_dcdc), dcdc_current_offset_raw);
+    dcdc.phase_current[1] =
+        adc_scaled(ADC_POS(i_dcdc2), vref, ADC_GAIN(i_dcdc2), dcdc2_current_offset_raw);
+    dcdc.inductor_current = dcdc.phase_current[0] + dcdc.phase_current[1];
+#else
     dcdc.inductor_current =
         adc_scaled(ADC_POS(i_dcdc), vref, ADC_GAIN(i_dcdc), dcdc_current_offset_raw);
+#endif
 
     lv_terminal_current += dcdc.inductor_current;
 
@@ -293,8 +336,15 @@ void lv_overvoltage_alert()
 void lv_undervoltage_alert()
 {
 #if BOARD_HAS_LOAD_OUTPUT
+    bool soft_start = (load.state == LOAD_STATE_SOFT_START);
+
     // the battery undervoltage must have been caused by a load current peak
-    load.stop(ERR_LOAD_VOLTAGE_DIP);
+    load.voltage_dip();
+
+    if (soft_start) {
+        // intended dip while charging the capacitance of the load, which would flood the log
+        return;
+    }
 #endif
 
     LOG_ERR("Low-side undervoltage alert, ADC reading: %d limit: %d\n",
@@ -123,6 +123,14 @@ void daq_setup(void);
  */
 void adc_update_value(unsigned int pos);
 
+/**
+ * Start ADC conversion synchronized with the PWM switch
+ *
+ * Called from the PWM timer interrupt in the center of the on-phase. While the switch is
+ * active, the PWM voltage and current readings are only updated from these conversions.
+ */
+void adc_trigger_pwm_sync(void);
+
 /**
  * Set lv side (battery) voltage limits where an alert should be triggered
  *
@@ -118,6 +118,20 @@ static const uint32_t table_seq_len[] = {
 
 // for ADC and DMA
 extern uint16_t adc_readings[];
+extern volatile bool adc_pwm_sync;
+extern volatile bool adc_timer_sync;
+
+// set if the ongoing conversion of the ADC was started in the on-phase of the PWM switch
+static volatile bool adc1_pwm_sync;
+#if defined(CONFIG_SOC_SERIES_STM32G4X)
+static volatile bool adc2_pwm_sync;
+#endif
+
+// set if the ongoing conversion of the ADC was requested by the 1 kHz timer
+static volatile bool adc1_timer_sync;
+#if defined(CONFIG_SOC_SERIES_STM32G4X)
+static volatile bool adc2_timer_sync;
+#endif
 
 void adc_update_value(unsigned int pos);
 
@@ -251,6 +265,14 @@ static void adc_setup()
 
 static inline void adc_trigger_conversion(struct k_timer *timer_id)
 {
+    if (timer_id != NULL) {
+        // also set if a PWM synchronized conversion is ongoing, which is used instead
+        adc1_timer_sync = true;
+#if defined(CONFIG_SOC_SERIES_STM32G4X)
+        adc2_timer_sync = true;
+#endif
+    }
+
     LL_ADC_REG_StartConversion(ADC1);
 
 #if defined(CONFIG_SOC_SERIES_STM32G4X)
@@ -258,12 +280,29 @@ static inline void adc_trigger_conversion(struct k_timer *timer_id)
 #endif
 }
 
+void adc_trigger_pwm_sync()
+{
+    // If a conversion is already ongoing, it was started less than one sequence duration
+    // (< 0.5 ms) before. As the on-phase lasts at least 1 ms and this function is called in
+    // its center, the ongoing conversion is also inside the on-phase and used instead.
+    adc1_pwm_sync = true;
+#if defined(CONFIG_SOC_SERIES_STM32G4X)
+    adc2_pwm_sync = true;
+#endif
+    adc_trigger_conversion(NULL);
+}
+
 static void DMA1_Channel1_IRQHandler(void *args)
 {
     ARG_UNUSED(args);
 
     if ((DMA1->ISR & DMA_ISR_TCIF1) != 0) // Test if transfer completed on DMA channel 1
     {
+        // both DMA interrupts have the same priority, so they can share the flag
+        adc_pwm_sync = adc1_pwm_sync;
+        adc_timer_sync = adc1_timer_sync;
+        adc1_pwm_sync = false;
+        adc1_timer_sync = false;
         for (unsigned int i = 0; i < num_adc1_ch; i++) {
             adc_update_value(i);
         }
@@ -275,6 +314,10 @@ static void DMA1_Channel1_IRQHandler(void *args)
 static void DMA2_Channel1_IRQHandler(void *args)
 {
     if ((DMA2->ISR & DMA_ISR_TCIF1) != 0) { // Test if transfer completed on DMA channel 2
+        adc_pwm_sync = adc2_pwm_sync;
+        adc_timer_sync = adc2_timer_sync;
+        adc2_pwm_sync = false;
+        adc2_timer_sync = false;
         for (unsigned int i = num_adc1_ch; i < num_adc1_ch + num_adc2_ch; i++) {
             adc_update_value(i);
         }
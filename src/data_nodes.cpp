@@ -48,13 +48,37 @@ static char auth_password[11];
 #define solar_bus lv_bus
 #endif
 
-bool pub_serial_enable = IS_ENABLED(CONFIG_THINGSET_SERIAL_PUB_DEFAULT);
+PubChannel pub_ser_channels[PUB_SER_CHANNELS] = {
+    PubChannel(PUB_SER, IS_ENABLED(CONFIG_THINGSET_SERIAL_PUB_DEFAULT), 1000),
+    PubChannel(PUB_SER_FAST, false, 100),
+    PubChannel(PUB_SER_SLOW, false, 60000),
+};
 
 #if CONFIG_THINGSET_CAN
-bool pub_can_enable = IS_ENABLED(CONFIG_THINGSET_CAN_PUB_DEFAULT);
+PubChannel pub_can_channels[PUB_CAN_CHANNELS] = {
+    PubChannel(PUB_CAN, IS_ENABLED(CONFIG_THINGSET_CAN_PUB_DEFAULT), 1000),
+    PubChannel(PUB_CAN_FAST, false, 100),
+    PubChannel(PUB_CAN_SLOW, false, 60000),
+};
+
 uint16_t can_node_addr = CONFIG_THINGSET_CAN_DEFAULT_NODE_ID;
 #endif
 
+static ArrayInfo ocv_points_arr = {
+    bat_conf_user.ocv_points, OCV_TABLE_POINTS, OCV_TABLE_POINTS, TS_T_FLOAT32
+};
+
+static ArrayInfo ocv_points_cold_arr = {
+    bat_conf_user.ocv_points_cold, OCV_TABLE_POINTS, OCV_TABLE_POINTS, TS_T_FLOAT32
+};
+
+// OCV tables of built-in battery types are fixed, only custom types may change them
+#if CONFIG_BAT_TYPE_CUSTOM
+#define OCV_TABLE_ACCESS (TS_ANY_R | TS_ANY_W)
+#else
+#define OCV_TABLE_ACCESS (TS_ANY_R)
+#endif
+
 /**
  * Data Objects
  *
@@ -63,7 +87,7 @@ uint16_t can_node_addr = CONFIG_THINGSET_CAN_DEFAULT_NODE_ID;
  *
  * Normal priority data objects (consuming 2 or more bytes) start from IDs > 23 = 0x17
  */
-static DataNode data_nodes[] = {
+DataNode data_nodes[] = {
 
     // DEVICE INFORMATION /////////////////////////////////////////////////////
     // using IDs >= 0x18
@@ -161,6 +185,12 @@ static DataNode data_nodes[] = {
     TS_NODE_FLOAT(0x47, "BatDisMin_degC", &bat_conf_user.discharge_temp_min, 1,
         ID_CONF, TS_ANY_R | TS_ANY_W, PUB_NVM),
 
+    TS_NODE_ARRAY(0x48, "BatOcvPoints_V", &ocv_points_arr, 3,
+        ID_CONF, OCV_TABLE_ACCESS, PUB_NVM),
+
+    TS_NODE_ARRAY(0x49, "BatOcvPointsCold_V", &ocv_points_cold_arr, 3,
+        ID_CONF, OCV_TABLE_ACCESS, PUB_NVM),
+
     // load settings
 #if BOARD_HAS_LOAD_OUTPUT
     TS_NODE_BOOL(0x50, "LoadEnDefault", &load.enable,
@@ -177,6 +207,12 @@ static DataNode data_nodes[] = {
 
     TS_NODE_INT32(0x54, "LoadUVRecovery_s", &load.lvd_recovery_delay,
         ID_CONF, TS_ANY_R | TS_ANY_W, PUB_NVM),
+
+    TS_NODE_UINT32(0x5A, "LoadSoftStart_ms", &load.soft_start_time,
+        ID_CONF, TS_ANY_R | TS_ANY_W, PUB_NVM),
+
+    TS_NODE_FLOAT(0x5B, "LoadFuseI2t_A2s", &load.fuse.i2t, 1,
+        ID_CONF, TS_ANY_R | TS_ANY_W, PUB_NVM),
 #endif
 
 #if BOARD_HAS_USB_OUTPUT
@@ -198,6 +234,45 @@ static DataNode data_nodes[] = {
         ID_CONF, TS_ANY_R | TS_ANY_W, PUB_NVM),
 #endif
 
+#if HAS_LOAD_MANAGER
+    TS_NODE_UINT32(0x5C, "LoadStagger_s", &load_manager.reconnect_stagger,
+        ID_CONF, TS_ANY_R | TS_ANY_W, PUB_NVM),
+#endif
+
+    // load shedding settings of each output
+
+#if BOARD_HAS_LOAD_OUTPUT
+    TS_NODE_PATH(ID_LOAD_EXT, "load_shedding", ID_CONF, &data_nodes_update_conf),
+    TS_NODE_UINT16(ID_LOAD_EXT + 1, "Priority", &load_channels[LOAD_CHANNEL_LOAD].priority,
+        ID_LOAD_EXT, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 2, "DisconnectSOC_pct",
+        &load_channels[LOAD_CHANNEL_LOAD].soc_disconnect,
+        ID_LOAD_EXT, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 3, "ReconnectSOC_pct",
+        &load_channels[LOAD_CHANNEL_LOAD].soc_reconnect,
+        ID_LOAD_EXT, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 4, "OffStart_min", &load_channels[LOAD_CHANNEL_LOAD].off_start,
+        ID_LOAD_EXT, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 5, "OffEnd_min", &load_channels[LOAD_CHANNEL_LOAD].off_end,
+        ID_LOAD_EXT, TS_ANY_R | TS_ANY_W, PUB_NVM),
+#endif
+
+#if BOARD_HAS_USB_OUTPUT
+    TS_NODE_PATH(ID_LOAD_EXT + 8, "usb_shedding", ID_CONF, &data_nodes_update_conf),
+    TS_NODE_UINT16(ID_LOAD_EXT + 9, "Priority", &load_channels[LOAD_CHANNEL_USB].priority,
+        ID_LOAD_EXT + 8, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 10, "DisconnectSOC_pct",
+        &load_channels[LOAD_CHANNEL_USB].soc_disconnect,
+        ID_LOAD_EXT + 8, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 11, "ReconnectSOC_pct",
+        &load_channels[LOAD_CHANNEL_USB].soc_reconnect,
+        ID_LOAD_EXT + 8, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 12, "OffStart_min", &load_channels[LOAD_CHANNEL_USB].off_start,
+        ID_LOAD_EXT + 8, TS_ANY_R | TS_ANY_W, PUB_NVM),
+    TS_NODE_UINT16(ID_LOAD_EXT + 13, "OffEnd_min", &load_channels[LOAD_CHANNEL_USB].off_end,
+        ID_LOAD_EXT + 8, TS_ANY_R | TS_ANY_W, PUB_NVM),
+#endif
+
     // INPUT DATA /////////////////////////////////////////////////////////////
     // using IDs >= 0x60
 
@@ -229,6 +304,24 @@ static DataNode data_nodes[] = {
 
     TS_NODE_FLOAT(0x66, "GridSrc_V", &hv_bus.src_voltage_intercept, 2,
         ID_INPUT, TS_ANY_R | TS_ANY_W, 0),
+
+    TS_NODE_FLOAT(0x67, "GridSinkDroop_Ohm", &hv_bus.sink_droop_res, 3,
+        ID_INPUT, TS_ANY_R | TS_ANY_W, 0),
+
+    TS_NODE_FLOAT(0x68, "GridSrcDroop_Ohm", &hv_bus.src_droop_res, 3,
+        ID_INPUT, TS_ANY_R | TS_ANY_W, 0),
+
+    TS_NODE_FLOAT(0x69, "GridExportMax_W", &dcdc.grid_export_power_max, 0,
+        ID_INPUT, TS_ANY_R | TS_ANY_W, 0),
+
+    TS_NODE_FLOAT(0x6A, "GridImportMax_W", &dcdc.grid_import_power_max, 0,
+        ID_INPUT, TS_ANY_R | TS_ANY_W, 0),
+#endif
+
+#if HAS_LOAD_MANAGER
+    // must be set by a gateway for time-based load shedding (no RTC available)
+    TS_NODE_UINT32(0x6B, "TimeOfDay_s", &load_manager.time_of_day,
+        ID_INPUT, TS_ANY_R | TS_ANY_W, 0),
 #endif
 
     // OUTPUT DATA ////////////////////////////////////////////////////////////
@@ -242,10 +335,10 @@ static DataNode data_nodes[] = {
 
     // battery related data objects
     TS_NODE_FLOAT(0x71, "Bat_V", &bat_bus.voltage, 2,
-        ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
+        ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN | PUB_SER_FAST | PUB_CAN_FAST),
 
     TS_NODE_FLOAT(0x72, "Bat_A", &bat_terminal.current, 2,
-        ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
+        ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN | PUB_SER_FAST | PUB_CAN_FAST),
 
     TS_NODE_FLOAT(0x73, "Bat_W", &bat_terminal.power, 2,
         ID_OUTPUT, TS_ANY_R, 0),
@@ -292,12 +385,12 @@ static DataNode data_nodes[] = {
         ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
 #endif
 
-#if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
+#if HAS_SOLAR_TERMINAL
     TS_NODE_FLOAT(0x81, "Solar_A", &solar_terminal.current, 2,
         ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
 #endif
 
-#if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
+#if HAS_SOLAR_TERMINAL
     TS_NODE_FLOAT(0x82, "Solar_W", &solar_terminal.power, 2,
         ID_OUTPUT, TS_ANY_R, 0),
 #endif
@@ -311,6 +404,12 @@ static DataNode data_nodes[] = {
 
     TS_NODE_INT32(0x8B, "LoadInfo", &load.info,
         ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
+
+    TS_NODE_FLOAT(0x8D, "LoadInrushPeak_A", &load.inrush_current_peak, 1,
+        ID_OUTPUT, TS_ANY_R, 0),
+
+    TS_NODE_UINT32(0x8E, "LoadInrushDuration_ms", &load.inrush_duration,
+        ID_OUTPUT, TS_ANY_R, 0),
 #endif
 
 #if BOARD_HAS_USB_OUTPUT
@@ -329,6 +428,23 @@ static DataNode data_nodes[] = {
         ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
 #endif
 
+#if HAS_ENERGY_FORECAST
+    TS_NODE_UINT32(0x93, "TimeToEmpty_s", &energy_forecast.time_to_empty,
+        ID_OUTPUT, TS_ANY_R, 0),
+
+    TS_NODE_UINT32(0x94, "TimeToSunrise_s", &energy_forecast.time_to_sunrise,
+        ID_OUTPUT, TS_ANY_R, 0),
+
+    TS_NODE_FLOAT(0x95, "EnergyUsable_Wh", &energy_forecast.energy_usable, 1,
+        ID_OUTPUT, TS_ANY_R, 0),
+
+    TS_NODE_FLOAT(0x96, "EnergyRequired_Wh", &energy_forecast.energy_required, 1,
+        ID_OUTPUT, TS_ANY_R, 0),
+
+    TS_NODE_BOOL(0x97, "LoadReduction", &energy_forecast.reduce_loads,
+        ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
+#endif
+
     TS_NODE_UINT32(0x9F, "ErrorFlags", &dev_stat.error_flags,
         ID_OUTPUT, TS_ANY_R, PUB_SER | PUB_CAN),
 
@@ -339,26 +455,26 @@ static DataNode data_nodes[] = {
 
     // accumulated data
     TS_NODE_UINT32(0x08, "SolarInTotal_Wh", &dev_stat.solar_in_total_Wh,
-        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM | PUB_SER_SLOW | PUB_CAN_SLOW),
 
 #if BOARD_HAS_LOAD_OUTPUT
     TS_NODE_UINT32(0x09, "LoadOutTotal_Wh", &dev_stat.load_out_total_Wh,
-        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM | PUB_SER_SLOW | PUB_CAN_SLOW),
 #endif
 
 #if CONFIG_HV_TERMINAL_NANOGRID
     TS_NODE_UINT32(0xC1, "GridImportTotal_Wh", &dev_stat.grid_import_total_Wh,
-        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM | PUB_SER_SLOW | PUB_CAN_SLOW),
 
     TS_NODE_UINT32(0xC2, "GridExportTotal_Wh", &dev_stat.grid_export_total_Wh,
-        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM | PUB_SER_SLOW | PUB_CAN_SLOW),
 #endif
 
     TS_NODE_UINT32(0x0A, "BatChgTotal_Wh", &dev_stat.bat_chg_total_Wh,
-        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM | PUB_SER_SLOW | PUB_CAN_SLOW),
 
     TS_NODE_UINT32(0x0B, "BatDisTotal_Wh", &dev_stat.bat_dis_total_Wh,
-        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM | PUB_SER_SLOW | PUB_CAN_SLOW),
 
     TS_NODE_UINT16(0x0C, "FullChgCount", &charger.num_full_charges,
         ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
@@ -377,7 +493,7 @@ static DataNode data_nodes[] = {
         ID_REC, TS_ANY_R | TS_MKR_W, 0),
 #endif
 
-#if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
+#if HAS_SOLAR_TERMINAL
     TS_NODE_FLOAT(0xA1, "SolarInDay_Wh", &solar_terminal.neg_energy_Wh, 2,
         ID_REC, TS_ANY_R | TS_MKR_W, PUB_SER | PUB_CAN),
 #endif
@@ -402,6 +518,14 @@ static DataNode data_nodes[] = {
     TS_NODE_UINT32(0xA7, "DayCount", &dev_stat.day_counter,
         ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
 
+#if HAS_ENERGY_FORECAST
+    TS_NODE_FLOAT(0xA8, "NightEnergy_Wh", &energy_forecast.night_energy, 1,
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_UINT32(0xA9, "NightDuration_s", &energy_forecast.night_duration,
+        ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
+#endif
+
     // min/max recordings
     TS_NODE_UINT16(0xB1, "SolarMaxTotal_W", &dev_stat.solar_power_max_total,
         ID_REC, TS_ANY_R | TS_MKR_W, PUB_NVM),
@@ -448,6 +572,24 @@ static DataNode data_nodes[] = {
 
     TS_NODE_UINT32(0xD3, "DcdcRestart_s", &dcdc.restart_interval,
         ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_UINT32(0xD4, "DcdcRestartMin_s", &dcdc.restart.interval_min,
+        ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_FLOAT(0xD5, "DcdcBurst_W", &dcdc.burst_power, 1,
+        ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_UINT16(0xD6, "DcdcFreqMin_kHz", &dcdc.freq_min,
+        ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_UINT16(0xD7, "DcdcFreqMax_kHz", &dcdc.freq_max,
+        ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_UINT16(0xD8, "DcdcDeadtime_ns", &dcdc.deadtime,
+        ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
+
+    TS_NODE_FLOAT(0xD9, "DcdcDiodeEmulation_A", &dcdc.diode_emulation_current, 2,
+        ID_CAL, TS_ANY_R | TS_MKR_W, PUB_NVM),
 #endif
 
     // FUNCTION CALLS (EXEC) //////////////////////////////////////////////////
@@ -467,17 +609,55 @@ static DataNode data_nodes[] = {
 
     TS_NODE_PATH(ID_PUB, "pub", 0, NULL),
 
-    TS_NODE_PATH(0xF1, "serial", ID_PUB, NULL),
-    TS_NODE_BOOL(0xF2, "Enable", &pub_serial_enable, 0xF1, TS_ANY_RW, 0),
+    TS_NODE_PATH(0xF1, "serial", ID_PUB, &data_nodes_update_pub),
+    TS_NODE_BOOL(0xF2, "Enable", &pub_ser_channels[0].enable, 0xF1, TS_ANY_RW, 0),
     TS_NODE_PUBSUB(0xF3, "IDs", PUB_SER, 0xF1, TS_ANY_RW, 0),
+    TS_NODE_UINT32(0xF4, "Interval_ms", &pub_ser_channels[0].interval,
+        0xF1, TS_ANY_RW, PUB_NVM),
 
 #if CONFIG_THINGSET_CAN
-    TS_NODE_PATH(0xF5, "can", ID_PUB, NULL),
-    TS_NODE_BOOL(0xF6, "Enable", &pub_can_enable, 0xF5, TS_ANY_RW, 0),
+    TS_NODE_PATH(0xF5, "can", ID_PUB, &data_nodes_update_pub),
+    TS_NODE_BOOL(0xF6, "Enable", &pub_can_channels[0].enable, 0xF5, TS_ANY_RW, 0),
     TS_NODE_PUBSUB(0xF7, "IDs", PUB_CAN, 0xF5, TS_ANY_RW, 0),
+    TS_NODE_UINT32(0xF8, "Interval_ms", &pub_can_channels[0].interval,
+        0xF5, TS_ANY_RW, PUB_NVM),
+#endif
+
+    // additional channels with different intervals, disabled by default
+
+    TS_NODE_PATH(ID_PUB_EXT, "serial_fast", ID_PUB, &data_nodes_update_pub),
+    TS_NODE_BOOL(ID_PUB_EXT + 1, "Enable", &pub_ser_channels[1].enable,
+        ID_PUB_EXT, TS_ANY_RW, 0),
+    TS_NODE_PUBSUB(ID_PUB_EXT + 2, "IDs", PUB_SER_FAST, ID_PUB_EXT, TS_ANY_RW, 0),
+    TS_NODE_UINT32(ID_PUB_EXT + 3, "Interval_ms", &pub_ser_channels[1].interval,
+        ID_PUB_EXT, TS_ANY_RW, PUB_NVM),
+
+    TS_NODE_PATH(ID_PUB_EXT + 4, "serial_slow", ID_PUB, &data_nodes_update_pub),
+    TS_NODE_BOOL(ID_PUB_EXT + 5, "Enable", &pub_ser_channels[2].enable,
+        ID_PUB_EXT + 4, TS_ANY_RW, 0),
+    TS_NODE_PUBSUB(ID_PUB_EXT + 6, "IDs", PUB_SER_SLOW, ID_PUB_EXT + 4, TS_ANY_RW, 0),
+    TS_NODE_UINT32(ID_PUB_EXT + 7, "Interval_ms", &pub_ser_channels[2].interval,
+        ID_PUB_EXT + 4, TS_ANY_RW, PUB_NVM),
+
+#if CONFIG_THINGSET_CAN
+    TS_NODE_PATH(ID_PUB_EXT + 8, "can_fast", ID_PUB, &data_nodes_update_pub),
+    TS_NODE_BOOL(ID_PUB_EXT + 9, "Enable", &pub_can_channels[1].enable,
+        ID_PUB_EXT + 8, TS_ANY_RW, 0),
+    TS_NODE_PUBSUB(ID_PUB_EXT + 10, "IDs", PUB_CAN_FAST, ID_PUB_EXT + 8, TS_ANY_RW, 0),
+    TS_NODE_UINT32(ID_PUB_EXT + 11, "Interval_ms", &pub_can_channels[1].interval,
+        ID_PUB_EXT + 8, TS_ANY_RW, PUB_NVM),
+
+    TS_NODE_PATH(ID_PUB_EXT + 12, "can_slow", ID_PUB, &data_nodes_update_pub),
+    TS_NODE_BOOL(ID_PUB_EXT + 13, "Enable", &pub_can_channels[2].enable,
+        ID_PUB_EXT + 12, TS_ANY_RW, 0),
+    TS_NODE_PUBSUB(ID_PUB_EXT + 14, "IDs", PUB_CAN_SLOW, ID_PUB_EXT + 12, TS_ANY_RW, 0),
+    TS_NODE_UINT32(ID_PUB_EXT + 15, "Interval_ms", &pub_can_channels[2].interval,
+        ID_PUB_EXT + 12, TS_ANY_RW, PUB_NVM),
 #endif
 };
 
+const size_t num_data_nodes = sizeof(data_nodes)/sizeof(DataNode);
+
 ThingSet ts(data_nodes, sizeof(data_nodes)/sizeof(DataNode));
 
 void data_nodes_update_conf()
@@ -506,6 +686,18 @@ void data_nodes_update_conf()
     }
 }
 
+void data_nodes_update_pub()
+{
+    for (int i = 0; i < PUB_SER_CHANNELS; i++) {
+        pub_ser_channels[i].nodes_changed = true;
+    }
+#if CONFIG_THINGSET_CAN
+    for (int i = 0; i < PUB_CAN_CHANNELS; i++) {
+        pub_can_channels[i].nodes_changed = true;
+    }
+#endif
+}
+
 void data_nodes_init()
 {
 #ifndef UNIT_TEST
@@ -15,6 +15,9 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "pub_channel.h"
+#include "thingset.h"
+
 /*
  * Categories / first layer node IDs
  */
@@ -30,6 +33,8 @@
 #define ID_PUB      0xF0        // publication setup
 #define ID_SUB      0xF1        // subscription setup
 #define ID_LOG      0x100       // access log data
+#define ID_LOAD_EXT 0x1D0       // load shedding settings (8 IDs per load output)
+#define ID_PUB_EXT  0x1F0       // additional publication channels (4 IDs per channel)
 
 /*
  * Publish/subscribe channels
@@ -37,6 +42,16 @@
 #define PUB_SER     (1U << 0)   // UART serial
 #define PUB_CAN     (1U << 1)   // CAN bus
 #define PUB_NVM     (1U << 2)   // data that should be stored in EEPROM
+#define PUB_SER_FAST (1U << 3)  // UART serial, high-rate channel
+#define PUB_SER_SLOW (1U << 4)  // UART serial, low-rate channel
+#define PUB_CAN_FAST (1U << 5)  // CAN bus, high-rate channel
+#define PUB_CAN_SLOW (1U << 6)  // CAN bus, low-rate channel
+
+/*
+ * Number of publication channels per interface (default, fast and slow)
+ */
+#define PUB_SER_CHANNELS 3
+#define PUB_CAN_CHANNELS 3
 
 /*
  * Data node versioning for EEPROM
@@ -46,14 +61,22 @@
  */
 #define DATA_NODES_VERSION 4
 
-extern bool pub_serial_enable;
-extern bool pub_can_enable;
+extern PubChannel pub_ser_channels[PUB_SER_CHANNELS];
+extern PubChannel pub_can_channels[PUB_CAN_CHANNELS];
+
+extern DataNode data_nodes[];   ///< Table used by the ThingSet library, defined in data_nodes.cpp
+extern const size_t num_data_nodes;
 
 /**
  * Callback function to be called when conf values were changed
  */
 void data_nodes_update_conf();
 
+/**
+ * Callback function to be called when publication channels were changed
+ */
+void data_nodes_update_pub();
+
 /**
  * Initializes and reads data nodes from EEPROM
  */
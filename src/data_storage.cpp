@@ -25,7 +25,7 @@ LOG_MODULE_REGISTER(nvs, CONFIG_DATA_STORAGE_LOG_LEVEL);
 K_MUTEX_DEFINE(data_buf_lock);
 
 // Buffer used by store and restore functions (must be word-aligned for hardware CRC calculation)
-static uint8_t buf[512] __aligned(sizeof(uint32_t));
+static uint8_t buf[DATA_STORAGE_BUF_SIZE] __aligned(sizeof(uint32_t));
 
 extern ThingSet ts;
 
@@ -69,6 +69,8 @@ uint32_t _calc_crc(const uint8_t *buf, size_t len)
  */
 #define EEPROM_HEADER_SIZE 8
 
+static_assert(EEPROM_HEADER_SIZE <= DATA_STORAGE_HEADER_MAX, "header too large");
+
 void data_storage_read()
 {
     int err;
@@ -162,6 +164,8 @@ void data_storage_write()
  */
 #define NVS_HEADER_SIZE 2
 
+static_assert(NVS_HEADER_SIZE <= DATA_STORAGE_HEADER_MAX, "header too large");
+
 #define FLASH_PARTITION_NODE DT_NODE_BY_FIXED_PARTITION_LABEL(storage)
 #define FLASH_DEVICE_NODE DT_MTD_FROM_FIXED_PARTITION(FLASH_PARTITION_NODE)
 
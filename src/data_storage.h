@@ -9,6 +9,13 @@
 
 #define DATA_UPDATE_INTERVAL  (6*60*60)       // update every 6 hours
 
+/*
+ * Buffer for the serialized PUB_NVM data nodes including the header (8 bytes for EEPROM, 2 bytes
+ * for NVS). Must be a multiple of 4 for the hardware CRC calculation.
+ */
+#define DATA_STORAGE_BUF_SIZE       768
+#define DATA_STORAGE_HEADER_MAX     8
+
 /**
  * @file
  *
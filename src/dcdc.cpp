@@ -34,6 +34,69 @@ extern DeviceStatus dev_stat;
 #define HV_OUT_NODE DT_CHILD(DT_PATH(outputs), hv_out)
 #endif
 
+// current error (A) corresponding to one minimum PWM step in nanogrid droop control
+#define DCDC_DROOP_CURRENT_STEP 0.2F
+
+// maximum number of PWM steps per control cycle in nanogrid droop control
+#define DCDC_DROOP_STEPS_MAX 10
+
+// PWM steps per control cycle while reversing the power flow in auto mode
+#define DCDC_REVERSAL_STEPS 5
+
+// output voltage above the target (relative) that triggers a power flow reversal in auto mode
+#define DCDC_REVERSAL_HYST 0.01F
+
+// minimum change of the switching frequency (kHz) to prevent frequent updates
+#define DCDC_FREQ_STEP 5
+
+// factor of the diode emulation threshold to switch the synchronous rectifier on again
+#define DCDC_DIODE_EMULATION_HYST 2.0F
+
+// factor of the burst power above which burst mode is left again
+#define DCDC_BURST_HYST 1.2F
+
+// current deviation from the average of all phases (A) that is tolerated without balancing
+#define DCDC_PHASE_CURRENT_DEADBAND 0.2F
+
+// maximum CCR offset for phase current balancing (fraction of the period)
+#define DCDC_PHASE_OFFSET_MAX 0.05F
+
+// resolution of one PWM step in the control algorithms (steps per switching period)
+#define DCDC_PWM_STEPS_PER_PERIOD 800
+
+/*
+ * Minimum PWM step of the control algorithms in timer counts
+ *
+ * Timers clocked with the system clock (TIM1, TIM3) keep their fixed step. The high
+ * resolution timer (HRTIM) would need too many control cycles to reach the target if the CCR
+ * was changed by a single count, so the step is derived from the actual period instead.
+ *
+ * The derived step is scaled with the period so that the duty cycle resolution at the maximum
+ * frequency is kept if the frequency is reduced at low load. Otherwise the control (e.g. during
+ * a power flow reversal) would get slower at lower frequencies.
+ */
+static int pwm_step(int freq_max)
+{
+    int step_fixed = half_bridge_get_ccr_step();
+    if (step_fixed > 0) {
+        return step_fixed;
+    }
+
+    int arr = half_bridge_get_arr();
+    int freq = half_bridge_get_frequency();
+    if (freq <= 0 || freq >= freq_max) {
+        int step = arr / DCDC_PWM_STEPS_PER_PERIOD;
+        return (step > 1) ? step : 1;
+    }
+
+    // step at maximum frequency, scaled up for the longer period at the actual frequency
+    int step = arr * freq / freq_max / DCDC_PWM_STEPS_PER_PERIOD;
+    if (step < 1) {
+        step = 1;
+    }
+    return (step * freq_max + freq / 2) / freq;
+}
+
 Dcdc::Dcdc(DcBus *high, DcBus *low, DcdcOperationMode op_mode)
 {
     hvb = high;
@@ -41,18 +104,33 @@ Dcdc::Dcdc(DcBus *high, DcBus *low, DcdcOperationMode op_mode)
     mode           = op_mode;
     enable         = true;
     state          = DCDC_CONTROL_OFF;
+    active_mode    = DCDC_MODE_OFF;
+    reversing      = false;
     inductor_current_max = DT_PROP(DT_PATH(pcb), dcdc_current_max);
     hs_voltage_max = DT_PROP(DT_PATH(pcb), hs_voltage_max);
     ls_voltage_max = DT_PROP(DT_PATH(pcb), ls_voltage_max);
     ls_voltage_min = 9.0;
     output_power_min = 1;         // switch off if power < 1 W
+    burst_power = 5;              // burst mode if power < 5 W
+    burst_power_min = 0.3;        // switch off in burst mode if power < 0.3 W
+    diode_emulation_current = 0.1;    // synchronous rectifier off if current < 0.1 A
+    grid_export_power_max = 200;  // nanogrid limits, adjustable via ThingSet
+    grid_import_power_max = 200;
     restart_interval = 60;
     off_timestamp = -10000;       // start immediately
     pwm_delta = 1;                // start-condition of duty cycle pwr_inc_pwm_direction
 
+    // frequency is halved at light load
+    freq_max = DT_PROP(DT_INST(0, half_bridge), frequency) / 1000;
+    freq_min = freq_max / 2;
+    deadtime = DT_PROP(DT_INST(0, half_bridge), deadtime);
+
+    for (int i = 0; i < HALF_BRIDGE_PHASES; i++) {
+        phase_current[i] = 0;
+    }
+
     // lower duty limit might have to be adjusted dynamically depending on LS voltage
-    half_bridge_init(DT_PROP(DT_INST(0, half_bridge), frequency) / 1000,
-        DT_PROP(DT_INST(0, half_bridge), deadtime), 12 / hs_voltage_max, 0.97);
+    half_bridge_init(freq_max, deadtime, 12 / hs_voltage_max, 0.97);
 }
 
 int Dcdc::perturb_observe_controller()
@@ -62,7 +140,7 @@ int Dcdc::perturb_observe_controller()
     DcBus *out;
     float out_power;
 
-    if (mode == DCDC_MODE_BUCK || (mode == DCDC_MODE_AUTO && inductor_current > 0.1)) {
+    if (mode == DCDC_MODE_BUCK || (mode == DCDC_MODE_AUTO && active_mode == DCDC_MODE_BUCK)) {
         // buck mode
         pwr_inc_pwm_direction = 1;
         in = hvb;
@@ -78,7 +156,28 @@ int Dcdc::perturb_observe_controller()
     }
 
     if (out_power >= output_power_min) {
+        power_good = true;
+    }
+
+    // burst mode is only entered after the power was good once, as the output power is close
+    // to zero directly after the start
+    if (burst_power > 0 && power_good &&
+        (out_power < burst_power || (burst && out_power < burst_power * DCDC_BURST_HYST)))
+    {
+        // run at burst_power during the bursts, as the input capacitor stores the energy
+        // in between
+        half_bridge_set_burst_duty(out_power / burst_power);
+        burst = true;
+    }
+    else {
+        half_bridge_set_burst_duty(1.0F);
+        burst = false;
+    }
+
+    // switching losses are reduced in burst mode, so lower power is still worth it
+    if (out_power >= (burst ? burst_power_min : output_power_min)) {
         power_good_timestamp = uptime();     // reset the time
+        restart.power_good();
     }
 
     int pwr_inc_goal = 0;     // stores if we want to increase (+1) or decrease (-1) power
@@ -142,47 +241,262 @@ int Dcdc::perturb_observe_controller()
 
     power_prev = out_power;
 
-#ifdef CONFIG_SOC_SERIES_STM32G4X
-    // reduced step size for fast microcontroller
-    half_bridge_set_ccr(half_bridge_get_ccr() + pwr_inc_goal * pwr_inc_pwm_direction * 3);
-#else
     // change duty cycle by single minimum step
-    half_bridge_set_ccr(half_bridge_get_ccr() + pwr_inc_goal * pwr_inc_pwm_direction);
-#endif
+    half_bridge_set_ccr(half_bridge_get_ccr() +
+        pwr_inc_goal * pwr_inc_pwm_direction * pwm_step(freq_max));
 
     return (pwr_inc_goal == 0);
 }
 
+int Dcdc::droop_controller()
+{
+    // prevent division by zero during start-up of a nanogrid
+    float grid_voltage = (hvb->voltage > 1.0F) ? hvb->voltage : 1.0F;
+
+    // current supplied to the grid (positive) or drawn from it (negative) and current into the
+    // battery, both calculated from the measured low-side power
+    float grid_current = -power / grid_voltage;
+    float bat_current = power / lvb->voltage;
+
+    float export_max = grid_export_power_max / grid_voltage;
+    float import_max = grid_import_power_max / grid_voltage;
+
+    // current limits of the grid port
+    if (export_max > grid_current + hvb->sink_current_margin) {
+        export_max = grid_current + hvb->sink_current_margin;
+    }
+    if (import_max > -(grid_current + hvb->src_current_margin)) {
+        import_max = -(grid_current + hvb->src_current_margin);
+    }
+
+    // limits of the low side converted to the high side current
+    float export_max_ls = -(bat_current + lvb->src_current_margin) * lvb->voltage / grid_voltage;
+    float import_max_ls = (bat_current + lvb->sink_current_margin) * lvb->voltage / grid_voltage;
+    float hw_current_max = inductor_current_max * lvb->voltage / grid_voltage;
+
+    if (lvb->voltage < lvb->src_control_voltage()) {
+        export_max_ls = 0;
+    }
+    if (lvb->voltage > lvb->sink_control_voltage()) {
+        import_max_ls = 0;
+    }
+
+    state = DCDC_CONTROL_CV_HS;
+    grid_current_target = hvb->droop_current();
+
+    if (grid_current_target > export_max) {
+        state = DCDC_CONTROL_CC_HS;
+        grid_current_target = export_max;
+    }
+    else if (grid_current_target < -import_max) {
+        state = DCDC_CONTROL_CC_HS;
+        grid_current_target = -import_max;
+    }
+
+    if (grid_current_target > export_max_ls) {
+        state = DCDC_CONTROL_CC_LS;
+        grid_current_target = (export_max_ls > 0) ? export_max_ls : 0;
+    }
+    else if (grid_current_target < -import_max_ls) {
+        state = DCDC_CONTROL_CC_LS;
+        grid_current_target = (import_max_ls > 0) ? -import_max_ls : 0;
+    }
+
+    if (fabs(grid_current_target) > hw_current_max) {
+        state = DCDC_CONTROL_CC_LS;
+        grid_current_target = (grid_current_target > 0) ? hw_current_max : -hw_current_max;
+    }
+
+    if (temp_mosfets > 80) {
+        state = DCDC_CONTROL_DERATING;
+        grid_current_target = 0;
+    }
+
+    int steps = static_cast<int>((grid_current_target - grid_current) / DCDC_DROOP_CURRENT_STEP);
+    if (steps > DCDC_DROOP_STEPS_MAX) {
+        steps = DCDC_DROOP_STEPS_MAX;
+    }
+    else if (steps < -DCDC_DROOP_STEPS_MAX) {
+        steps = -DCDC_DROOP_STEPS_MAX;
+    }
+
+    // higher duty cycle reduces the current supplied to the grid, the power flow is reversed
+    // seamlessly when crossing zero current
+    int ccr = half_bridge_get_ccr() - steps * pwm_step(freq_max);
+    half_bridge_set_ccr((ccr > 0) ? ccr : 0);
+
+    power_prev = power;
+
+    return 0;
+}
+
+void Dcdc::switching_optimization()
+{
+    if (deadtime != half_bridge_get_deadtime()) {
+        half_bridge_set_deadtime(deadtime);
+        deadtime = half_bridge_get_deadtime();      // actually applied or previous value
+    }
+
+    // keep maximum frequency during power flow reversal, as the current crosses zero and the
+    // frequency would otherwise be reduced in the middle of the duty cycle ramp
+    float load = reversing ? 1.0F : fabs(inductor_current) / inductor_current_max;
+    if (load > 1.0F) {
+        load = 1.0F;
+    }
+
+    int range = (freq_max > freq_min) ? freq_max - freq_min : 0;
+    int freq = freq_max - range + static_cast<int>(range * load + 0.5F);
+    if (abs(freq - half_bridge_get_frequency()) >= DCDC_FREQ_STEP) {
+        half_bridge_set_frequency(freq);
+    }
+}
+
+void Dcdc::diode_emulation_control()
+{
+    bool buck = (active_mode == DCDC_MODE_BUCK);
+
+    // droop control and power flow reversal need negative current through the rectifier
+    if (mode == DCDC_MODE_NANOGRID || reversing || diode_emulation_current <= 0) {
+        if (half_bridge_get_diode_emulation()) {
+            half_bridge_set_diode_emulation(false, buck);
+        }
+        return;
+    }
+
+    // current in the direction of the power flow
+    float current = buck ? inductor_current : -inductor_current;
+
+    if (!half_bridge_get_diode_emulation() && current < diode_emulation_current) {
+        half_bridge_set_diode_emulation(true, buck);
+    }
+    else if (half_bridge_get_diode_emulation() &&
+        current > diode_emulation_current * DCDC_DIODE_EMULATION_HYST)
+    {
+        half_bridge_set_diode_emulation(false, buck);
+    }
+}
+
+void Dcdc::phase_balancing()
+{
+    if (half_bridge_get_phases() < 2) {
+        return;
+    }
+
+    float average = 0;
+    for (int i = 0; i < half_bridge_get_phases(); i++) {
+        average += phase_current[i];
+    }
+    average /= half_bridge_get_phases();
+
+    // higher CCR increases the current in positive (buck) direction in both modes
+    int offset_max = half_bridge_get_arr() * DCDC_PHASE_OFFSET_MAX;
+    for (int i = 0; i < half_bridge_get_phases(); i++) {
+        int offset = half_bridge_get_phase_offset(i);
+        if (phase_current[i] > average + DCDC_PHASE_CURRENT_DEADBAND && offset > -offset_max) {
+            half_bridge_set_phase_offset(i, offset - pwm_step(freq_max));
+        }
+        else if (phase_current[i] < average - DCDC_PHASE_CURRENT_DEADBAND &&
+            offset < offset_max)
+        {
+            half_bridge_set_phase_offset(i, offset + pwm_step(freq_max));
+        }
+    }
+}
+
+bool Dcdc::buck_allowed()
+{
+    return lvb->sink_current_margin > 0 &&
+        lvb->voltage < lvb->sink_control_voltage() &&
+        hvb->src_current_margin < 0 &&
+        hvb->voltage > hvb->src_control_voltage();
+}
+
+bool Dcdc::boost_allowed()
+{
+    return hvb->sink_current_margin > 0 &&
+        hvb->voltage < hvb->sink_control_voltage() &&
+        lvb->src_current_margin < 0 &&
+        lvb->voltage > lvb->src_control_voltage();
+}
+
+bool Dcdc::power_flow_reversal()
+{
+    bool buck = (active_mode == DCDC_MODE_BUCK);
+
+    if (!reversing) {
+        // The voltages oscillate around their targets during CV regulation, so only an output
+        // voltage clearly above its target or an input voltage clearly below its target means
+        // that the opposite direction of power flow is needed.
+        DcBus *in = buck ? hvb : lvb;
+        DcBus *out = buck ? lvb : hvb;
+        if ((out->voltage > out->sink_control_voltage() * (1.0F + DCDC_REVERSAL_HYST) ||
+             in->voltage < in->src_control_voltage() * (1.0F - DCDC_REVERSAL_HYST)) &&
+            (buck ? boost_allowed() : buck_allowed()))
+        {
+            reversing = true;
+        }
+        else {
+            return false;
+        }
+        LOG_INF("DC/DC reversing power flow to %s mode", buck ? "boost" : "buck");
+    }
+
+    if ((buck && inductor_current <= 0) || (!buck && inductor_current >= 0)) {
+        // zero current crossed: continue with normal control in the new direction
+        active_mode = buck ? DCDC_MODE_BOOST : DCDC_MODE_BUCK;
+        reversing = false;
+        power_prev = 0;
+        power_good_timestamp = uptime();
+        return false;
+    }
+    else if (buck ? !boost_allowed() : !buck_allowed()) {
+        // opposite direction not needed anymore
+        reversing = false;
+        return false;
+    }
+
+    // higher duty cycle increases the power flow in buck direction
+    int ccr = half_bridge_get_ccr() +
+        (buck ? -DCDC_REVERSAL_STEPS : DCDC_REVERSAL_STEPS) * pwm_step(freq_max);
+    half_bridge_set_ccr((ccr > 0) ? ccr : 0);
+    return true;
+}
+
 __weak DcdcOperationMode Dcdc::check_start_conditions()
 {
     if (enable == false ||
         hvb->voltage > hs_voltage_max ||   // also critical for buck mode because of ringing
         lvb->voltage > ls_voltage_max ||
         lvb->voltage < ls_voltage_min ||
-        dev_stat.has_error(ERR_BAT_UNDERVOLTAGE | ERR_BAT_OVERVOLTAGE) ||
-        (int)uptime() < (off_timestamp + (int)restart_interval))
+        dev_stat.has_error(ERR_BAT_UNDERVOLTAGE | ERR_BAT_OVERVOLTAGE))
     {
         return DCDC_MODE_OFF;
     }
 
-    if (lvb->sink_current_margin > 0 &&
-        lvb->voltage < lvb->sink_control_voltage() &&
-        hvb->src_current_margin < 0 &&
-        hvb->voltage > hvb->src_control_voltage() &&
-        hvb->voltage * 0.85 > lvb->voltage)
-    {
-        return DCDC_MODE_BUCK;
+    DcdcOperationMode start_mode;
+    if (buck_allowed() && hvb->voltage * 0.85 > lvb->voltage) {
+        start_mode = DCDC_MODE_BUCK;
+    }
+    else if (boost_allowed()) {
+        start_mode = DCDC_MODE_BOOST;
+    }
+    else {
+        return DCDC_MODE_OFF;
     }
 
-    if (hvb->sink_current_margin > 0 &&
-        hvb->voltage < hvb->sink_control_voltage() &&
-        lvb->src_current_margin < 0 &&
-        lvb->voltage > lvb->src_control_voltage())
+    if (mode == DCDC_MODE_NANOGRID) {
+        // grid voltage does not indicate available input power: use fixed restart interval
+        if ((int)uptime() < (off_timestamp + (int)restart_interval)) {
+            return DCDC_MODE_OFF;
+        }
+    }
+    else if (!restart.allowed(uptime() - off_timestamp,
+        (start_mode == DCDC_MODE_BUCK) ? hvb->voltage : lvb->voltage, restart_interval))
     {
-        return DCDC_MODE_BOOST;
+        return DCDC_MODE_OFF;
     }
 
-    return DCDC_MODE_OFF;
+    return start_mode;
 }
 
 bool Dcdc::check_hs_mosfet_short()
@@ -255,7 +569,15 @@ __weak void Dcdc::control()
                 half_bridge_set_duty_cycle(lvb->voltage / (hvb->voltage + 1));
             }
 
+            half_bridge_set_burst_duty(1.0F);
+            burst = false;
+            power_good = false;
             half_bridge_start();
+            if (mode != DCDC_MODE_NANOGRID) {
+                restart.started((startup_mode == DCDC_MODE_BUCK) ? hvb->voltage : lvb->voltage);
+            }
+            active_mode = static_cast<DcdcOperationMode>(startup_mode);
+            reversing = false;
             power_good_timestamp = uptime();
             printf("DC/DC %s mode start (HV: %.2fV, LV: %.2fV, PWM: %.1f).\n", mode_name,
                 hvb->voltage, lvb->voltage, half_bridge_get_duty_cycle() * 100);
@@ -267,6 +589,8 @@ __weak void Dcdc::control()
     }
     else { // half bridge is on
 
+        switching_optimization();
+
         const char *stop_reason = NULL;
         if (lvb->voltage > ls_voltage_max || hvb->voltage > hs_voltage_max) {
             stop_reason = "emergency (voltage limits exceeded)";
@@ -274,8 +598,12 @@ __weak void Dcdc::control()
         else if (enable == false) {
             stop_reason = "disabled";
         }
+        else if (mode == DCDC_MODE_AUTO && power_flow_reversal()) {
+            // duty cycle already adjusted
+        }
         else {
-            int err = perturb_observe_controller();
+            int err = (mode == DCDC_MODE_NANOGRID) ?
+                droop_controller() : perturb_observe_controller();
             if (err != 0) {
                 stop_reason =  "low power";
             }
@@ -285,6 +613,10 @@ __weak void Dcdc::control()
             stop();
             printf("DC/DC Stop: %s.\n", stop_reason);
         }
+        else {
+            diode_emulation_control();
+            phase_balancing();
+        }
     }
 }
 
@@ -321,6 +653,7 @@ void Dcdc::stop()
     half_bridge_stop();
     state = DCDC_CONTROL_OFF;
     off_timestamp = uptime();
+    restart.stopped();
 }
 
 void Dcdc::fuse_destruction()
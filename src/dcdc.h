@@ -18,7 +18,9 @@
 
 #ifdef __cplusplus
 
+#include "board.h"
 #include "power_port.h"
+#include "restart_policy.h"
 
 /**
  * DC/DC operation mode
@@ -54,7 +56,16 @@ enum DcdcOperationMode
      * May be used in nanogrid applications: Accept input power (if available and need for charging)
      * or provide output power (if no other power source available on the grid and battery charged)
      */
-    DCDC_MODE_AUTO
+    DCDC_MODE_AUTO,
+
+    /**
+     * Nanogrid mode
+     *
+     * DC nanogrid at high side port, battery at low side port. The grid current is controlled
+     * based on the droop characteristics of the high side bus, so that multiple nodes share the
+     * power. The direction of power flow is reversed without stopping the converter.
+     */
+    DCDC_MODE_NANOGRID
 };
 
 /**
@@ -131,6 +142,8 @@ public:
     void fuse_destruction();
 
     DcdcOperationMode mode;     ///< DC/DC mode (buck, boost or nanogrid)
+    DcdcOperationMode active_mode;  ///< Actual direction of power flow (buck or boost)
+    bool reversing;             ///< Power flow reversal in progress (auto mode only)
     bool enable;                ///< Can be used to disable the DC/DC power stage
     uint16_t state;             ///< Control state (off / MPPT / CC / CV)
 
@@ -138,6 +151,8 @@ public:
     DcBus *hvb;                 ///< Pointer to DC bus at high voltage side
     DcBus *lvb;                 ///< Pointer to DC bus at low voltage (inductor) side
     float inductor_current;     ///< Inductor current
+    float phase_current[HALF_BRIDGE_PHASES];    ///< Inductor current of each phase (only if
+                                                ///< measured separately for multiple phases)
     float power;                ///< Low-side power
     float temp_mosfets;         ///< MOSFET temperature measurement (if existing)
 
@@ -146,6 +161,8 @@ public:
     int32_t pwm_delta;          ///< Direction of PWM change for MPPT
     int32_t off_timestamp;      ///< Last time the DC/DC was switched off
     int32_t power_good_timestamp;   ///< Last time the DC/DC reached above minimum output power
+    bool power_good;            ///< Minimum output power was reached since the last start
+    bool burst;                 ///< Burst mode active
 
     // maximum allowed values
     float inductor_current_max = 0;   ///< Maximum low-side (inductor) current
@@ -153,11 +170,28 @@ public:
     float ls_voltage_max;       ///< Maximum low-side voltage
     float ls_voltage_min;       ///< Minimum low-side voltage, e.g. for driver supply
     float output_power_min;     ///< Minimum output power (if lower, DC/DC is switched off)
+    float burst_power;          ///< Output power below which burst mode is used (0 to disable)
+    float burst_power_min;      ///< Minimum output power in burst mode (if lower, DC/DC is
+                                ///< switched off)
+    float diode_emulation_current;  ///< Inductor current below which the synchronous rectifier
+                                    ///< is switched off (0 to disable)
+
+    // switching frequency optimization
+    uint16_t freq_min;          ///< Switching frequency at zero load (kHz)
+    uint16_t freq_max;          ///< Switching frequency at maximum inductor current (kHz)
+    uint16_t deadtime;          ///< Deadtime of the half bridge (ns)
+
+    // nanogrid mode
+    float grid_export_power_max;    ///< Maximum power supplied to the high-side bus (W)
+    float grid_import_power_max;    ///< Maximum power drawn from the high-side bus (W)
+    float grid_current_target;      ///< Current setpoint for the high-side bus (A)
 
     // calibration parameters
-    uint32_t restart_interval;  ///< Restart interval (s): When should we retry to start
+    uint32_t restart_interval;  ///< Maximum restart interval (s): When should we retry to start
                                 ///< charging after low output power cut-off?
 
+    RestartPolicy restart;      ///< Adaptive restart before the maximum interval has passed
+
 private:
     /**
      * MPPT perturb & observe control
@@ -169,6 +203,63 @@ private:
      */
     int perturb_observe_controller();
 
+    /**
+     * Voltage-droop controller for nanogrid mode
+     *
+     * Calculates the grid current setpoint based on the droop characteristics of the high side
+     * bus and the limits of both sides and changes the duty cycle accordingly. In contrast to
+     * the MPPT controller, the converter is never stopped because of low power.
+     *
+     * @returns 0 if everything is fine, error number otherwise
+     */
+    int droop_controller();
+
+    /**
+     * Adjust the switching frequency to the actual load and apply deadtime changes
+     *
+     * Lower frequency at light load reduces the switching losses, higher frequency at heavy
+     * load reduces the current ripple.
+     */
+    void switching_optimization();
+
+    /**
+     * Switch the synchronous rectifier off at light load (diode emulation)
+     *
+     * Prevents negative inductor current and circulating ripple current at light load. The
+     * rectifier is switched on again if the current rises above twice the threshold.
+     */
+    void diode_emulation_control();
+
+    /**
+     * Current balancing between interleaved phases
+     *
+     * The duty cycle of phases with higher than average current is reduced by a CCR offset
+     * (and vice versa) to compensate for tolerances of the inductors and MOSFETs.
+     */
+    void phase_balancing();
+
+    /**
+     * Check if buck mode operation is allowed by the limits of both buses
+     */
+    bool buck_allowed();
+
+    /**
+     * Check if boost mode operation is allowed by the limits of both buses
+     */
+    bool boost_allowed();
+
+    /**
+     * Seamless reversal of the power flow in auto mode
+     *
+     * If the output voltage of the actual direction of power flow rises above its target (or the
+     * input voltage drops below its target) by more than a hysteresis and the opposite direction
+     * is allowed, the duty cycle is slewed through zero current instead of stopping and
+     * restarting the converter. Normal CV regulation at the targets does not trigger a reversal.
+     *
+     * @returns true if the duty cycle was changed by the reversal in this control cycle
+     */
+    bool power_flow_reversal();
+
     /**
      * If manual control of the reverse polarity MOSFET on the high-side is available, this
      * function enables it to use the high voltage side as output.
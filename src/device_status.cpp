@@ -18,9 +18,6 @@
 // must be called exactly once per second, otherwise energy calculation gets wrong
 void DeviceStatus::update_energy()
 {
-    // static variables so that it is not reset for each function call
-    static int seconds_zero_solar = 0;
-
     // stores the input/output energy status of previous day and to add
     // xxx_day_Wh only once per day and increase accuracy
     static uint32_t solar_in_total_Wh_prev;
@@ -46,7 +43,7 @@ void DeviceStatus::update_energy()
         first_call = false;
     }
 
-#if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
+#if HAS_SOLAR_TERMINAL
 #if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR
     if (solar_terminal.bus->voltage < bat_terminal.bus->voltage) {
 #else
@@ -87,7 +84,7 @@ void DeviceStatus::update_energy()
     bat_dis_total_Wh = bat_dis_total_Wh_prev +
         (bat_terminal.neg_energy_Wh > 0 ? bat_terminal.neg_energy_Wh : 0);
 
-#if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
+#if HAS_SOLAR_TERMINAL
     solar_in_total_Wh = solar_in_total_Wh_prev +
         (solar_terminal.neg_energy_Wh > 0 ? solar_terminal.neg_energy_Wh : 0);
 #endif
@@ -137,7 +134,7 @@ void DeviceStatus::update_min_max_values()
     }
 #endif
 
-#if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
+#if HAS_SOLAR_TERMINAL
     if (-solar_terminal.power > solar_power_max_day) {
         solar_power_max_day = -solar_terminal.power;
         if (solar_power_max_day > solar_power_max_total) {
@@ -77,6 +77,12 @@ enum ErrorFlag {
      */
     ERR_BAT_CHG_OVERTEMP = 1U << 7,
 
+    /** Limits from external battery management system (BMS) not received anymore
+     *
+     * Set and cleared in Charger::apply_bms_limits()
+     */
+    ERR_BAT_BMS_TIMEOUT = 1U << 8,
+
     /** Charge controller internal temperature too high
      *
      * Set and cleared by daq_update()
@@ -147,6 +153,9 @@ public:
 
     uint32_t day_counter;
 
+    uint32_t seconds_zero_solar = 0;    ///< Time since solar voltage dropped below battery
+                                        ///< voltage, i.e. duration of the night so far (s)
+
     // instantaneous device-level data
     uint32_t error_flags;       ///< Currently detected errors
     float internal_temp;        ///< Internal temperature (measured in MCU)
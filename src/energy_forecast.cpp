@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "energy_forecast.h"
+
+// discharge power trend filter: c = dt / (tau + dt) = 1s / (15min + 1s)
+#define DISCHARGE_POWER_FILTER_CONST    0.0011F
+
+// weight of the last night for the learned averages
+#define NIGHT_LEARNING_RATE             0.3F
+
+void EnergyForecast::learn_night(uint32_t duration, float energy)
+{
+    if (night_duration == 0) {
+        // first night
+        night_duration = duration;
+        night_energy = energy;
+    }
+    else {
+        night_duration += (int32_t)(NIGHT_LEARNING_RATE * ((float)duration - night_duration));
+        night_energy += NIGHT_LEARNING_RATE * (energy - night_energy);
+    }
+}
+
+void EnergyForecast::update(uint32_t night_time, float discharge_power, uint16_t soc,
+    float capacity)
+{
+    discharge_power_avg += DISCHARGE_POWER_FILTER_CONST * (discharge_power - discharge_power_avg);
+
+    if (night_time > 0 && night_time_prev == 0) {
+        // sunset
+        energy_night = 0;
+    }
+    else if (night_time == 0 && night_time_prev > FORECAST_NIGHT_MIN) {
+        // sunrise
+        learn_night(night_time_prev, energy_night);
+    }
+    night_time_prev = night_time;
+
+    if (night_time > 0 && discharge_power > 0) {
+        energy_night += discharge_power / 3600.0F;
+    }
+
+    energy_usable = soc > soc_reserve ? (soc - soc_reserve) / 100.0F * capacity : 0;
+
+    if (discharge_power_avg > 0.1F) {
+        time_to_empty = energy_usable / discharge_power_avg * 3600;
+    }
+    else {
+        time_to_empty = UINT32_MAX;
+    }
+
+    if (night_time > 0 && night_duration > night_time) {
+        time_to_sunrise = night_duration - night_time;
+
+        float energy_trend = discharge_power_avg * time_to_sunrise / 3600.0F;
+        float energy_learned = night_energy * time_to_sunrise / night_duration;
+        energy_required = energy_trend > energy_learned ? energy_trend : energy_learned;
+    }
+    else {
+        // daytime, night not learned yet or sunrise overdue
+        time_to_sunrise = 0;
+        energy_required = 0;
+    }
+
+    if (energy_usable < energy_required) {
+        reduce_loads = true;
+    }
+    else if (energy_usable > energy_required * hysteresis || time_to_sunrise == 0) {
+        reduce_loads = false;
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ENERGY_FORECAST_H
+#define ENERGY_FORECAST_H
+
+/** @file
+ *
+ * @brief Forecast of the battery energy required until sunrise
+ *
+ * The battery voltage under load is a late indicator for an empty battery. Instead, the
+ * forecast compares the usable energy based on the SOC with the energy required until the next
+ * sunrise. The required energy is estimated from the current discharge power trend and the
+ * average power consumption of previous nights, whichever is higher.
+ *
+ * If the battery would not last until sunrise, a reduction of non-critical loads is requested,
+ * which is applied by the LoadManager.
+ */
+
+#include <zephyr.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Minimum night duration to be considered as a full night, same as for the daily energy counters
+ * in DeviceStatus::update_energy() (s)
+ */
+#define FORECAST_NIGHT_MIN  (5 * 60 * 60)
+
+/**
+ * Energy forecast until sunrise
+ */
+class EnergyForecast
+{
+public:
+    /**
+     * Update forecast, must be called once per second
+     *
+     * @param night_time Time since sunset, 0 during the day (s)
+     * @param discharge_power Battery discharge power, negative while charging (W)
+     * @param soc Battery state of charge (%)
+     * @param capacity Usable battery capacity (Wh), nominal capacity if not measured yet
+     */
+    void update(uint32_t night_time, float discharge_power, uint16_t soc, float capacity);
+
+    /**
+     * Lowest SOC that may be used by the loads (%), typically the SOC at which the load output
+     * low voltage disconnect is triggered
+     */
+    uint16_t soc_reserve = CONFIG_LOAD_FORECAST_SOC_RESERVE;
+
+    /**
+     * Factor of the required energy which must be available to stop reducing the loads again
+     */
+    float hysteresis = 1.2F;
+
+    // learned from previous nights
+
+    float night_energy = 0;         ///< Average battery discharge energy per night (Wh)
+    uint32_t night_duration = 0;    ///< Average night duration (s), 0 if not learned yet
+
+    // forecast
+
+    float discharge_power_avg = 0;  ///< Low-pass filtered battery discharge power (W)
+    float energy_usable = 0;        ///< Battery energy above the reserve SOC (Wh)
+    float energy_required = 0;      ///< Estimated energy required until sunrise (Wh)
+    uint32_t time_to_empty = 0;     ///< Time until reserve SOC is reached (s), UINT32_MAX if not
+                                    ///< discharging
+    uint32_t time_to_sunrise = 0;   ///< Expected time until sunrise (s), 0 during the day
+
+    bool reduce_loads = false;      ///< Non-critical loads should be switched off
+
+private:
+    void learn_night(uint32_t duration, float energy);
+
+    float energy_night = 0;         ///< Discharged energy since sunset (Wh)
+    uint32_t night_time_prev = 0;
+};
+
+#endif /* ENERGY_FORECAST_H */
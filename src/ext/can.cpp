@@ -24,6 +24,14 @@ LOG_MODULE_REGISTER(ext_can, CONFIG_CAN_LOG_LEVEL);
 #include "thingset.h"
 #include "data_nodes.h"
 
+#ifdef CONFIG_BMS_CAN
+#include "bat_charger.h"
+#endif
+
+#ifdef CONFIG_CURRENT_SHARING
+#include "current_sharing.h"
+#endif
+
 #if DT_NODE_EXISTS(DT_CHILD(DT_PATH(outputs), can_en))
 #define CAN_EN_GPIO DT_CHILD(DT_PATH(outputs), can_en)
 #endif
@@ -123,6 +131,53 @@ K_THREAD_DEFINE(can_rx, RX_THREAD_STACK_SIZE, can_rx_thread, NULL, NULL, NULL,
 
 #endif /* CONFIG_ISOTP */
 
+#ifdef CONFIG_BMS_CAN
+
+extern Charger charger;
+
+// charge/discharge limits message (Victron/SMA compatible BMS protocol)
+#define BMS_CAN_ID_LIMITS 0x351
+
+const struct zcan_filter bms_limits_filter = {
+    .id_type = CAN_STANDARD_IDENTIFIER,
+    .rtr = CAN_DATAFRAME,
+    .id = BMS_CAN_ID_LIMITS,
+    .rtr_mask = 1,
+    .id_mask = CAN_STD_ID_MASK
+};
+
+void can_bms_isr(struct zcan_frame *frame, void *arg)
+{
+    charger.bms_limits_decode(frame->data, frame->dlc);
+}
+
+#endif /* CONFIG_BMS_CAN */
+
+#ifdef CONFIG_CURRENT_SHARING
+
+extern CurrentSharing current_sharing;
+
+// standard 11-bit identifier, lower 8 bits contain the node address of the sender
+#define CURRENT_SHARING_CAN_ID_BASE 0x600
+
+const struct zcan_filter current_sharing_filter = {
+    .id_type = CAN_STANDARD_IDENTIFIER,
+    .rtr = CAN_DATAFRAME,
+    .id = CURRENT_SHARING_CAN_ID_BASE,
+    .rtr_mask = 1,
+    .id_mask = 0x700
+};
+
+void can_current_sharing_isr(struct zcan_frame *frame, void *arg)
+{
+    uint8_t node_id = frame->id & 0xFF;
+    if (node_id != can_node_addr) {
+        current_sharing.decode(node_id, frame->data, frame->dlc);
+    }
+}
+
+#endif /* CONFIG_CURRENT_SHARING */
+
 void can_pub_isr(uint32_t err_flags, void *arg)
 {
 	// Do nothing. Publication messages are fire and forget.
@@ -141,17 +196,32 @@ void can_pub_thread()
 
     can_dev = device_get_binding("CAN_1");
 
-    int64_t t_start = k_uptime_get();
+#ifdef CONFIG_BMS_CAN
+    if (can_attach_isr(can_dev, can_bms_isr, NULL, &bms_limits_filter) < 0) {
+        LOG_ERR("Failed to attach BMS message filter");
+    }
+#endif
+
+#ifdef CONFIG_CURRENT_SHARING
+    if (can_attach_isr(can_dev, can_current_sharing_isr, NULL, &current_sharing_filter) < 0) {
+        LOG_ERR("Failed to attach current sharing message filter");
+    }
+#endif
 
     while (true) {
 
         task_wdt_feed(wdt_channel);
 
-        if (pub_can_enable) {
+        int64_t now = k_uptime_get();
+        for (int i = 0; i < PUB_CAN_CHANNELS; i++) {
+            if (!pub_can_channels[i].due(now)) {
+                continue;
+            }
+
             int data_len = 0;
             int start_pos = 0;
-            while ((data_len = ts.bin_pub_can(start_pos, PUB_CAN, can_node_addr, can_id, can_data))
-                     != -1)
+            while ((data_len = ts.bin_pub_can(start_pos, pub_can_channels[i].mask, can_node_addr,
+                can_id, can_data)) != -1)
             {
                 struct zcan_frame frame = {0};
                 frame.id_type = CAN_EXTENDED_IDENTIFIER;
@@ -169,11 +239,45 @@ void can_pub_thread()
             }
         }
 
-        t_start += 1000;
-        k_sleep(K_TIMEOUT_ABS_MS(t_start));
+        // wake up at least every second to feed the watchdog
+        int64_t next = pub_channels_next(pub_can_channels, PUB_CAN_CHANNELS, now);
+        if (next > now + 1000) {
+            next = now + 1000;
+        }
+        k_sleep(K_TIMEOUT_ABS_MS(next));
     }
 }
 
 K_THREAD_DEFINE(can_pub, 1024, can_pub_thread, NULL, NULL, NULL, 6, 0, 1000);
 
+#ifdef CONFIG_CURRENT_SHARING
+
+void can_current_sharing_thread()
+{
+    struct zcan_frame frame = {0};
+    frame.id_type = CAN_STANDARD_IDENTIFIER;
+    frame.rtr     = CAN_DATAFRAME;
+
+    int64_t t_start = k_uptime_get();
+
+    while (true) {
+        // node address might be changed at runtime
+        frame.id = CURRENT_SHARING_CAN_ID_BASE | (can_node_addr & 0xFF);
+        frame.dlc = current_sharing.encode(frame.data);
+
+        if (can_send(can_dev, &frame, K_MSEC(10), can_pub_isr, NULL) != CAN_TX_OK) {
+            LOG_DBG("Error sending current sharing frame");
+        }
+
+        t_start += 100;
+        k_sleep(K_TIMEOUT_ABS_MS(t_start));
+    }
+}
+
+// started after can_pub thread, which initializes the CAN device
+K_THREAD_DEFINE(can_current_sharing, 512, can_current_sharing_thread, NULL, NULL, NULL, 5, 0,
+    1500);
+
+#endif /* CONFIG_CURRENT_SHARING */
+
 #endif /* CONFIG_THINGSET_CAN */
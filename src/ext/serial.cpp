@@ -17,6 +17,8 @@
 #include "thingset.h"
 #include "hardware.h"
 #include "data_nodes.h"
+#include "pub_template.h"
+#include "serial_protocol.h"
 
 #if CONFIG_UEXT_SERIAL_THINGSET
 #define UART_DEVICE_NAME DT_LABEL(DT_ALIAS(uart_uext))
@@ -32,15 +34,29 @@ const struct device *uart_dev = device_get_binding(UART_DEVICE_NAME);
 static char buf_resp[CONFIG_THINGSET_SERIAL_TX_BUF_SIZE];
 static char buf_req[CONFIG_THINGSET_SERIAL_RX_BUF_SIZE];
 
-static volatile size_t req_pos = 0;
-static volatile bool command_flag = false;
+static SerialReceiver receiver((uint8_t *)buf_req, sizeof(buf_req));
 
 extern ThingSet ts;
 
-void process_1s()
+static PubTemplateEntry pub_entries[PUB_SER_CHANNELS][CONFIG_THINGSET_SERIAL_PUB_TEMPLATE_NODES];
+
+static PubTemplate pub_templates[PUB_SER_CHANNELS] = {
+    PubTemplate(pub_entries[0], CONFIG_THINGSET_SERIAL_PUB_TEMPLATE_NODES),
+    PubTemplate(pub_entries[1], CONFIG_THINGSET_SERIAL_PUB_TEMPLATE_NODES),
+    PubTemplate(pub_entries[2], CONFIG_THINGSET_SERIAL_PUB_TEMPLATE_NODES),
+};
+
+static void uart_putc(uint8_t c)
+{
+    uart_poll_out(uart_dev, c);
+}
+
+static void send_response(int len, bool binary)
 {
-    if (pub_serial_enable) {
-        int len = ts.txt_pub(buf_resp, sizeof(buf_resp), PUB_SER);
+    if (binary) {
+        slip_write((uint8_t *)buf_resp, len, uart_putc);
+    }
+    else {
         for (int i = 0; i < len; i++) {
             uart_poll_out(uart_dev, buf_resp[i]);
         }
@@ -48,31 +64,60 @@ void process_1s()
     }
 }
 
+void process_pub(int64_t now)
+{
+    // publication messages use the same mode as the last request
+    bool binary = receiver.binary();
+
+    for (int i = 0; i < PUB_SER_CHANNELS; i++) {
+        PubChannel *ch = &pub_ser_channels[i];
+        if (ch->due(now)) {
+            if (ch->nodes_changed) {
+                pub_templates[i].build(data_nodes, num_data_nodes, ch->mask);
+                ch->nodes_changed = false;
+            }
+
+            int len;
+            if (pub_templates[i].valid()) {
+                len = binary ? pub_templates[i].bin_pub((uint8_t *)buf_resp, sizeof(buf_resp)) :
+                    pub_templates[i].txt_pub(buf_resp, sizeof(buf_resp));
+            }
+            else {
+                len = binary ? ts.bin_pub((uint8_t *)buf_resp, sizeof(buf_resp), ch->mask) :
+                    ts.txt_pub(buf_resp, sizeof(buf_resp), ch->mask);
+            }
+            send_response(len, binary);
+        }
+    }
+}
+
 void process_asap()
 {
-    if (command_flag) {
-        // commands must have 2 or more characters
-        if (req_pos > 1) {
+    if (receiver.available()) {
+        if (receiver.binary() && receiver.length() > 0) {
+            int len = ts.process((uint8_t *)buf_req, receiver.length(),
+                (uint8_t *)buf_resp, sizeof(buf_resp));
+
+            send_response(len, true);
+        }
+        // text commands must have 2 or more characters
+        else if (receiver.length() > 1) {
             printf("Received Request (%d bytes): %s\n", strlen(buf_req), buf_req);
 
             int len = ts.process((uint8_t *)buf_req, strlen(buf_req),
                 (uint8_t *)buf_resp, sizeof(buf_resp));
 
-            for (int i = 0; i < len; i++) {
-                uart_poll_out(uart_dev, buf_resp[i]);
-            }
-            uart_poll_out(uart_dev, '\n');
+            send_response(len, false);
         }
 
         // start listening for new commands
-        command_flag = false;
-        req_pos = 0;
+        receiver.reset();
     }
 }
 
 /**
- * Read characters from stream until line end \n detected, signal command available then
- * and wait for processing
+ * Read characters from stream until a text or binary request is complete, signal command
+ * available then and wait for processing
  */
 void process_input(const struct device *dev, void* user_data)
 {
@@ -82,38 +127,14 @@ void process_input(const struct device *dev, void* user_data)
         return;
     }
 
-    while (uart_irq_rx_ready(uart_dev) && command_flag == false) {
+    while (uart_irq_rx_ready(uart_dev) && !receiver.available()) {
         uart_fifo_read(uart_dev, &c, 1);
-
-        // \r\n and \n are markers for line end, i.e. command end
-        // we accept this at any time, even if the buffer is 'full', since
-        // there is always one last character left for the \0
-        if (c == '\n') {
-            if (req_pos > 0 && buf_req[req_pos-1] == '\r') {
-                buf_req[req_pos-1] = '\0';
-            }
-            else {
-                buf_req[req_pos] = '\0';
-            }
-            // start processing
-            command_flag = true;
-        }
-        // backspace allowed if there is something in the buffer already
-        else if (req_pos > 0 && c == '\b') {
-            req_pos--;
-        }
-        // Fill the buffer up to all but 1 character (the last character is reserved for '\0')
-        // Characters beyond the size of the buffer are dropped.
-        else if (req_pos < (sizeof(buf_req)-1)) {
-            buf_req[req_pos++] = c;
-        }
+        receiver.put(c);
     }
 }
 
 void serial_thread()
 {
-    uint32_t last_call = 0;
-
     // long watchdog timeout needed for ThingSet conf calls which write to slow EEPROM
     int wdt_channel = task_wdt_add(500, task_wdt_callback, (void *)k_current_get());
 
@@ -123,13 +144,9 @@ void serial_thread()
     while (true) {
         task_wdt_feed(wdt_channel);
 
-        uint32_t now = k_uptime_get() / 1000;
-
         process_asap();     // approx. every millisecond
-        if (now >= last_call + 1) {
-            last_call = now;
-            process_1s();
-        }
+        process_pub(k_uptime_get());
+
         k_sleep(K_MSEC(10));
     }
 }
@@ -27,7 +27,43 @@
 void half_bridge_init(int freq_kHz, int deadtime_ns, float min_duty, float max_duty);
 
 /**
- * Set raw timer capture/compare register
+ * Change the switching frequency during operation
+ *
+ * The duty cycle and its limits are kept. If supported by the timer, the new period is
+ * preloaded and applied with the next update event to prevent glitches of the outputs.
+ *
+ * @param freq_kHz Switching frequency in kHz
+ *
+ * @returns true if the frequency was changed, false if it is not valid for the timer
+ */
+bool half_bridge_set_frequency(int freq_kHz);
+
+/**
+ * Get the switching frequency
+ *
+ * @returns Switching frequency in kHz
+ */
+int half_bridge_get_frequency();
+
+/**
+ * Change the deadtime during operation
+ *
+ * @param deadtime_ns Deadtime in ns between switching the two FETs on/off
+ *
+ * @returns true if the deadtime was changed, false if it is not valid or the timer does not
+ *          support changes after initialization
+ */
+bool half_bridge_set_deadtime(int deadtime_ns);
+
+/**
+ * Get the deadtime as applied to the timer (rounded down to timer clock resolution)
+ *
+ * @returns Deadtime in ns
+ */
+int half_bridge_get_deadtime();
+
+/**
+ * Set raw timer capture/compare register (common value of all phases)
  *
  * This function allows to change the PWM with minimum step size.
  *
@@ -49,6 +85,52 @@ uint16_t half_bridge_get_ccr();
  */
 uint16_t half_bridge_get_arr();
 
+/**
+ * Get the fixed CCR step for the smallest duty cycle change of the control algorithms
+ *
+ * Timers clocked with the system clock use a fixed step of one count (three counts on the fast
+ * STM32G4), high resolution timers like the HRTIM need a step derived from the period.
+ *
+ * @returns Step in timer counts or 0 if the step should be derived from the period
+ */
+uint16_t half_bridge_get_ccr_step();
+
+/**
+ * Get the number of interleaved phases
+ *
+ * All phases use the same frequency and duty cycle, shifted by 360 / phases degrees.
+ */
+int half_bridge_get_phases();
+
+/**
+ * Set an offset of the capture/compare register of one phase for current balancing
+ *
+ * The offset is added to the common CCR set via half_bridge_set_ccr() or
+ * half_bridge_set_duty_cycle(). The resulting CCR is still limited to the min/max duty cycle.
+ *
+ * @param phase Phase index (0 to phases - 1)
+ * @param offset CCR offset in timer counts
+ */
+void half_bridge_set_phase_offset(int phase, int offset);
+
+/**
+ * Get the capture/compare register offset of one phase
+ *
+ * @param phase Phase index (0 to phases - 1)
+ *
+ * @returns CCR offset in timer counts
+ */
+int half_bridge_get_phase_offset(int phase);
+
+/**
+ * Get raw timer capture/compare register of one phase (incl. balancing offset)
+ *
+ * @param phase Phase index (0 to phases - 1)
+ *
+ * @returns Timer CCR value (between 0 and ARR)
+ */
+uint16_t half_bridge_get_phase_ccr(int phase);
+
 /**
  * Set the duty cycle of the PWM signal
  *
@@ -78,8 +160,54 @@ void half_bridge_stop();
 /**
  * Get status of the PWM output
  *
- * @returns True if PWM output enabled
+ * @returns True if PWM output enabled (also during the off phases of burst mode)
  */
 bool half_bridge_enabled();
 
+/**
+ * Enable or disable diode emulation
+ *
+ * In diode emulation mode the synchronous rectifier MOSFET is kept off, so that the inductor
+ * current can only flow through its body diode and never becomes negative (discontinuous
+ * conduction mode at light load).
+ *
+ * @param enable True to switch off the synchronous rectifier, false for synchronous switching
+ * @param buck True if the low-side MOSFET is the rectifier (buck mode), false if it is the
+ *             high-side MOSFET (boost mode)
+ */
+void half_bridge_set_diode_emulation(bool enable, bool buck);
+
+/**
+ * Get status of diode emulation
+ *
+ * @returns True if the synchronous rectifier MOSFET is switched off
+ */
+bool half_bridge_get_diode_emulation();
+
+/**
+ * Set the burst mode duty cycle
+ *
+ * For very low power the switching losses are reduced by switching the half bridge only in
+ * short bursts of a few PWM periods, followed by a pause with both MOSFETs off. The burst
+ * period is 10 ms.
+ *
+ * @param duty Fraction of the burst period with active switching (0.1 to 1.0), 1.0 for
+ *             continuous switching
+ */
+void half_bridge_set_burst_duty(float duty);
+
+/**
+ * Read the currently set burst mode duty cycle
+ *
+ * @returns Fraction of the burst period with active switching, 1.0 for continuous switching
+ */
+float half_bridge_get_burst_duty();
+
+/**
+ * Switch the outputs on or off according to the burst mode duty cycle
+ *
+ * Called every millisecond from a kernel timer while burst mode is active.
+ */
+void half_bridge_burst_tick();
+
 #endif /* HALF_BRIDGE_H_ */
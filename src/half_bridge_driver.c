@@ -0,0 +1,626 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "half_bridge_driver.h"
+
+#include <zephyr.h>
+
+#include <stdint.h>
+
+#include "board.h"
+#include "mcu.h"
+
+#ifndef UNIT_TEST
+#include <soc.h>
+#include <pinmux/stm32/pinmux_stm32.h>
+#include <stm32_ll_bus.h>
+#endif
+
+#if BOARD_HAS_DCDC
+
+#define DT_DRV_COMPAT half_bridge
+
+// Get address of used timer from board dts
+#define TIMER_ADDR DT_REG_ADDR(DT_PARENT(DT_DRV_INST(0)))
+
+// maximum deadtime (7 bits of TIM1 deadtime generator)
+#define TIM_DT_CLOCKS_MAX 0x7F
+
+#ifdef UNIT_TEST
+const uint32_t SystemCoreClock = 24000000;
+#endif
+
+static uint16_t tim_dt_clocks = 0;
+
+// MOSFETs switched while the outputs are enabled (one of them is off in diode emulation mode)
+static bool tim_hs_selected = true;
+static bool tim_ls_selected = true;
+
+static uint32_t tim_calculate_dt_clocks(int deadtime_ns)
+{
+    // (clocks per ms * deadtime in ns) / 1000 == (clocks per ms * deadtime in ms)
+    // although the C operator precedence does the "right thing" to allow deadtime_ns < 1000 to
+    // be handled nicely, parentheses make this more explicit
+    return ((SystemCoreClock / (1000000)) * deadtime_ns) / 1000;
+}
+
+#ifndef UNIT_TEST
+
+static const struct soc_gpio_pinctrl tim_pinctrl[] = ST_STM32_DT_INST_PINCTRL(0, 0);
+
+#if (TIMER_ADDR == TIM3_BASE || TIMER_ADDR == TIM1_BASE) && HALF_BRIDGE_PHASES > 1
+#error "Interleaved phases are only supported by the HRTIM"
+#endif
+
+#if TIMER_ADDR == TIM3_BASE
+
+uint32_t tim_calculate_arr(int freq_kHz)
+{
+    // center-aligned mode counts up and down in each period, so we need half the clocks as
+    // resolution for the given frequency.
+    return SystemCoreClock / (freq_kHz * 1000) / 2;
+}
+
+void tim_init_registers(int freq_kHz, int deadtime_ns)
+{
+    tim_dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+
+    stm32_dt_pinctrl_configure(tim_pinctrl, ARRAY_SIZE(tim_pinctrl), TIMER_ADDR);
+
+    LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM3);
+
+    // No prescaler --> timer frequency == SystemClock
+    TIM3->PSC = 0;
+
+    // Capture/Compare Mode Register 1
+    // OCxM = 110: Select PWM mode 1 on OCx
+    // OCxPE = 1:  Enable preload register on OCx (reset value)
+    TIM3->CCMR2 |= TIM_CCMR2_OC3M_2 | TIM_CCMR2_OC3M_1 | TIM_CCMR2_OC3PE;
+    TIM3->CCMR2 |= TIM_CCMR2_OC4M_2 | TIM_CCMR2_OC4M_1 | TIM_CCMR2_OC4PE;
+
+    // Capture/Compare Enable Register
+    // CCxP: Active high polarity on OCx (default = 0)
+    TIM3->CCER &= ~(TIM_CCER_CC3P); // PB0 / TIM3_CH3: high-side
+    TIM3->CCER |= TIM_CCER_CC4P;    // PB1 / TIM3_CH4: low-side
+
+    // Control Register 1
+    // TIM_CR1_CMS = 01: Select center-aligned mode 1
+    // TIM_CR1_ARPE = 1: Auto-reload preload enable (frequency changes at update event)
+    // TIM_CR1_CEN =  1: Counter enable
+    TIM3->CR1 |= TIM_CR1_CMS_0 | TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    // Force update generation (UG = 1)
+    TIM3->EGR |= TIM_EGR_UG;
+
+    // Auto Reload Register
+    TIM3->ARR = tim_calculate_arr(freq_kHz);
+}
+
+void tim_set_arr(uint16_t arr)
+{
+    TIM3->ARR = arr;
+}
+
+bool tim_set_deadtime(int deadtime_ns)
+{
+    uint32_t dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+    if (deadtime_ns < 0 || dt_clocks > TIM_DT_CLOCKS_MAX) {
+        return false;
+    }
+
+    // deadtime is generated by the offset of the low-side CCR (preloaded as well)
+    tim_dt_clocks = dt_clocks;
+    TIM3->CCR4 = TIM3->CCR3 + tim_dt_clocks;
+    return true;
+}
+
+void tim_outputs_enable()
+{
+    if (TIM3->CCR3 != 0U) {
+        // Capture/Compare Enable Register
+        // CCxE = 1: Enable the output on OCx
+        // CCxP = 0: Active high polarity on OCx (default)
+        if (tim_hs_selected) {
+            TIM3->CCER |= TIM_CCER_CC3E;
+        }
+        else {
+            TIM3->CCER &= ~(TIM_CCER_CC3E);
+        }
+        if (tim_ls_selected) {
+            TIM3->CCER |= TIM_CCER_CC4E;
+        }
+        else {
+            TIM3->CCER &= ~(TIM_CCER_CC4E);
+        }
+    }
+}
+
+void tim_outputs_disable()
+{
+    TIM3->CCER &= ~(TIM_CCER_CC3E);
+    TIM3->CCER &= ~(TIM_CCER_CC4E);
+}
+
+uint16_t tim_get_arr()
+{
+    return TIM3->ARR;
+}
+
+uint16_t tim_get_ccr_step()
+{
+    return 1;
+}
+
+uint16_t tim_get_ccr(int phase)
+{
+    return TIM3->CCR3;
+}
+
+void tim_set_ccr(int phase, uint16_t ccr)
+{
+    TIM3->CCR3 = ccr;                   // high-side
+    TIM3->CCR4 = ccr + tim_dt_clocks;   // low-side
+}
+
+bool tim_outputs_enabled()
+{
+    return TIM3->CCER & (TIM_CCER_CC3E | TIM_CCER_CC4E);
+}
+
+void tim_outputs_select(bool high_side, bool low_side)
+{
+    tim_hs_selected = high_side;
+    tim_ls_selected = low_side;
+    if (tim_outputs_enabled()) {
+        tim_outputs_enable();
+    }
+}
+
+#elif TIMER_ADDR == TIM1_BASE
+
+uint32_t tim_calculate_arr(int freq_kHz)
+{
+    // edge-aligned mode possible with TIM1 to increase resolution (no division by 2 necessary)
+    return SystemCoreClock / (freq_kHz * 1000);
+}
+
+void tim_init_registers(int freq_kHz, int deadtime_ns)
+{
+    tim_dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+
+    stm32_dt_pinctrl_configure(tim_pinctrl, ARRAY_SIZE(tim_pinctrl), TIMER_ADDR);
+
+#ifdef LL_APB2_GRP1_PERIPH_TIM1
+    LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_TIM1);
+#else
+    LL_APB1_GRP2_EnableClock(LL_APB1_GRP2_PERIPH_TIM1);
+#endif
+
+    // No prescaler --> timer frequency == SystemClock
+    TIM1->PSC = 0;
+
+    // Capture/Compare Mode Register 1
+    // OC1M = 110: Select PWM mode 1 on OC1
+    // OC1PE = 1:  Enable preload register on OC1 (reset value)
+    TIM1->CCMR1 |= TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE;
+
+    // Capture/Compare Enable Register
+    // CC1E = 1: Enable the output on OC1
+    // CC1P = 0: Active high polarity on OC1 (default)
+    // CC1NE = 1: Enable the output on OC1N
+    // CC1NP = 0: Active high polarity on OC1N (default)
+    TIM1->CCER |= TIM_CCER_CC1E | TIM_CCER_CC1NE;
+
+    // Control Register 1
+    // TIM_CR1_CMS = 00: Select edge-aligned mode
+    // TIM_CR1_ARPE = 1: Auto-reload preload enable (frequency changes at update event)
+    // TIM_CR1_CEN =  1: Counter enable
+    TIM1->CR1 |= TIM_CR1_ARPE | TIM_CR1_CEN;
+
+#ifdef CONFIG_SOC_SERIES_STM32G4X
+    // Boards with STM32G4 MCU use ADC2 for synchronized ADC sampling. We use OC6
+    // for triggering, but but don't configure any pin for PWM mode
+    TIM1->CCMR3 |= TIM_CCMR3_OC6M_2 | TIM_CCMR3_OC6M_1 | TIM_CCMR3_OC6PE;
+    TIM1->CCER |= TIM_CCER_CC6E;
+    // Trigger ADC via TIM1_TRGO2 on OC6ref falling edge signal event
+    TIM1->CR2 |= TIM_CR2_MMS2_3 | TIM_CR2_MMS2_2 |  TIM_CR2_MMS2_0;
+#endif
+
+    // Force update generation (UG = 1)
+    TIM1->EGR |= TIM_EGR_UG;
+
+    // Auto Reload Register
+    TIM1->ARR = tim_calculate_arr(freq_kHz);
+
+    // Break and Dead-Time Register
+    // DTG[7:0]: Dead-time generator setup
+    TIM1->BDTR |= (tim_dt_clocks & (uint32_t)0x7F); // ensure that only the last 7 bits are changed
+
+    // Lock Break and Dead-Time Register
+    // TODO: does not work properly... maybe HW bug?
+    TIM1->BDTR |= TIM_BDTR_LOCK_1 | TIM_BDTR_LOCK_0;
+}
+
+void tim_set_arr(uint16_t arr)
+{
+    TIM1->ARR = arr;
+}
+
+bool tim_set_deadtime(int deadtime_ns)
+{
+    // not possible, as the break and dead-time register is locked after initialization
+    return false;
+}
+
+void tim_outputs_enable()
+{
+    if (TIM1->CCR1 != 0U) {
+        // Break and Dead-Time Register
+        // MOE  = 1: Main output enable
+        TIM1->BDTR |= TIM_BDTR_MOE;
+    }
+}
+
+void tim_outputs_disable()
+{
+    // Break and Dead-Time Register
+    // MOE  = 1: Main output enable
+    TIM1->BDTR &= ~(TIM_BDTR_MOE);
+}
+
+uint16_t tim_get_arr()
+{
+    return TIM1->ARR;
+}
+
+uint16_t tim_get_ccr_step()
+{
+#ifdef CONFIG_SOC_SERIES_STM32G4X
+    // reduced step size for fast microcontroller
+    return 3;
+#else
+    return 1;
+#endif
+}
+
+uint16_t tim_get_ccr(int phase)
+{
+    return TIM1->CCR1;
+}
+
+void tim_set_ccr(int phase, uint16_t ccr)
+{
+    TIM1->CCR1 = ccr;
+
+#ifdef CONFIG_SOC_SERIES_STM32G4X
+    // Trigger ADC for current measurement in the middle of the cycle.
+    TIM1->CCR6 = TIM1->CCR1 / 2;
+#endif
+}
+
+bool tim_outputs_enabled()
+{
+    return TIM1->BDTR & TIM_BDTR_MOE;
+}
+
+void tim_outputs_select(bool high_side, bool low_side)
+{
+    tim_hs_selected = high_side;
+    tim_ls_selected = low_side;
+
+    // Capture/Compare Enable Register (not preloaded, so changes are applied immediately)
+    // If only CC1NE is set, OC1N is not the complement of OC1REF anymore, but follows OC1REF
+    // directly, so the polarity of OC1N has to be inverted (CC1NP = 1) to keep the low-side
+    // MOSFET off during the on-time of the (disabled) high-side MOSFET.
+    uint32_t ccer = TIM1->CCER & ~(TIM_CCER_CC1E | TIM_CCER_CC1NE | TIM_CCER_CC1NP);
+    if (high_side) {
+        ccer |= TIM_CCER_CC1E;
+    }
+    if (low_side) {
+        ccer |= high_side ? TIM_CCER_CC1NE : (TIM_CCER_CC1NE | TIM_CCER_CC1NP);
+    }
+    TIM1->CCER = ccer;
+}
+
+#elif TIMER_ADDR == HRTIM1_BASE
+
+/*
+ * Below HRTIM implementation uses timing unit A for the first phase, B for the second phase
+ * and so on. The counters are clocked with 8 times the system clock using the delay-locked
+ * loop (DLL) of the HRTIM, which results in a duty cycle resolution of 735 ps with 170 MHz
+ * system clock.
+ *
+ * For multiple phases, the timing units are reset by the master timer (phase 1 by the master
+ * period event and the further phases by master compare 1 to 3), so that the phases are
+ * shifted by 360 / HALF_BRIDGE_PHASES degrees.
+ */
+
+#include <stm32_ll_system.h>
+#include <stm32_ll_bus.h>
+
+#if HALF_BRIDGE_PHASES > 4
+#error "HRTIM supports a maximum of 4 interleaved phases"
+#endif
+
+// counter clock multiplier vs. SystemClock (32 / 2^CKPSC)
+#define HRTIM_CLOCK_MUL 8
+#define HRTIM_CKPSC 2
+
+// maximum allowed value of the period register
+#define HRTIM_PER_MAX 0xFFDF
+
+// output enable/disable bits of a phase (TA1 / TA2 for phase 0, TB1 / TB2 for phase 1, ...)
+#define HRTIM_HS_BIT(phase) (HRTIM_OENR_TA1OEN << (2 * (phase)))
+#define HRTIM_LS_BIT(phase) (HRTIM_OENR_TA2OEN << (2 * (phase)))
+
+static inline HRTIM_Timerx_TypeDef *tim_unit(int phase)
+{
+    return &HRTIM1->sTimerxRegs[phase];
+}
+
+static uint32_t tim_outputs_mask(bool high_side, bool low_side)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < HALF_BRIDGE_PHASES; i++) {
+        mask |= (high_side ? HRTIM_HS_BIT(i) : 0) | (low_side ? HRTIM_LS_BIT(i) : 0);
+    }
+    return mask;
+}
+
+uint32_t tim_calculate_arr(int freq_kHz)
+{
+    uint32_t per = SystemCoreClock / (freq_kHz * 1000) * HRTIM_CLOCK_MUL + 1;
+    return (per <= HRTIM_PER_MAX) ? per : UINT32_MAX;
+}
+
+static void tim_set_phase_shift(uint16_t arr)
+{
+#if HALF_BRIDGE_PHASES > 1
+    HRTIM1->sMasterRegs.MPER = arr;
+    HRTIM1->sMasterRegs.MCMP1R = arr * 1 / HALF_BRIDGE_PHASES;
+#if HALF_BRIDGE_PHASES > 2
+    HRTIM1->sMasterRegs.MCMP2R = arr * 2 / HALF_BRIDGE_PHASES;
+#endif
+#if HALF_BRIDGE_PHASES > 3
+    HRTIM1->sMasterRegs.MCMP3R = arr * 3 / HALF_BRIDGE_PHASES;
+#endif
+#endif
+}
+
+void tim_init_registers(int freq_kHz, int deadtime_ns)
+{
+    tim_dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+
+    stm32_dt_pinctrl_configure(tim_pinctrl, ARRAY_SIZE(tim_pinctrl), TIMER_ADDR);
+
+    LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_HRTIM1);
+
+    // Enable periodic calibration of delay-locked loop (DLL) with lowest calibration period
+    HRTIM1->sCommonRegs.DLLCR |= HRTIM_DLLCR_CALEN | HRTIM_DLLCR_CALRTE_0 | HRTIM_DLLCR_CALRTE_1;
+
+    // Wait for calibration to finish
+    while ((HRTIM1_COMMON->ISR & HRTIM_ISR_DLLRDY) == 0) {;}
+
+    uint32_t arr = tim_calculate_arr(freq_kHz);
+    uint32_t mcr = 0;
+
+    for (int i = 0; i < HALF_BRIDGE_PHASES; i++) {
+        HRTIM_Timerx_TypeDef *unit = tim_unit(i);
+
+        // Prescaler 4 --> 8 x SystemClock (high resolution using the DLL)
+        unit->TIMxCR |= (HRTIM_CKPSC << HRTIM_TIMCR_CK_PSC_Pos);
+
+        // Prescaler 8 / 2^3 --> same frequency as HRTIM (deadtime in SystemClock periods)
+        unit->DTxR |= (3U << HRTIM_DTR_DTPRSC_Pos);
+
+        // Continuous mode operation
+        unit->TIMxCR |= HRTIM_TIMCR_CONT;
+
+        // Timer period register
+        unit->PERxR = arr;
+
+        // Set output on period or reset by master timer, reset output on compare 1
+        unit->SETx1R = HRTIM_SET1R_PER | HRTIM_SET1R_RESYNC;
+        unit->RSTx1R = HRTIM_SET1R_CMP1;
+
+#if HALF_BRIDGE_PHASES > 1
+        // Counter reset by master timer to generate the phase shift
+        unit->RSTxR = (i == 0) ? HRTIM_RSTR_MSTPER : (HRTIM_RSTR_MSTCMP1 << (i - 1));
+#endif
+
+        unit->OUTxR = HRTIM_OUTR_DTEN;
+
+        // Set deadtime values and lock deadtime signs
+        unit->DTxR |=
+            HRTIM_DTR_DTFSLK | (tim_dt_clocks << 16U) |
+            HRTIM_DTR_DTRSLK | tim_dt_clocks;
+
+        mcr |= HRTIM_MCR_TACEN << i;
+    }
+
+#if HALF_BRIDGE_PHASES > 1
+    // Master timer with same clock as the timing units
+    HRTIM1->sMasterRegs.MCR |= (HRTIM_CKPSC << HRTIM_MCR_CK_PSC_Pos) | HRTIM_MCR_CONT;
+    tim_set_phase_shift(arr);
+    mcr |= HRTIM_MCR_MCEN;
+#endif
+
+    // activate trigger for ADC (in the middle of the on-time of the first phase)
+    HRTIM1_COMMON->CR1 = HRTIM_CR1_ADC1USRC_0; // ADC trigger update: Timer A
+    HRTIM1_COMMON->ADC1R = HRTIM_ADC1R_AD1TAC3; // ADC trigger event: Timer A compare 3
+
+    // Start timers
+    HRTIM1->sMasterRegs.MCR |= mcr;
+}
+
+void tim_set_arr(uint16_t arr)
+{
+    // no preload, so the order of CMP1 and PER updates is handled by the caller
+    for (int i = 0; i < HALF_BRIDGE_PHASES; i++) {
+        tim_unit(i)->PERxR = arr;
+    }
+    tim_set_phase_shift(arr);
+}
+
+bool tim_set_deadtime(int deadtime_ns)
+{
+    uint32_t dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+    if (deadtime_ns < 0 || dt_clocks > TIM_DT_CLOCKS_MAX) {
+        return false;
+    }
+
+    // only the signs are locked, the values can still be changed
+    tim_dt_clocks = dt_clocks;
+    for (int i = 0; i < HALF_BRIDGE_PHASES; i++) {
+        tim_unit(i)->DTxR = (tim_unit(i)->DTxR & ~(HRTIM_DTR_DTF | HRTIM_DTR_DTR)) |
+            (tim_dt_clocks << 16U) | tim_dt_clocks;
+    }
+    return true;
+}
+
+void tim_outputs_enable()
+{
+    HRTIM1->sCommonRegs.OENR = tim_outputs_mask(tim_hs_selected, tim_ls_selected);
+    HRTIM1->sCommonRegs.ODISR = tim_outputs_mask(!tim_hs_selected, !tim_ls_selected);
+}
+
+void tim_outputs_disable()
+{
+    HRTIM1->sCommonRegs.ODISR = tim_outputs_mask(true, true);
+}
+
+uint16_t tim_get_arr()
+{
+    return HRTIM1_TIMA->PERxR;
+}
+
+uint16_t tim_get_ccr_step()
+{
+    // single counts of the high resolution timer are too small for the control algorithms
+    return 0;
+}
+
+uint16_t tim_get_ccr(int phase)
+{
+    return tim_unit(phase)->CMP1xR;
+}
+
+void tim_set_ccr(int phase, uint16_t ccr)
+{
+    tim_unit(phase)->CMP1xR = ccr;
+
+    if (phase == 0) {
+        // Trigger ADC for current measurement in the middle of the cycle.
+        // A negative offset of 80 system clocks was found to improve current measurement
+        // accuracy and compensate the ADC delay (no risk of underflow, as the minimum duty
+        // cycle is much larger than 2 * 80 system clocks).
+        HRTIM1_TIMA->CMP3xR = HRTIM1_TIMA->CMP1xR / 2 - 80 * HRTIM_CLOCK_MUL;
+    }
+}
+
+bool tim_outputs_enabled()
+{
+    return (HRTIM1->sCommonRegs.OENR & tim_outputs_mask(true, true)) > 0;
+}
+
+void tim_outputs_select(bool high_side, bool low_side)
+{
+    tim_hs_selected = high_side;
+    tim_ls_selected = low_side;
+    if (tim_outputs_enabled()) {
+        tim_outputs_enable();
+    }
+}
+
+#endif // HRTIM1
+
+#else // UNIT_TEST
+
+// dummy registers
+uint32_t tim_ccr[HALF_BRIDGE_PHASES];
+uint32_t tim_arr = 0;
+bool pwm_enabled = false;
+
+// behaves like a high resolution timer by default, can be changed by the tests
+uint16_t tim_ccr_step = 0;
+
+uint32_t tim_calculate_arr(int freq_kHz)
+{
+    // assuming edge-aligned PWM like with TIM1
+    return SystemCoreClock / (freq_kHz * 1000);
+}
+
+void tim_init_registers(int freq_kHz, int deadtime_ns)
+{
+    tim_dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+    tim_arr = tim_calculate_arr(freq_kHz);
+}
+
+void tim_set_arr(uint16_t arr)
+{
+    tim_arr = arr;
+}
+
+bool tim_set_deadtime(int deadtime_ns)
+{
+    uint32_t dt_clocks = tim_calculate_dt_clocks(deadtime_ns);
+    if (deadtime_ns < 0 || dt_clocks > TIM_DT_CLOCKS_MAX) {
+        return false;
+    }
+
+    tim_dt_clocks = dt_clocks;
+    return true;
+}
+
+void tim_outputs_enable()
+{
+    pwm_enabled = true;
+}
+
+void tim_outputs_disable()
+{
+    pwm_enabled = false;
+}
+
+uint16_t tim_get_arr()
+{
+    return tim_arr;
+}
+
+uint16_t tim_get_ccr_step()
+{
+    return tim_ccr_step;
+}
+
+uint16_t tim_get_ccr(int phase)
+{
+    return tim_ccr[phase];
+}
+
+void tim_set_ccr(int phase, uint16_t ccr)
+{
+    tim_ccr[phase] = ccr;   // high-side
+}
+
+bool tim_outputs_enabled()
+{
+    return pwm_enabled;
+}
+
+void tim_outputs_select(bool high_side, bool low_side)
+{
+    tim_hs_selected = high_side;
+    tim_ls_selected = low_side;
+}
+
+#endif /* UNIT_TEST */
+
+int tim_get_deadtime()
+{
+    return tim_dt_clocks * 1000 / (SystemCoreClock / 1000000);
+}
+
+#endif /* BOARD_HAS_DCDC */
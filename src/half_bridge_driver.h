@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HALF_BRIDGE_DRIVER_H_
+#define HALF_BRIDGE_DRIVER_H_
+
+/**
+ * @file
+ *
+ * @brief Timer backend of the half bridge
+ *
+ * The backend only provides raw register access for the timer selected in the board devicetree
+ * (TIM1, TIM3 or HRTIM) or a stub for unit tests. All HALF_BRIDGE_PHASES phases share the
+ * same period and are shifted by 360 / HALF_BRIDGE_PHASES degrees. Duty cycle limits, burst
+ * mode and frequency changes are implemented in half_bridge.cpp on top of this interface.
+ *
+ * All compare and period values are given in counts of the timer, so the resolution depends
+ * on the backend (e.g. 735 ps for the HRTIM).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize timer registers and output pins
+ *
+ * @param freq_kHz Switching frequency in kHz
+ * @param deadtime_ns Deadtime in ns between switching the two FETs on/off
+ */
+void tim_init_registers(int freq_kHz, int deadtime_ns);
+
+/**
+ * Calculate the timer period for given frequency
+ *
+ * @returns Period in timer counts or UINT32_MAX if the frequency is not possible
+ */
+uint32_t tim_calculate_arr(int freq_kHz);
+
+/**
+ * Set the timer period of all phases (applied with next update event if supported by the timer)
+ */
+void tim_set_arr(uint16_t arr);
+
+/**
+ * Get the timer period
+ */
+uint16_t tim_get_arr();
+
+/**
+ * Get the fixed compare value step of the control algorithms
+ *
+ * @returns Step in timer counts or 0 if the step should be derived from the period
+ */
+uint16_t tim_get_ccr_step();
+
+/**
+ * Set the compare value for the high-side MOSFET of one phase (without any limits)
+ */
+void tim_set_ccr(int phase, uint16_t ccr);
+
+/**
+ * Get the compare value for the high-side MOSFET of one phase
+ */
+uint16_t tim_get_ccr(int phase);
+
+/**
+ * Change the deadtime
+ *
+ * @returns true if successful, false if not valid or not supported by the timer
+ */
+bool tim_set_deadtime(int deadtime_ns);
+
+/**
+ * Get the deadtime as applied to the timer (ns)
+ */
+int tim_get_deadtime();
+
+/**
+ * Enable the PWM outputs
+ */
+void tim_outputs_enable();
+
+/**
+ * Disable the PWM outputs (both MOSFETs off)
+ */
+void tim_outputs_disable();
+
+/**
+ * Get status of the PWM outputs
+ */
+bool tim_outputs_enabled();
+
+/**
+ * Select which MOSFETs are switched while the outputs are enabled
+ *
+ * Applied immediately if the outputs are already enabled.
+ *
+ * @param high_side Switch the high-side MOSFET
+ * @param low_side Switch the low-side MOSFET
+ */
+void tim_outputs_select(bool high_side, bool low_side);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HALF_BRIDGE_DRIVER_H_ */
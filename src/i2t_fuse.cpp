@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "i2t_fuse.h"
+
+bool I2tFuse::update(float current)
+{
+    heat += (current * current - current_nom * current_nom) * sample_time;
+
+    if (heat < 0) {
+        heat = 0;
+    }
+    else if (heat >= i2t) {
+        // keep at limit so that the fuse trips again immediately if the overcurrent persists
+        heat = i2t;
+        return true;
+    }
+    return false;
+}
+
+float I2tFuse::trip_time(float current) const
+{
+    float excess = current * current - current_nom * current_nom;
+
+    if (excess <= 0) {
+        return -1;
+    }
+    return i2t / excess;
+}
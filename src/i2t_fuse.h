@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef I2T_FUSE_H
+#define I2T_FUSE_H
+
+/** @file
+ *
+ * @brief Electronic fuse based on an I²t trip curve
+ *
+ * The heating of MOSFETs, PCB traces and wires is proportional to the squared current. The fuse
+ * integrates the excess heat above the nominal current
+ *
+ *     W(n) = max(0, W(n-1) + (i(n)² - i_nom²) * dt)
+ *
+ * and trips as soon as W exceeds the I²t limit. For a constant current i > i_nom this results
+ * in the trip time
+ *
+ *     t_trip = I²t / (i² - i_nom²)
+ *
+ * i.e. high short-circuit currents trip within a few samples while moderate overcurrents are
+ * allowed for a longer time. Currents below nominal cool the fuse down again.
+ *
+ * The update function is designed to be called for every ADC sample of the current.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * I²t electronic fuse
+ */
+class I2tFuse
+{
+public:
+    /**
+     * Create fuse
+     *
+     * @param current_nom Nominal current which can be carried continuously (A)
+     * @param i2t I²t limit (A²s)
+     * @param sample_time Time between two calls of update() (s)
+     */
+    I2tFuse(float current_nom, float i2t, float sample_time) :
+        current_nom(current_nom),
+        i2t(i2t),
+        sample_time(sample_time)
+    {}
+
+    /**
+     * Update the fuse model with a new current measurement
+     *
+     * @param current Latest (unfiltered) current measurement (A)
+     *
+     * @returns true if the fuse tripped with this measurement
+     */
+    bool update(float current);
+
+    /**
+     * Theoretical trip time for a constant current starting with a cold fuse
+     *
+     * @param current Constant current (A)
+     *
+     * @returns Trip time (s) or a negative value if the fuse never trips at this current
+     */
+    float trip_time(float current) const;
+
+    /**
+     * Load of the fuse relative to the trip point (0 = cold, 1 = trip)
+     */
+    float level() const
+    {
+        return heat / i2t;
+    }
+
+    /**
+     * Cool down the fuse completely, e.g. after the output was switched off for a long time
+     */
+    void reset()
+    {
+        heat = 0;
+    }
+
+    float current_nom;      ///< Nominal current (A)
+    float i2t;              ///< I²t limit (A²s)
+
+private:
+    float sample_time;      ///< Time between two updates (s)
+    float heat = 0;         ///< Integrated excess I²t (A²s)
+};
+
+#endif /* I2T_FUSE_H */
@@ -22,10 +22,20 @@
 #define PCB_MOSFETS_TAU_JA      DT_PROP(DT_PATH(pcb), mosfets_tau_ja)
 #define PCB_INTERNAL_TREF_MAX   DT_PROP(DT_PATH(pcb), internal_tref_max)
 
+// fast_control() is called for each ADC sample (1 kHz)
+#define FAST_CONTROL_SAMPLE_TIME    0.001F
+
+// soft-start is aborted if the ramp could not be completed within this multiple of its duration
+#define SOFT_START_TIMEOUT_FACTOR   4
+
 extern DeviceStatus dev_stat;
 
-LoadOutput::LoadOutput(DcBus *dc_bus, void (*switch_fn)(bool), void (*init_fn)(), bool (*pgood_fn)()) :
+LoadOutput::LoadOutput(DcBus *dc_bus, void (*switch_fn)(bool), void (*init_fn)(), bool (*pgood_fn)(),
+    uint32_t soft_start_ms) :
     PowerPort(dc_bus),
+    soft_start_time(soft_start_ms),
+    fuse(LOAD_CURRENT_MAX, 3.0F * LOAD_CURRENT_MAX * LOAD_CURRENT_MAX *
+        CONFIG_LOAD_FUSE_TRIP_TIME / 1000.0F, FAST_CONTROL_SAMPLE_TIME),
     switch_set(switch_fn),
     pgood_check(pgood_fn)
 {
@@ -42,9 +52,34 @@ LoadOutput::LoadOutput(DcBus *dc_bus, void (*switch_fn)(bool), void (*init_fn)()
 
     ov_hysteresis = 0.3;
 
+    inrush_current_limit = LOAD_CURRENT_MAX * 2;
+
     enable = true;  // switch on in next control() call if everything is fine
 }
 
+void LoadOutput::check_voltage_limits()
+{
+    if (bus->voltage < bus->src_control_voltage(disconnect_voltage)) {
+        flags_set(&error_flags, ERR_LOAD_SHEDDING);
+        lvd_timestamp = uptime();
+    }
+
+    // long-term overvoltage (overvoltage transients are detected as an ADC alert and switch
+    // off the solar input instead of the load output)
+    if (bus->voltage > bus->series_voltage(overvoltage) ||
+        bus->voltage > PCB_LS_VOLTAGE_MAX)
+    {
+        ov_debounce_counter++;
+        if (ov_debounce_counter > CONFIG_CONTROL_FREQUENCY) {
+            // waited 1s before setting the flag
+            flags_set(&error_flags, ERR_LOAD_OVERVOLTAGE);
+        }
+    }
+    else {
+        ov_debounce_counter = 0;
+    }
+}
+
 // this function is called more often than the state machine
 void LoadOutput::control()
 {
@@ -73,25 +108,11 @@ void LoadOutput::control()
             flags_set(&error_flags, ERR_LOAD_BUS_SRC_CURRENT);
         }
 
-        if (bus->voltage < bus->src_control_voltage(disconnect_voltage)) {
+        if (shed) {
             flags_set(&error_flags, ERR_LOAD_SHEDDING);
-            lvd_timestamp = uptime();
         }
 
-        // long-term overvoltage (overvoltage transients are detected as an ADC alert and switch
-        // off the solar input instead of the load output)
-        if (bus->voltage > bus->series_voltage(overvoltage) ||
-            bus->voltage > PCB_LS_VOLTAGE_MAX)
-        {
-            ov_debounce_counter++;
-            if (ov_debounce_counter > CONFIG_CONTROL_FREQUENCY) {
-                // waited 1s before setting the flag
-                flags_set(&error_flags, ERR_LOAD_OVERVOLTAGE);
-            }
-        }
-        else {
-            ov_debounce_counter = 0;
-        }
+        check_voltage_limits();
 
         if (error_flags) {
             stop();
@@ -102,10 +123,30 @@ void LoadOutput::control()
             state = LOAD_STATE_OFF;
         }
     }
+    else if (state == LOAD_STATE_SOFT_START) {
+        // switching is done in fast_control(), inrush current and voltage dips are handled there
+
+        if (bus->src_current_margin > -0.1F) {
+            flags_set(&error_flags, ERR_LOAD_BUS_SRC_CURRENT);
+        }
+
+        if (shed) {
+            flags_set(&error_flags, ERR_LOAD_SHEDDING);
+        }
+
+        check_voltage_limits();
+
+        if (error_flags || enable == false) {
+            stop();
+        }
+    }
     else {
         // load is off: check if errors are resolved and if load can be switched on
 
-        if (flags_check(&error_flags, ERR_LOAD_SHEDDING) &&
+        if (shed) {
+            flags_set(&error_flags, ERR_LOAD_SHEDDING);
+        }
+        else if (flags_check(&error_flags, ERR_LOAD_SHEDDING) &&
             bus->voltage > bus->src_control_voltage(reconnect_voltage) &&
             uptime() - lvd_timestamp > lvd_recovery_delay)
         {
@@ -136,19 +177,106 @@ void LoadOutput::control()
 
         // finally switch on if all errors were resolved and at least 1A src current is available
         if (enable == true && !error_flags && bus->src_current_margin < -1.0F) {
-            switch_set(true);
-            state = LOAD_STATE_ON;
+            if (soft_start_time > 0) {
+                ss_ticks = 0;
+                ss_ramp = 0;
+                ss_limited = false;
+                ss_switch_on = false;
+                ss_error = ERR_LOAD_OVERCURRENT;
+                inrush_current_peak = 0;
+                state = LOAD_STATE_SOFT_START;
+            }
+            else {
+                switch_set(true);
+                state = LOAD_STATE_ON;
+            }
         }
     }
 
     info = error_flags > 0 ? -error_flags : state;
 }
 
+void LoadOutput::fast_control(float current_now)
+{
+    // the fuse is also updated while the load is off so that it cools down
+    if (fuse.update(current_now) && state != LOAD_STATE_OFF) {
+        stop(ERR_LOAD_OVERCURRENT);
+        return;
+    }
+
+    if (state != LOAD_STATE_SOFT_START) {
+        return;
+    }
+
+    if (current_now > inrush_current_peak) {
+        inrush_current_peak = current_now;
+    }
+
+    if (current_now > inrush_current_limit) {
+        soft_start_limit(ERR_LOAD_OVERCURRENT);
+    }
+
+    uint32_t phase = ss_ticks % LOAD_SOFT_START_PERIOD;
+    if (phase == 0 && ss_ticks > 0) {
+        // new PWM period: only increase the on-time if the last period was not limited
+        if (!ss_limited) {
+            ss_ramp += LOAD_SOFT_START_PERIOD;
+        }
+        ss_limited = false;
+    }
+    ss_ticks++;
+
+    if (ss_ramp >= soft_start_time) {
+        inrush_duration = ss_ticks;
+        switch_set(true);
+        state = LOAD_STATE_ON;
+    }
+    else if (ss_ticks > soft_start_time * SOFT_START_TIMEOUT_FACTOR) {
+        inrush_duration = ss_ticks;
+        stop(ss_error);
+    }
+    else {
+        uint32_t on_ticks = 1 + ss_ramp * (LOAD_SOFT_START_PERIOD - 1) / soft_start_time;
+        soft_start_switch(phase < on_ticks && !ss_limited);
+    }
+}
+
+void LoadOutput::voltage_dip()
+{
+    if (state == LOAD_STATE_SOFT_START) {
+        soft_start_limit(ERR_LOAD_VOLTAGE_DIP);
+    }
+    else {
+        stop(ERR_LOAD_VOLTAGE_DIP);
+    }
+}
+
+void LoadOutput::soft_start_switch(bool on)
+{
+    if (on != ss_switch_on) {
+        switch_set(on);
+        ss_switch_on = on;
+    }
+}
+
+void LoadOutput::soft_start_limit(uint32_t error_flag)
+{
+    if (state == LOAD_STATE_SOFT_START) {
+        soft_start_switch(false);
+        ss_limited = true;
+        ss_error = error_flag;
+    }
+}
+
 void LoadOutput::stop(uint32_t flag)
 {
+    // fast_control() is called from the ADC ISR and would switch the load on again during
+    // soft-start if it preempted the thread between switching off and the state change
+    unsigned int key = irq_lock();
     switch_set(false);
     state = LOAD_STATE_OFF;
     flags_set(&error_flags, flag);
+    irq_unlock(key);
 
     // flicker the load LED if failure was most probably caused by the user
     if (flags_check(&error_flags,
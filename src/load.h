@@ -19,14 +19,21 @@
 
 #ifdef __cplusplus
 
+#include "i2t_fuse.h"
 #include "power_port.h"
 
+/**
+ * PWM period of the load switch during soft-start (ms)
+ */
+#define LOAD_SOFT_START_PERIOD  10
+
 /**
  * Load/USB output states
  */
 enum LoadState {
     LOAD_STATE_OFF = 0,             ///< Actively disabled
     LOAD_STATE_ON = 1,              ///< Normal state: On
+    LOAD_STATE_SOFT_START = 2,      ///< Switch is pulsed to charge capacitive loads
 };
 
 
@@ -43,7 +50,7 @@ enum LoadErrorFlag {
      * charge (SOC) in case of more advanced battery management.
      *
      * Set in LoadOutput::control() and cleared after reconnect delay passed and voltage is above
-     * reconnect threshold again.
+     * reconnect threshold again. Also set as long as shedding is requested by the LoadManager.
      */
     ERR_LOAD_SHEDDING = 1U << 0,
 
@@ -57,7 +64,8 @@ enum LoadErrorFlag {
     /**
      * Long-term overcurrent at load port
      *
-     * Set in LoadOutput::control() and cleared after configurable delay.
+     * Set in LoadOutput::control() or by the I²t fuse in LoadOutput::fast_control() and cleared
+     * after configurable delay.
      */
     ERR_LOAD_OVERCURRENT = 1U << 2,
 
@@ -99,8 +107,11 @@ public:
      * @param switch_fn Pointer to function for enabling/disabling load switch
      * @param init_fn Pointer to function for load driver initialization
      * @param pgood_fn Pointer to pgood check
+     * @param soft_start_ms Soft-start ramp time (0 for immediate switching, which must be used
+     *                      if fast_control() is not called for this output)
      */
-    LoadOutput(DcBus *dc_bus, void (*switch_fn)(bool), void (*init_fn)(), bool (*pgood_fn)());
+    LoadOutput(DcBus *dc_bus, void (*switch_fn)(bool), void (*init_fn)(), bool (*pgood_fn)(),
+        uint32_t soft_start_ms = 0);
 
     /** Main load control function, should be called by control timer
      *
@@ -108,6 +119,30 @@ public:
      */
     void control();
 
+    /** Fast load control function, called for every new ADC sample of the load current
+     *
+     * Updates the I²t fuse model and stops the load if the fuse trips.
+     *
+     * During soft-start, the load switch is operated with a PWM of LOAD_SOFT_START_PERIOD ms
+     * and an on-time increasing linearly from 1 ms to the full period within soft_start_time.
+     * Each pulse is cut short if the current exceeds inrush_current_limit or if a voltage dip
+     * is reported, and the ramp does not advance in such a period.
+     *
+     * May be called from an ISR (typically with 1 kHz sample rate)
+     *
+     * @param current_now Latest (unfiltered) load current measurement
+     */
+    void fast_control(float current_now);
+
+    /** Handle voltage dip detected by the fast ADC alert
+     *
+     * During soft-start, only the current pulse is stopped. Otherwise the load is switched off
+     * and ERR_LOAD_VOLTAGE_DIP is set.
+     *
+     * May be called from an ISR
+     */
+    void voltage_dip();
+
     /** Fast emergency stop function
      *
      * May be called from an ISR which detected overvoltage / overcurrent conditions
@@ -136,6 +171,8 @@ public:
     bool enable = false;        ///< Target on state set via communication port (overruled if
                                 ///< battery is empty or any errors occured)
 
+    bool shed = false;          ///< Load shedding requested by LoadManager (e.g. based on SOC)
+
     time_t oc_timestamp;        ///< Time when last overcurrent event occured
     int32_t oc_recovery_delay;  ///< Seconds before we attempt to re-enable the load
                                 ///< after an overcurrent event
@@ -153,7 +190,33 @@ public:
     float overvoltage = 0;      ///< Upper voltage limit
     float ov_hysteresis;        ///< Hysteresis to switch back on after an overvoltage event
 
+    uint32_t soft_start_time;   ///< Duration of the soft-start ramp in ms (0 = switch on
+                                ///< immediately)
+    float inrush_current_limit; ///< Current that cuts a soft-start pulse short (A)
+
+    I2tFuse fuse;               ///< Electronic fuse evaluated in fast_control()
+
+    float inrush_current_peak = 0;  ///< Peak current measured during last soft-start (A)
+    uint32_t inrush_duration = 0;   ///< Duration of last soft-start until the load was fully
+                                    ///< switched on or soft-start timed out (ms)
+
 private:
+    /**
+     * Check low voltage disconnect and long-term overvoltage while the output is switched on
+     * or in soft-start
+     */
+    void check_voltage_limits();
+
+    /**
+     * Set switch during soft-start, only calling the driver function if the state changed
+     */
+    void soft_start_switch(bool on);
+
+    /**
+     * Stop current soft-start pulse and hold the ramp
+     */
+    void soft_start_limit(uint32_t error_flag);
+
     /**
      * Pointer to the load switch function
      */
@@ -173,6 +236,12 @@ private:
      * Used to prevent switching off because of short voltage spike
      */
     int ov_debounce_counter = 0;
+
+    uint32_t ss_ticks = 0;      ///< Elapsed time since soft-start began (ms)
+    uint32_t ss_ramp = 0;       ///< Position on the soft-start ramp (ms)
+    bool ss_limited = false;    ///< Current or voltage limit was hit in this PWM period
+    bool ss_switch_on = false;  ///< Current state of the switch during soft-start
+    uint32_t ss_error = ERR_LOAD_OVERCURRENT;   ///< Error flag set if soft-start times out
 };
 #endif
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "load_manager.h"
+
+#include "helper.h"
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+bool LoadManager::shedding_required(const LoadChannel *ch, uint16_t soc) const
+{
+    if (ch->priority > priority_limit) {
+        return true;
+    }
+
+    if (ch->off_start != ch->off_end && time_of_day != TIME_OF_DAY_UNKNOWN) {
+        uint16_t minute = time_of_day / 60;
+        bool off_time;
+        if (ch->off_start < ch->off_end) {
+            off_time = minute >= ch->off_start && minute < ch->off_end;
+        }
+        else {
+            // off-time across midnight
+            off_time = minute >= ch->off_start || minute < ch->off_end;
+        }
+        if (off_time) {
+            return true;
+        }
+    }
+
+    if (ch->output->shed) {
+        return soc < ch->soc_reconnect && ch->soc_disconnect > 0;
+    }
+    else {
+        return soc < ch->soc_disconnect;
+    }
+}
+
+void LoadManager::update(uint16_t soc)
+{
+    if (time_of_day != TIME_OF_DAY_UNKNOWN) {
+        time_of_day = (time_of_day + 1) % SECONDS_PER_DAY;
+    }
+
+    if (stagger_counter < UINT32_MAX) {
+        stagger_counter++;
+    }
+
+    bool reconnect_pending = false;
+    LoadChannel *next = NULL;
+
+    for (size_t i = 0; i < num_channels; i++) {
+        LoadChannel *ch = &channels[i];
+        bool low_voltage = flags_check(&ch->output->error_flags, ERR_LOAD_SHEDDING);
+
+        if (shedding_required(ch, soc)) {
+            ch->output->shed = true;
+            ch->reconnecting = false;
+        }
+        else if (ch->reconnecting) {
+            if (!low_voltage) {
+                // output reconnected (or at least allowed to by its own voltage limits)
+                ch->reconnecting = false;
+                stagger_counter = 0;
+            }
+            else {
+                reconnect_pending = true;
+            }
+        }
+        else if (low_voltage && !ch->output->shed) {
+            // disconnected by its own LVD: take over reconnect
+            ch->output->shed = true;
+        }
+
+        if (ch->output->shed && !shedding_required(ch, soc) &&
+            (next == NULL || ch->priority < next->priority))
+        {
+            next = ch;
+        }
+    }
+
+    if (next != NULL && !reconnect_pending && stagger_counter >= reconnect_stagger) {
+        next->output->shed = false;
+        next->reconnecting = true;
+    }
+}
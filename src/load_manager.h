@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LOAD_MANAGER_H
+#define LOAD_MANAGER_H
+
+/** @file
+ *
+ * @brief Priority-based load shedding for multiple load outputs
+ *
+ * Each load output only disconnects itself at a low battery voltage (LVD). The load manager
+ * additionally requests load shedding based on the state of charge (SOC) and the time of day,
+ * with individual thresholds for each output. Critical outputs should be configured with lower
+ * SOC thresholds than non-critical ones, so that they stay on longest.
+ *
+ * Reconnecting is staggered: Only one output is released at a time, starting with the highest
+ * priority, and the next one only after the previous output was actually switched on and the
+ * stagger delay has passed. This prevents a simultaneous inrush of all loads, which could cause
+ * another voltage dip. Outputs disconnected by their own LVD also reconnect in this sequence.
+ */
+
+#include <zephyr.h>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "load.h"
+
+/**
+ * Value of LoadManager::time_of_day if no clock is available
+ */
+#define TIME_OF_DAY_UNKNOWN UINT32_MAX
+
+/**
+ * Load shedding settings of one output
+ */
+struct LoadChannel
+{
+    LoadOutput *output;
+
+    uint16_t priority;          ///< Reconnect priority (0 = highest, i.e. most critical load)
+
+    uint16_t soc_disconnect;    ///< Shed the load below this SOC (%), 0 to disable
+    uint16_t soc_reconnect;     ///< Release the load at or above this SOC (%)
+
+    uint16_t off_start;         ///< Begin of daily off-time (minutes since midnight)
+    uint16_t off_end;           ///< End of daily off-time (off_start == off_end to disable)
+
+    bool reconnecting;          ///< Released by the manager, but not yet switched on again
+};
+
+/**
+ * Load manager for multiple load outputs connected to the same battery
+ */
+class LoadManager
+{
+public:
+    /**
+     * Create load manager
+     *
+     * @param channels Array of load channels (not copied)
+     * @param num Number of channels
+     */
+    LoadManager(LoadChannel *channels, size_t num) :
+        channels(channels),
+        num_channels(num)
+    {}
+
+    /**
+     * Update load shedding requests of all outputs, must be called once per second
+     *
+     * @param soc Current state of charge of the battery (%)
+     */
+    void update(uint16_t soc);
+
+    /**
+     * Check if priority, time-of-day or SOC based shedding applies for a channel
+     *
+     * The hysteresis between disconnect and reconnect SOC is applied based on the current
+     * shedding state of the output.
+     */
+    bool shedding_required(const LoadChannel *ch, uint16_t soc) const;
+
+    /**
+     * Seconds since midnight (local time), advanced in update()
+     *
+     * Must be set externally (e.g. via ThingSet), as the charge controller does not have a
+     * real-time clock. Time-based shedding is disabled as long as it is unknown.
+     */
+    uint32_t time_of_day = TIME_OF_DAY_UNKNOWN;
+
+    /**
+     * Delay between reconnecting two outputs (s)
+     */
+    uint32_t reconnect_stagger = CONFIG_LOAD_RECONNECT_STAGGER;
+
+    /**
+     * Channels with a higher priority value (i.e. less critical loads) are shed
+     *
+     * Used e.g. by the EnergyForecast to switch off non-critical loads before the battery is
+     * empty.
+     */
+    uint16_t priority_limit = UINT16_MAX;
+
+private:
+    LoadChannel *channels;
+    size_t num_channels;
+
+    uint32_t stagger_counter = UINT32_MAX;  ///< Seconds since the last output was reconnected
+};
+
+#endif /* LOAD_MANAGER_H */
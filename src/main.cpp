@@ -45,13 +45,13 @@ void main(void)
     daq_set_hv_limit(DT_PROP(DT_PATH(pcb), hs_voltage_max));
     #endif
 
-    #if CONFIG_HV_TERMINAL_SOLAR || CONFIG_LV_TERMINAL_SOLAR || CONFIG_PWM_TERMINAL_SOLAR
-    solar_terminal.init_solar();
-    #endif
+    if constexpr (HAS_SOLAR_TERMINAL) {
+        solar_terminal.init_solar();
+    }
 
-    #if CONFIG_HV_TERMINAL_NANOGRID
-    grid_terminal.init_nanogrid();
-    #endif
+    if constexpr (HAS_GRID_TERMINAL) {
+        grid_terminal.init_nanogrid();
+    }
 
     // read custom configuration from EEPROM
     data_nodes_init();
@@ -83,30 +83,25 @@ void main(void)
         charger.discharge_control(&bat_conf);
         charger.charge_control(&bat_conf);
 
-        // energy + soc calculation must be called exactly once per second
-        #if BOARD_HAS_DCDC
-        if  (dcdc.state != DCDC_CONTROL_OFF) {
-            hv_terminal.energy_balance();
-        }
-        #endif
-
-        #if BOARD_HAS_PWM_PORT
-        if (pwm_switch.active() == 1) {
-            pwm_switch.energy_balance();
-        }
+        #if HAS_LOAD_MANAGER
+        load_manager.update(charger.soc);
         #endif
 
+        // energy calculation must be called exactly once per second
+        PowerComponents::energy_balance();
         lv_terminal.energy_balance();
 
-        #if BOARD_HAS_LOAD_OUTPUT
-        if (load.state == 1) {
-            load.energy_balance();
-        }
-        #endif
-
         dev_stat.update_energy();
         dev_stat.update_min_max_values();
-        charger.update_soc(&bat_conf);
+
+        #if HAS_ENERGY_FORECAST
+        float capacity = (charger.usable_capacity > 0.0F) ?
+            charger.usable_capacity : bat_conf.nominal_capacity;
+        energy_forecast.update(dev_stat.seconds_zero_solar, -bat_terminal.power, charger.soc,
+            capacity * bat_terminal.bus->voltage);
+        // keep only the most critical loads on if the battery would not last until sunrise
+        load_manager.priority_limit = energy_forecast.reduce_loads ? 0 : UINT16_MAX;
+        #endif
 
         #if CONFIG_HS_MOSFET_FAIL_SAFE_PROTECTION && BOARD_HAS_DCDC
         if (dev_stat.has_error(ERR_DCDC_HS_MOSFET_SHORT)) {
@@ -136,38 +131,32 @@ void control_thread()
     while (true) {
         // control loop runs at approx. 10 Hz
 
-        bool charging = false;
-
         task_wdt_feed(wdt_channel);
 
         // convert ADC readings to meaningful measurement values
         daq_update();
 
-        // alerts should trigger only for transients, so update based on actual voltage
-        daq_set_lv_limits(lv_terminal.bus->voltage * 1.2F, lv_terminal.bus->voltage * 0.8F);
+        // coulomb counting needs every single measurement
+        charger.update_soc(&bat_conf);
 
-        lv_terminal.update_bus_current_margins();
+        // limits from external BMS must be applied before the setpoints are used for control
+        charger.apply_bms_limits();
 
-        #if BOARD_HAS_PWM_PORT
-        pwm_switch.control();
-        charging |= pwm_switch.active();
+        #if CONFIG_CURRENT_SHARING && BOARD_HAS_DCDC
+        // only units in CV mode are able to increase their current
+        current_sharing.control(dcdc.state != DCDC_CONTROL_CV_LS &&
+            dcdc.state != DCDC_CONTROL_CV_HS);
         #endif
 
-        #if BOARD_HAS_DCDC
-        hv_terminal.update_bus_current_margins();
-        dcdc.control();     // control of DC/DC including MPPT algorithm
-        charging |= half_bridge_enabled();
-        #endif
+        // alerts should trigger only for transients, so update based on actual voltage
+        daq_set_lv_limits(lv_terminal.bus->voltage * 1.2F, lv_terminal.bus->voltage * 0.8F);
 
-        leds_set_charging(charging);
+        lv_terminal.update_bus_current_margins();
 
-        #if BOARD_HAS_LOAD_OUTPUT
-        load.control();
-        #endif
+        // charger components before load outputs
+        PowerComponents::control();
 
-        #if BOARD_HAS_USB_OUTPUT
-        usb_pwr.control();
-        #endif
+        leds_set_charging(PowerComponents::charging());
 
         k_sleep(K_MSEC(100));
     }
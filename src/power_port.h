@@ -55,6 +55,12 @@ public:
      */
     float sink_voltage_intercept;
 
+    /**
+     * Offset added to the sink_voltage_intercept by a secondary controller, e.g. to balance the
+     * current of multiple units connected to the same bus (see CurrentSharing)
+     */
+    float sink_voltage_offset = 0;
+
     /**
      * Lower voltage boundary where this bus may be used to source current.
      *
@@ -120,11 +126,13 @@ public:
      * Calculate current-compensated sink control voltage, considering droop and series multiplier
      *
      * @param voltage_zero_current Voltage at zero current (without droop). If this parameter is
-     *                             left empty, the sink_voltage_intercept is considered.
+     *                             left empty, the sink_voltage_intercept (incl. offset) is
+     *                             considered.
      */
     inline float sink_control_voltage(float voltage_zero_current = 0)
     {
-        float v0 = (voltage_zero_current == 0) ? sink_voltage_intercept : voltage_zero_current;
+        float v0 = (voltage_zero_current == 0) ?
+            sink_voltage_intercept + sink_voltage_offset : voltage_zero_current;
         if (ref_current != nullptr) {
             return (v0 - sink_droop_res * (*ref_current)) * series_multiplier;
         }
@@ -133,6 +141,30 @@ public:
         }
     }
 
+    /**
+     * Calculate current setpoint for voltage-droop control of the bus
+     *
+     * Current is supplied to the bus if its voltage is below the sink voltage intercept and
+     * drawn from the bus if the voltage is above the src voltage intercept, proportional to the
+     * voltage deviation divided by the droop (virtual) resistance. In between, no current is
+     * exchanged. If both intercepts are equal, this results in a pure droop characteristic.
+     *
+     * @returns Current towards the bus (A), negative sign if current should be drawn from the bus
+     */
+    inline float droop_current()
+    {
+        float v = voltage / series_multiplier;
+        if (v < sink_voltage_intercept && sink_droop_res > 0) {
+            return (sink_voltage_intercept - v) / sink_droop_res;
+        }
+        else if (v > src_voltage_intercept && src_droop_res > 0) {
+            return (src_voltage_intercept - v) / src_droop_res;
+        }
+        else {
+            return 0;
+        }
+    }
+
     /**
      * Calculate voltage for series connected batteries based on setpoint for single battery
      *
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "pub_channel.h"
+
+#include <zephyr.h>
+
+uint32_t PubChannel::interval_limited()
+{
+    // interval can be changed via ThingSet without any checks
+    if (interval < PUB_INTERVAL_MIN) {
+        return PUB_INTERVAL_MIN;
+    }
+    else {
+        return interval;
+    }
+}
+
+bool PubChannel::due(int64_t now)
+{
+    if (!enable) {
+        // publish immediately after (re-)enabling and start new schedule from there
+        restart = true;
+        // nodes are typically changed while the channel is disabled
+        nodes_changed = true;
+        return false;
+    }
+
+    if (restart) {
+        restart = false;
+        next_pub = now + interval_limited();
+        return true;
+    }
+    else if (now < next_pub) {
+        return false;
+    }
+
+    next_pub += interval_limited();
+    if (next_pub <= now) {
+        // skip missed publications instead of sending them in a burst
+        next_pub = now + interval_limited();
+    }
+    return true;
+}
+
+int64_t PubChannel::next(int64_t now)
+{
+    if (!enable) {
+        return INT64_MAX;
+    }
+    else if (restart || next_pub < now) {
+        return now;
+    }
+    else {
+        return next_pub;
+    }
+}
+
+int64_t pub_channels_next(PubChannel *channels, int num, int64_t now)
+{
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < num; i++) {
+        int64_t ch_next = channels[i].next(now);
+        if (ch_next < next) {
+            next = ch_next;
+        }
+    }
+    return next;
+}
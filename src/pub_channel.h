@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PUB_CHANNEL_H
+#define PUB_CHANNEL_H
+
+/** @file
+ *
+ * @brief Scheduling of ThingSet publication channels
+ *
+ * Each channel corresponds to one pub/sub bit of the data nodes and has its own publication
+ * interval, so that e.g. battery voltage and current can be published every 100 ms while energy
+ * totals are only published once per minute. The set of data nodes of a channel can be changed
+ * at runtime via the "IDs" node of the channel in the ThingSet "pub" path.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Minimum publication interval (ms), limited by the control rate which updates the data
+ */
+#define PUB_INTERVAL_MIN (1000 / CONFIG_CONTROL_FREQUENCY)
+
+/**
+ * Publication channel with individual interval
+ */
+class PubChannel
+{
+public:
+    PubChannel(uint16_t mask, bool enable, uint32_t interval) :
+        mask(mask),
+        enable(enable),
+        interval(interval)
+    {}
+
+    /**
+     * Check if the channel has to be published
+     *
+     * If the channel is due, the next publication time is scheduled. Publications missed e.g.
+     * because of a blocking thread are skipped instead of being sent in a burst.
+     *
+     * @param now Current uptime (ms)
+     *
+     * @returns true if the channel is enabled and the interval has elapsed
+     */
+    bool due(int64_t now);
+
+    /**
+     * Time of the next publication
+     *
+     * @param now Current uptime (ms)
+     *
+     * @returns Uptime of the next publication (ms) or INT64_MAX if the channel is disabled
+     */
+    int64_t next(int64_t now);
+
+    const uint16_t mask;        ///< Pub/sub bit of the data nodes (e.g. PUB_SER)
+
+    bool enable;                ///< Enable publication of this channel
+
+    uint32_t interval;          ///< Publication interval (ms), min. PUB_INTERVAL_MIN
+
+    bool nodes_changed = true;  ///< Node set was changed, publication template must be rebuilt
+
+private:
+    /**
+     * Publication interval limited to the allowed range
+     */
+    uint32_t interval_limited();
+
+    int64_t next_pub = 0;       ///< Uptime of next scheduled publication (ms)
+
+    bool restart = true;        ///< Publish with next call and start new schedule
+};
+
+/**
+ * Earliest publication time of multiple channels
+ *
+ * @param channels Array of channels
+ * @param num Number of channels in the array
+ * @param now Current uptime (ms)
+ *
+ * @returns Uptime of the next publication (ms) or INT64_MAX if all channels are disabled
+ */
+int64_t pub_channels_next(PubChannel *channels, int num, int64_t now);
+
+#endif /* PUB_CHANNEL_H */
@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "pub_template.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Text mode (JSON) encoders
+ */
+
+static int txt_uint(uint32_t value, uint8_t *buf, size_t size)
+{
+    char tmp[10];
+    size_t len = 0;
+
+    do {
+        tmp[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    if (len > size) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = tmp[len - i - 1];
+    }
+    return len;
+}
+
+static int txt_int(int32_t value, uint8_t *buf, size_t size)
+{
+    if (value >= 0) {
+        return txt_uint(value, buf, size);
+    }
+    else if (size < 2) {
+        return 0;
+    }
+
+    buf[0] = '-';
+    int len = txt_uint(-(int64_t)value, buf + 1, size - 1);
+    return (len > 0) ? len + 1 : 0;
+}
+
+static int txt_bool(const DataNode *node, uint8_t *buf, size_t size)
+{
+    const char *str = *((bool *)node->data) ? "true" : "false";
+    size_t len = strlen(str);
+    if (len > size) {
+        return 0;
+    }
+    memcpy(buf, str, len);
+    return len;
+}
+
+static int txt_uint32(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return txt_uint(*((uint32_t *)node->data), buf, size);
+}
+
+static int txt_int32(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return txt_int(*((int32_t *)node->data), buf, size);
+}
+
+static int txt_uint16(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return txt_uint(*((uint16_t *)node->data), buf, size);
+}
+
+static int txt_int16(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return txt_int(*((int16_t *)node->data), buf, size);
+}
+
+static int txt_float32(const DataNode *node, uint8_t *buf, size_t size)
+{
+    float value = *((float *)node->data);
+    int len;
+
+    if (isnan(value) || isinf(value)) {
+        len = snprintf((char *)buf, size, "null");
+    }
+    else {
+        len = snprintf((char *)buf, size, "%.*f", node->detail, value);
+    }
+    return (len > 0 && (size_t)len < size) ? len : 0;
+}
+
+static int txt_string(const DataNode *node, uint8_t *buf, size_t size)
+{
+    const char *str = (const char *)node->data;
+    size_t len = strlen(str);
+    if (len + 2 > size) {
+        return 0;
+    }
+    buf[0] = '"';
+    memcpy(&buf[1], str, len);
+    buf[len + 1] = '"';
+    return len + 2;
+}
+
+/*
+ * Binary mode (CBOR) encoders
+ */
+
+#define CBOR_UINT       0x00
+#define CBOR_NEGINT     0x20
+#define CBOR_TEXT       0x60
+#define CBOR_MAP        0xA0
+#define CBOR_FALSE      0xF4
+#define CBOR_TRUE       0xF5
+#define CBOR_FLOAT32    0xFA
+
+static int cbor_head(uint8_t major, uint32_t value, uint8_t *buf, size_t size)
+{
+    if (value < 24) {
+        if (size < 1) {
+            return 0;
+        }
+        buf[0] = major | value;
+        return 1;
+    }
+    else if (value <= UINT8_MAX) {
+        if (size < 2) {
+            return 0;
+        }
+        buf[0] = major | 24;
+        buf[1] = value;
+        return 2;
+    }
+    else if (value <= UINT16_MAX) {
+        if (size < 3) {
+            return 0;
+        }
+        buf[0] = major | 25;
+        buf[1] = value >> 8;
+        buf[2] = value;
+        return 3;
+    }
+    else {
+        if (size < 5) {
+            return 0;
+        }
+        buf[0] = major | 26;
+        buf[1] = value >> 24;
+        buf[2] = value >> 16;
+        buf[3] = value >> 8;
+        buf[4] = value;
+        return 5;
+    }
+}
+
+static int cbor_int(int32_t value, uint8_t *buf, size_t size)
+{
+    if (value >= 0) {
+        return cbor_head(CBOR_UINT, value, buf, size);
+    }
+    else {
+        return cbor_head(CBOR_NEGINT, -1 - value, buf, size);
+    }
+}
+
+static int bin_bool(const DataNode *node, uint8_t *buf, size_t size)
+{
+    if (size < 1) {
+        return 0;
+    }
+    buf[0] = *((bool *)node->data) ? CBOR_TRUE : CBOR_FALSE;
+    return 1;
+}
+
+static int bin_uint32(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return cbor_head(CBOR_UINT, *((uint32_t *)node->data), buf, size);
+}
+
+static int bin_int32(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return cbor_int(*((int32_t *)node->data), buf, size);
+}
+
+static int bin_uint16(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return cbor_head(CBOR_UINT, *((uint16_t *)node->data), buf, size);
+}
+
+static int bin_int16(const DataNode *node, uint8_t *buf, size_t size)
+{
+    return cbor_int(*((int16_t *)node->data), buf, size);
+}
+
+static int bin_float32(const DataNode *node, uint8_t *buf, size_t size)
+{
+    if (node->detail == 0) {
+        // no decimal digits: the ThingSet library encodes the rounded value as an integer
+        return cbor_int(lroundf(*((float *)node->data)), buf, size);
+    }
+    else if (size < 5) {
+        return 0;
+    }
+
+    uint32_t value;
+    memcpy(&value, node->data, sizeof(value));
+
+    buf[0] = CBOR_FLOAT32;
+    buf[1] = value >> 24;
+    buf[2] = value >> 16;
+    buf[3] = value >> 8;
+    buf[4] = value;
+    return 5;
+}
+
+static int bin_string(const DataNode *node, uint8_t *buf, size_t size)
+{
+    const char *str = (const char *)node->data;
+    size_t len = strlen(str);
+
+    int head = cbor_head(CBOR_TEXT, len, buf, size);
+    if (head == 0 || head + len > size) {
+        return 0;
+    }
+    memcpy(&buf[head], str, len);
+    return head + len;
+}
+
+bool PubTemplate::build(const DataNode *nodes, size_t num, uint16_t mask)
+{
+    num_entries = 0;
+    is_valid = true;
+
+    for (size_t i = 0; i < num; i++) {
+        const DataNode *node = &nodes[i];
+        if ((node->pubsub & mask) == 0) {
+            continue;
+        }
+
+        if (num_entries >= capacity) {
+            is_valid = false;
+            break;
+        }
+
+        PubTemplateEntry *entry = &entries[num_entries];
+        entry->node = node;
+        entry->name_len = strlen(node->name);
+
+        switch (node->type) {
+            case TS_T_BOOL:
+                entry->txt = txt_bool;
+                entry->bin = bin_bool;
+                break;
+            case TS_T_UINT32:
+                entry->txt = txt_uint32;
+                entry->bin = bin_uint32;
+                break;
+            case TS_T_INT32:
+                entry->txt = txt_int32;
+                entry->bin = bin_int32;
+                break;
+            case TS_T_UINT16:
+                entry->txt = txt_uint16;
+                entry->bin = bin_uint16;
+                break;
+            case TS_T_INT16:
+                entry->txt = txt_int16;
+                entry->bin = bin_int16;
+                break;
+            case TS_T_FLOAT32:
+                entry->txt = txt_float32;
+                entry->bin = bin_float32;
+                break;
+            case TS_T_STRING:
+                entry->txt = txt_string;
+                entry->bin = bin_string;
+                break;
+            default:
+                // arrays, bytes etc. are left to the ThingSet library
+                is_valid = false;
+                break;
+        }
+        num_entries++;
+    }
+
+    if (!is_valid) {
+        num_entries = 0;
+    }
+    return is_valid;
+}
+
+int PubTemplate::txt_pub(char *buf, size_t size) const
+{
+    uint8_t *pos = (uint8_t *)buf;
+    uint8_t *end = pos + size;
+
+    if (!is_valid || size < 4) {
+        return 0;
+    }
+
+    memcpy(pos, "# {", 3);
+    pos += 3;
+
+    for (size_t i = 0; i < num_entries; i++) {
+        const PubTemplateEntry *entry = &entries[i];
+
+        // "name": plus at least one character for value and separator
+        if ((size_t)(end - pos) < entry->name_len + 4) {
+            return 0;
+        }
+        *pos++ = '"';
+        memcpy(pos, entry->node->name, entry->name_len);
+        pos += entry->name_len;
+        *pos++ = '"';
+        *pos++ = ':';
+
+        int len = entry->txt(entry->node, pos, end - pos);
+        if (len == 0 || pos + len >= end) {
+            return 0;
+        }
+        pos += len;
+        *pos++ = ',';
+    }
+
+    if (num_entries > 0) {
+        // overwrite last comma
+        pos--;
+    }
+    if (pos + 2 > end) {
+        return 0;
+    }
+    *pos++ = '}';
+    *pos = '\0';
+
+    return pos - (uint8_t *)buf;
+}
+
+int PubTemplate::bin_pub(uint8_t *buf, size_t size) const
+{
+    if (!is_valid || size < 1) {
+        return 0;
+    }
+
+    buf[0] = PUB_TEMPLATE_BIN_PUBMSG;
+    size_t pos = 1;
+
+    int len = cbor_head(CBOR_MAP, num_entries, &buf[pos], size - pos);
+    if (len == 0) {
+        return 0;
+    }
+    pos += len;
+
+    for (size_t i = 0; i < num_entries; i++) {
+        const PubTemplateEntry *entry = &entries[i];
+
+        len = cbor_head(CBOR_UINT, entry->node->id, &buf[pos], size - pos);
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+
+        len = entry->bin(entry->node, &buf[pos], size - pos);
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+
+    return pos;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PUB_TEMPLATE_H
+#define PUB_TEMPLATE_H
+
+/** @file
+ *
+ * @brief Precompiled publication messages
+ *
+ * The ThingSet library filters the entire data nodes table by the pub/sub mask and selects the
+ * encoder based on the node type for each publication message. A template resolves the nodes
+ * of a channel and their encoders only once when the channel is configured, so that the
+ * periodic publication is a tight loop over the matching nodes.
+ *
+ * The generated messages are identical to the ones generated by the library:
+ *
+ * - Text mode: # {"Bat_V":14.10,"Bat_A":5.13}
+ * - Binary mode: TS_PUBMSG byte followed by a CBOR map with node IDs as keys
+ *
+ * Only scalar types and strings are supported. If a channel contains any other node type
+ * (e.g. arrays), the template is marked as invalid and the library has to be used instead.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "thingset.h"
+
+/**
+ * ThingSet function code of binary publication messages
+ */
+#define PUB_TEMPLATE_BIN_PUBMSG 0x1F
+
+/**
+ * Encoder for the value of a data node
+ *
+ * @returns Number of bytes written or 0 if the buffer was too small
+ */
+typedef int (*PubValueEncoder)(const DataNode *node, uint8_t *buf, size_t size);
+
+/**
+ * Node of a publication template with pre-selected encoders
+ */
+struct PubTemplateEntry
+{
+    const DataNode *node;
+    size_t name_len;                ///< Length of the node name for text mode
+    PubValueEncoder txt;            ///< JSON value encoder
+    PubValueEncoder bin;            ///< CBOR value encoder
+};
+
+/**
+ * Publication message template for one channel
+ */
+class PubTemplate
+{
+public:
+    /**
+     * Create empty template
+     *
+     * The template does not allocate memory itself, so the buffer must be provided by the
+     * caller.
+     *
+     * @param entries Buffer for the template entries
+     * @param capacity Max. number of nodes in one publication message
+     */
+    PubTemplate(PubTemplateEntry *entries, size_t capacity) :
+        entries(entries),
+        capacity(capacity)
+    {}
+
+    /**
+     * Resolve nodes and encoders of a publication channel
+     *
+     * Must be called again if the nodes of the channel were changed.
+     *
+     * @param nodes Data nodes table
+     * @param num Number of nodes in the table
+     * @param mask Pub/sub bit of the channel (e.g. PUB_SER)
+     *
+     * @returns true if all nodes of the channel are supported by the template
+     */
+    bool build(const DataNode *nodes, size_t num, uint16_t mask);
+
+    /**
+     * Check if the template can be used for publication messages
+     */
+    bool valid() const
+    {
+        return is_valid;
+    }
+
+    /**
+     * Number of nodes in the template
+     */
+    size_t size() const
+    {
+        return num_entries;
+    }
+
+    /**
+     * Data node at given position of the template
+     */
+    const DataNode *get_node(size_t pos) const
+    {
+        return entries[pos].node;
+    }
+
+    /**
+     * Generate text mode publication message
+     *
+     * @returns Length of the message or 0 if the buffer was too small
+     */
+    int txt_pub(char *buf, size_t size) const;
+
+    /**
+     * Generate binary mode publication message
+     *
+     * @returns Length of the message or 0 if the buffer was too small
+     */
+    int bin_pub(uint8_t *buf, size_t size) const;
+
+private:
+    PubTemplateEntry *entries;
+    size_t capacity;
+    size_t num_entries = 0;
+    bool is_valid = false;
+};
+
+#endif /* PUB_TEMPLATE_H */
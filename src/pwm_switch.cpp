@@ -26,6 +26,17 @@ LOG_MODULE_REGISTER(pwm_switch, CONFIG_PWM_LOG_LEVEL);
 #define PWM_CURRENT_MAX (DT_PROP(DT_CHILD(DT_PATH(outputs), pwm_switch), current_max))
 #define PWM_PERIOD (DT_PHA(DT_CHILD(DT_PATH(outputs), pwm_switch), pwms, period))
 
+#if CONFIG_PWM_FREQUENCY > 0
+#define PWM_FREQUENCY CONFIG_PWM_FREQUENCY
+#else
+// period stored in nanoseconds
+#define PWM_FREQUENCY (1000 * 1000 * 1000 / PWM_PERIOD)
+#endif
+
+// the gate driver switch-off time is quite high (fall time around 1ms), so on or off periods
+// shorter than this should be avoided
+#define PWM_PULSE_MIN_US 1000
+
 bool PwmSwitch::active()
 {
     return pwm_active();
@@ -37,10 +48,10 @@ bool PwmSwitch::signal_high()
 }
 
 PwmSwitch::PwmSwitch(DcBus *dc_bus) :
-    PowerPort(dc_bus)
+    PowerPort(dc_bus),
+    frequency(PWM_FREQUENCY)
 {
-    // period stored in nanoseconds
-    pwm_signal_init_registers(1000 * 1000 * 1000 / PWM_PERIOD);
+    pwm_signal_init_registers(frequency);
 }
 
 void PwmSwitch::test()
@@ -63,6 +74,7 @@ void PwmSwitch::control()
     if (pwm_active()) {
         if (current < -0.1F) {
             power_good_timestamp = uptime();     // reset the time
+            restart.power_good();
         }
 
         if (neg_current_limit == 0
@@ -71,51 +83,51 @@ void PwmSwitch::control()
             || bus->voltage < 9.0F    // not enough voltage for MOSFET drivers anymore
             || enable == false)
         {
-            pwm_signal_stop();
-            off_timestamp = uptime();
+            stop();
             LOG_INF("PWM charger stop, current = %d mA", (int)(current * 1000.0F));
         }
         else if (bus->voltage > bus->sink_control_voltage() + 0.3F) {
-            pwm_signal_stop();
-            off_timestamp = uptime();
+            stop();
             dev_stat.set_error(ERR_PWM_SWITCH_OVERVOLTAGE);
             LOG_INF("PWM charger stop, overvoltage.");
         }
-        else if (bus->voltage > bus->sink_control_voltage()   // bus voltage above target
-            || current < neg_current_limit                    // port current limit exceeded
-            || current < -PWM_CURRENT_MAX)                    // PCB current limit exceeded
-        {
-            // decrease power, as limits were reached
+        else {
+            // PI controller in velocity form, so the integral part can't wind up while the duty
+            // cycle is limited
+            float voltage_error = bus->sink_control_voltage() - bus->voltage;
+            duty_target += voltage_kp * (voltage_error - voltage_error_prev) +
+                voltage_ki * voltage_error / CONFIG_CONTROL_FREQUENCY;
+            voltage_error_prev = voltage_error;
+
+            // The solar panel acts as a current source, so the average current is proportional
+            // to the duty cycle and the current limits can be applied directly.
+            float current_limit = neg_current_limit > -PWM_CURRENT_MAX ?
+                neg_current_limit : -PWM_CURRENT_MAX;
+            if (current < 0.0F) {
+                float duty_max = pwm_signal_get_duty_cycle() * current_limit / current;
+                if (duty_target > duty_max) {
+                    duty_target = duty_max;
+                }
+            }
 
-            // the gate driver switch-off time is quite high (fall time around 1ms), so very short
-            // on or off periods (duty cycle close to 0 and 1) should be avoided
-            if (pwm_signal_get_duty_cycle() > 0.95F) {
-                // prevent very short off periods
-                pwm_signal_set_duty_cycle(0.95F);
+            if (duty_target > 1.0F) {
+                duty_target = 1.0F;
             }
-            else if (pwm_signal_get_duty_cycle() < 0.05F) {
+
+            float duty_min = PWM_PULSE_MIN_US * 1e-6F * frequency;
+            if (duty_target < duty_min) {
                 // prevent very short on periods and switch completely off instead
-                pwm_signal_stop();
-                off_timestamp = uptime();
-                // consider this as overvoltage in order to start again with 5% duty cycle
+                stop();
+                // consider this as overvoltage in order to start again with minimum duty cycle
                 dev_stat.set_error(ERR_PWM_SWITCH_OVERVOLTAGE);
                 LOG_INF("PWM charger stop, no further derating possible.");
             }
-            else {
-                // decrease the power with large steps to prevent long-term overvoltages if
-                // the PWM switch was started with full battery and high solar irradiation
-                pwm_signal_duty_cycle_step(-10);
-            }
-        }
-        else {
-            // increase power (if not yet at 100% duty cycle)
-
-            if (pwm_signal_get_duty_cycle() > 0.95F) {
+            else if (duty_target > 1.0F - duty_min) {
                 // prevent very short off periods and switch completely on instead
-                pwm_signal_set_duty_cycle(1);
+                pwm_signal_set_duty_cycle(1.0F);
             }
             else {
-                pwm_signal_duty_cycle_step(1);
+                pwm_signal_set_duty_cycle(duty_target);
             }
         }
 
@@ -129,7 +141,7 @@ void PwmSwitch::control()
         if (bus->sink_current_margin > 0          // charging allowed
             && bus->voltage < bus->sink_control_voltage()
             && ext_voltage > bus->voltage + offset_voltage_start
-            && uptime() > (off_timestamp + restart_interval)
+            && restart.allowed(uptime() - off_timestamp, ext_voltage, restart_interval)
             && enable == true)
         {
             // turning the PWM switch on creates a short voltage rise, so inhibit alerts by 50 ms
@@ -137,22 +149,31 @@ void PwmSwitch::control()
 
             if (dev_stat.has_error(ERR_PWM_SWITCH_OVERVOLTAGE)) {
                 // start with minimum duty cycle in order to prevent another overvoltage event
-                pwm_signal_start(0.05F);
+                start(PWM_PULSE_MIN_US * 1e-6F * frequency);
             }
             else {
-                pwm_signal_start(1.0F);
+                start(1.0F);
             }
 
+            restart.started(ext_voltage);
             power_good_timestamp = uptime();
             LOG_INF("PWM charger start.");
         }
     }
 }
 
+void PwmSwitch::start(float duty)
+{
+    duty_target = duty;
+    voltage_error_prev = bus->sink_control_voltage() - bus->voltage;
+    pwm_signal_start(duty);
+}
+
 void PwmSwitch::stop()
 {
     pwm_signal_stop();
     off_timestamp = uptime();
+    restart.stopped();
 }
 
 float PwmSwitch::get_duty_cycle()
@@ -19,6 +19,7 @@
 #ifdef __cplusplus
 
 #include "power_port.h"
+#include "restart_policy.h"
 
 /**
  * PWM charger type
@@ -32,6 +33,9 @@ public:
 
     /**
      * Main control function for the PWM switching algorithm
+     *
+     * The duty cycle is adjusted by a PI controller to regulate the bus voltage to the sink
+     * control voltage. Current limits are applied on top of the controller output.
      */
     void control();
 
@@ -82,17 +86,37 @@ public:
      */
     bool enable = true;
 
+    /**
+     * Switching frequency (Hz)
+     */
+    int frequency;
+
+    /**
+     * Proportional gain of the voltage controller (1/V)
+     */
+    float voltage_kp = 0.2F;
+
+    /**
+     * Integral gain of the voltage controller (1/Vs)
+     */
+    float voltage_ki = 1.0F;
+
     /**
      * Offset voltage of solar panel vs. battery to start charging (V)
      */
     float offset_voltage_start = 2.0F;
 
     /**
-     * Interval to wait before retrying charging after low solar power cut-off or overvoltage
-     * event (s)
+     * Maximum interval to wait before retrying charging after low solar power cut-off or
+     * overvoltage event (s)
      */
     int restart_interval = 60;
 
+    /**
+     * Adaptive restart before the maximum interval has passed
+     */
+    RestartPolicy restart;
+
     /**
      * Time when charger was switched off last time
      *
@@ -104,6 +128,15 @@ public:
      * Last time the current through the switch was above minimum
      */
     time_t power_good_timestamp;
+
+private:
+    /**
+     * Start switching and initialize the voltage controller
+     */
+    void start(float duty);
+
+    float duty_target;          ///< Unlimited duty cycle calculated by the voltage controller
+    float voltage_error_prev;   ///< Voltage error of the previous control step (V)
 };
 #endif
 
@@ -113,7 +146,6 @@ extern "C" {
 
 float pwm_signal_get_duty_cycle();
 void pwm_signal_set_duty_cycle(float duty);
-void pwm_signal_duty_cycle_step(int delta);
 void pwm_signal_init_registers(int freq_Hz);
 void pwm_signal_start(float pwm_duty);
 void pwm_signal_stop();
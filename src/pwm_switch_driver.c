@@ -52,6 +52,21 @@ static TIM_TypeDef *tim = TIM3;
 #error "PWM Switch channel not defined properly!"
 #endif
 
+// another channel of TIM3 without output pin triggers the ADC in the center of the on-phase
+#if DT_PWMS_CHANNEL(DT_CHILD(DT_PATH(outputs), pwm_switch)) == 1
+#define LL_TIM_OC_SetCompareSAMPLE LL_TIM_OC_SetCompareCH2
+#define LL_TIM_EnableIT_SAMPLE LL_TIM_EnableIT_CC2
+#define LL_TIM_IsActiveFlag_SAMPLE LL_TIM_IsActiveFlag_CC2
+#define LL_TIM_ClearFlag_SAMPLE LL_TIM_ClearFlag_CC2
+#define LL_TIM_CHANNEL_SAMPLE LL_TIM_CHANNEL_CH2
+#else
+#define LL_TIM_OC_SetCompareSAMPLE LL_TIM_OC_SetCompareCH1
+#define LL_TIM_EnableIT_SAMPLE LL_TIM_EnableIT_CC1
+#define LL_TIM_IsActiveFlag_SAMPLE LL_TIM_IsActiveFlag_CC1
+#define LL_TIM_ClearFlag_SAMPLE LL_TIM_ClearFlag_CC1
+#define LL_TIM_CHANNEL_SAMPLE LL_TIM_CHANNEL_CH1
+#endif
+
 // to check if PWM signal is high or low (not sure how to get pin config from devicetree...)
 #if defined(CONFIG_BOARD_PWM_2420_LUS)
 #define PWM_GPIO_PIN_HIGH (GPIOB->IDR & GPIO_IDR_ID1)
@@ -66,12 +81,22 @@ static int _pwm_resolution;
 
 static void TIM3_IRQHandler(void *args)
 {
-    LL_TIM_ClearFlag_UPDATE(tim);
+    if (LL_TIM_IsActiveFlag_UPDATE(tim)) {
+        LL_TIM_ClearFlag_UPDATE(tim);
+
+        if ((int)LL_TIM_OC_GetCompare(tim) < _pwm_resolution) {
+            // turning the PWM switch on creates a short voltage rise, so inhibit alerts by 10 ms
+            // at each rising edge if switch is not continuously on
+            adc_upper_alert_inhibit(ADC_POS(v_low), 10);
+        }
+    }
+
+    if (LL_TIM_IsActiveFlag_SAMPLE(tim)) {
+        LL_TIM_ClearFlag_SAMPLE(tim);
 
-    if ((int)LL_TIM_OC_GetCompare(tim) < _pwm_resolution) {
-        // turning the PWM switch on creates a short voltage rise, so inhibit alerts by 10 ms
-        // at each rising edge if switch is not continuously on
-        adc_upper_alert_inhibit(ADC_POS(v_low), 10);
+        if (_pwm_active) {
+            adc_trigger_pwm_sync();
+        }
     }
 }
 
@@ -81,21 +106,27 @@ void pwm_signal_init_registers(int freq_Hz)
 
 	LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_TIM3);
 
-    // Set timer clock to 10 kHz
-    LL_TIM_SetPrescaler(TIM3, SystemCoreClock / 10000 - 1);
+    // Use the fastest timer clock where the period still fits into the 16-bit auto-reload
+    // register to get the highest possible duty cycle resolution
+    uint32_t prescaler = SystemCoreClock / freq_Hz / 0x10000 + 1;
+    LL_TIM_SetPrescaler(tim, prescaler - 1);
 
     LL_TIM_OC_SetMode(tim, LL_TIM_CHANNEL, LL_TIM_OCMODE_PWM1);
     LL_TIM_OC_EnablePreload(tim, LL_TIM_CHANNEL);
     LL_TIM_OC_SetPolarity(tim, LL_TIM_CHANNEL, LL_TIM_OCPOLARITY_HIGH);
 
-    // Interrupt on timer update
+    // Compare value of the sampling channel is changed together with the PWM duty cycle
+    LL_TIM_OC_EnablePreload(tim, LL_TIM_CHANNEL_SAMPLE);
+
+    // Interrupt on timer update and for ADC sampling
     LL_TIM_EnableIT_UPDATE(tim);
+    LL_TIM_EnableIT_SAMPLE(tim);
 
     // Force update generation (UG = 1)
     LL_TIM_GenerateEvent_UPDATE(tim);
 
     // set PWM frequency and resolution
-    _pwm_resolution = 10000 / freq_Hz;
+    _pwm_resolution = SystemCoreClock / prescaler / freq_Hz;
 
     // Period goes from 0 to ARR (including ARR value), so substract 1 clock cycle
     LL_TIM_SetAutoReload(tim, _pwm_resolution - 1);
@@ -109,15 +140,9 @@ void pwm_signal_init_registers(int freq_Hz)
 
 void pwm_signal_set_duty_cycle(float duty)
 {
-    LL_TIM_OC_SetCompare(tim, _pwm_resolution * duty);
-}
-
-void pwm_signal_duty_cycle_step(int delta)
-{
-    uint32_t ccr_new = (int)LL_TIM_OC_GetCompare(tim) + delta;
-    if (ccr_new <= _pwm_resolution && ccr_new >= 0) {
-        LL_TIM_OC_SetCompare(tim, ccr_new);
-    }
+    uint32_t ccr = _pwm_resolution * duty;
+    LL_TIM_OC_SetCompare(tim, ccr);
+    LL_TIM_OC_SetCompareSAMPLE(tim, ccr / 2);
 }
 
 float pwm_signal_get_duty_cycle()
@@ -150,15 +175,17 @@ bool pwm_active()
 
 #else
 
-// dummy functions for unit tests
-float pwm_signal_get_duty_cycle() { return 0; }
-void pwm_signal_set_duty_cycle(float duty) {;}
-void pwm_signal_duty_cycle_step(int delta) {;}
+// dummy registers for unit tests
+static float _pwm_duty;
+static bool _pwm_active;
+
+float pwm_signal_get_duty_cycle() { return _pwm_duty; }
+void pwm_signal_set_duty_cycle(float duty) { _pwm_duty = duty; }
 void pwm_signal_init_registers(int freq_Hz) {;}
-void pwm_signal_start(float pwm_duty) {;}
-void pwm_signal_stop() {;}
-bool pwm_signal_high() { return false; }
-bool pwm_active() { return false; }
+void pwm_signal_start(float pwm_duty) { _pwm_duty = pwm_duty; _pwm_active = true; }
+void pwm_signal_stop() { _pwm_active = false; }
+bool pwm_signal_high() { return _pwm_active; }
+bool pwm_active() { return _pwm_active; }
 
 #endif
 
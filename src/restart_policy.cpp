@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "restart_policy.h"
+
+// limit of the exponential backoff (interval_min * 2^n), the maximum interval is applied anyway
+#define RESTART_BACKOFF_MAX 10
+
+// hysteresis of the learned start voltage after a failed start, relative to start voltage
+#define RESTART_VOLTAGE_HYST 0.01F
+
+bool RestartPolicy::allowed(uint32_t time_off, float voltage, uint32_t interval_max)
+{
+    if (time_off >= interval_max) {
+        // fall-back to retry with fixed interval, also needed to un-learn the start voltage
+        return true;
+    }
+    else if (time_off < interval_min) {
+        // voltage may not have settled yet after the stop
+        voltage_ref_valid = false;
+        return false;
+    }
+
+    if (voltage < voltage_ref || !voltage_ref_valid) {
+        voltage_ref = voltage;
+        voltage_ref_valid = true;
+    }
+
+    if (voltage < voltage_start) {
+        return false;
+    }
+
+    int shift = (failed_starts < RESTART_BACKOFF_MAX) ? failed_starts : RESTART_BACKOFF_MAX;
+    if (time_off >= (interval_min << shift)) {
+        return true;
+    }
+
+    // irradiance increasing
+    return voltage > voltage_ref * (1.0F + voltage_rise);
+}
+
+void RestartPolicy::started(float voltage)
+{
+    voltage_started = voltage;
+    running = true;
+    success = false;
+}
+
+void RestartPolicy::stopped()
+{
+    if (!running) {
+        return;
+    }
+
+    if (success) {
+        failed_starts = 0;
+        if (voltage_started < voltage_start) {
+            voltage_start = voltage_started;
+        }
+    }
+    else {
+        failed_starts++;
+        float voltage_min = voltage_started * (1.0F + RESTART_VOLTAGE_HYST);
+        if (voltage_min > voltage_start) {
+            voltage_start = voltage_min;
+        }
+    }
+    running = false;
+    voltage_ref_valid = false;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef RESTART_POLICY_H
+#define RESTART_POLICY_H
+
+/** @file
+ *
+ * @brief Adaptive restart of power converters after low power cut-off
+ *
+ * Instead of waiting for a fixed interval after each stop, the converter is restarted after a
+ * short minimum interval. Each start that did not yield any output power doubles the interval
+ * (exponential backoff) up to the maximum interval, so that the converter does not chatter if
+ * there is not enough input power.
+ *
+ * The open circuit voltage of the solar panel is used as an indicator for the irradiance:
+ *
+ * - A rising open circuit voltage (e.g. in the morning or after a passing cloud) skips the
+ *   backoff interval.
+ * - The minimum voltage required for a successful start is learned from previous starts.
+ *
+ * After the maximum interval a restart is always attempted, which corresponds to the previous
+ * behavior with a fixed restart interval.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Adaptive restart policy for DC/DC and PWM switch
+ */
+class RestartPolicy
+{
+public:
+    /**
+     * Check if the converter may be restarted
+     *
+     * Should be called continuously while the converter is off, as the trend of the input
+     * voltage is tracked internally.
+     *
+     * @param time_off Time since the converter was switched off (s)
+     * @param voltage Actual open circuit input voltage, e.g. of the solar panel (V)
+     * @param interval_max Maximum restart interval (s)
+     *
+     * @returns true if a start should be attempted
+     */
+    bool allowed(uint32_t time_off, float voltage, uint32_t interval_max);
+
+    /**
+     * Notify the policy about a start of the converter
+     *
+     * @param voltage Open circuit input voltage before the start (V)
+     */
+    void started(float voltage);
+
+    /**
+     * Notify the policy that the output power is above the minimum
+     */
+    void power_good()
+    {
+        success = true;
+    }
+
+    /**
+     * Notify the policy about a stop of the converter
+     *
+     * Evaluates if the previous start was successful and adapts backoff and learned minimum
+     * start voltage accordingly.
+     */
+    void stopped();
+
+    /**
+     * Restart interval (s) after a successful operation, doubled for each failed start
+     */
+    uint32_t interval_min = 5;
+
+    /**
+     * Relative increase of the open circuit voltage since the stop that allows to restart
+     * before the backoff interval has passed
+     */
+    float voltage_rise = 0.03F;
+
+    /**
+     * Learned minimum open circuit voltage for a successful start (V)
+     */
+    float voltage_start = 0;
+
+    /**
+     * Number of consecutive starts without any output power
+     */
+    uint16_t failed_starts = 0;
+
+private:
+    float voltage_started = 0;      ///< Open circuit voltage at last start
+    float voltage_ref = 0;          ///< Lowest open circuit voltage since last stop
+    bool voltage_ref_valid = false;
+    bool running = false;           ///< Converter was started and not yet stopped
+    bool success = false;           ///< Output power was good since last start
+};
+
+#endif /* RESTART_POLICY_H */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "serial_protocol.h"
+
+void slip_write(const uint8_t *data, size_t len, SerialPutc putc)
+{
+    // leading END flushes any line noise received by the other side
+    putc(SLIP_END);
+
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == SLIP_END) {
+            putc(SLIP_ESC);
+            putc(SLIP_ESC_END);
+        }
+        else if (data[i] == SLIP_ESC) {
+            putc(SLIP_ESC);
+            putc(SLIP_ESC_ESC);
+        }
+        else {
+            putc(data[i]);
+        }
+    }
+
+    putc(SLIP_END);
+}
+
+void SerialReceiver::reset()
+{
+    pos = 0;
+    in_frame = false;
+    escaped = false;
+    overflow = false;
+    complete = false;
+}
+
+bool SerialReceiver::put(uint8_t c)
+{
+    if (complete) {
+        return true;
+    }
+
+    if (in_frame) {
+        return put_slip(c);
+    }
+    else if (c == SLIP_END && pos == 0) {
+        // start of binary frame, only accepted at the beginning of a request
+        in_frame = true;
+        return false;
+    }
+    else {
+        return put_text(c);
+    }
+}
+
+bool SerialReceiver::put_text(uint8_t c)
+{
+    // \r\n and \n are markers for line end, i.e. command end
+    // we accept this at any time, even if the buffer is 'full', since
+    // there is always one last character left for the \0
+    if (c == '\n') {
+        if (pos > 0 && buf[pos - 1] == '\r') {
+            pos--;
+        }
+        buf[pos] = '\0';
+        is_binary = false;
+        complete = true;
+    }
+    // backspace allowed if there is something in the buffer already
+    else if (pos > 0 && c == '\b') {
+        pos--;
+    }
+    // Fill the buffer up to all but 1 character (the last character is reserved for '\0')
+    // Characters beyond the size of the buffer are dropped.
+    else if (pos < size - 1) {
+        buf[pos++] = c;
+    }
+    return complete;
+}
+
+bool SerialReceiver::put_slip(uint8_t c)
+{
+    if (c == SLIP_END) {
+        if (pos == 0 && !overflow) {
+            // empty frame, e.g. the closing END of a previous frame followed by a leading END
+            return false;
+        }
+        else if (overflow) {
+            reset();
+            return false;
+        }
+        is_binary = true;
+        complete = true;
+        return true;
+    }
+
+    if (escaped) {
+        escaped = false;
+        if (c == SLIP_ESC_END) {
+            c = SLIP_END;
+        }
+        else if (c == SLIP_ESC_ESC) {
+            c = SLIP_ESC;
+        }
+        // protocol violation: store the byte as it is (as suggested by RFC 1055)
+    }
+    else if (c == SLIP_ESC) {
+        escaped = true;
+        return false;
+    }
+
+    if (pos < size) {
+        buf[pos++] = c;
+    }
+    else {
+        overflow = true;
+    }
+    return false;
+}
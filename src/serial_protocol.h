@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+/** @file
+ *
+ * @brief Framing of ThingSet messages on the serial interface
+ *
+ * The serial interface supports two modes, which are detected from each received request:
+ *
+ * - Text mode: Human-readable requests and responses terminated by a newline character.
+ * - Binary mode: CBOR requests and responses framed with SLIP (RFC 1055). Each frame starts
+ *   and ends with SLIP_END, which can never occur in text mode.
+ *
+ * The mode of the last request is also used for the publication messages, so that a client
+ * negotiates the binary mode simply by sending its first request as a SLIP frame.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * SLIP special characters
+ */
+#define SLIP_END        0xC0
+#define SLIP_ESC        0xDB
+#define SLIP_ESC_END    0xDC
+#define SLIP_ESC_ESC    0xDD
+
+/**
+ * Function to write one byte to the serial interface (e.g. uart_poll_out wrapper)
+ */
+typedef void (*SerialPutc)(uint8_t c);
+
+/**
+ * Write SLIP frame to the serial interface
+ *
+ * The data is escaped on the fly, so no additional buffer is needed.
+ *
+ * @param data Payload of the frame
+ * @param len Length of the payload
+ * @param putc Function to write one byte
+ */
+void slip_write(const uint8_t *data, size_t len, SerialPutc putc);
+
+/**
+ * Receiver for text and binary requests
+ *
+ * The put function is designed to be called from the UART interrupt.
+ */
+class SerialReceiver
+{
+public:
+    /**
+     * Create receiver
+     *
+     * @param buf Buffer for the received request
+     * @param size Size of the buffer (the last byte is reserved for the null-termination of
+     *             text requests)
+     */
+    SerialReceiver(uint8_t *buf, size_t size) :
+        buf(buf),
+        size(size)
+    {}
+
+    /**
+     * Process one received byte
+     *
+     * Further bytes are ignored after a request was completed until reset() is called.
+     *
+     * @returns true if a complete request is available
+     */
+    bool put(uint8_t c);
+
+    /**
+     * Check if a complete request is available
+     */
+    bool available() const
+    {
+        return complete;
+    }
+
+    /**
+     * Check if the last request was received in binary mode
+     */
+    bool binary() const
+    {
+        return is_binary;
+    }
+
+    /**
+     * Length of the received request (without null-termination for text requests)
+     */
+    size_t length() const
+    {
+        return pos;
+    }
+
+    /**
+     * Discard the current request and start listening for a new one
+     *
+     * The mode of the last request is kept.
+     */
+    void reset();
+
+private:
+    bool put_text(uint8_t c);
+
+    bool put_slip(uint8_t c);
+
+    uint8_t *buf;
+    size_t size;
+    volatile size_t pos = 0;
+    volatile bool complete = false;
+    bool in_frame = false;          ///< SLIP frame started
+    bool escaped = false;           ///< Last byte was SLIP_ESC
+    bool overflow = false;          ///< SLIP frame larger than buffer, will be dropped
+    bool is_binary = false;
+};
+
+#endif /* SERIAL_PROTOCOL_H */
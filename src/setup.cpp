@@ -19,9 +19,12 @@
 #include "dcdc.h"               // DC/DC converter control (hardware independent)
 #include "pwm_switch.h"         // PWM charge controller
 #include "bat_charger.h"        // battery settings and charger state machine
+#include "current_sharing.h"    // current balancing between multiple units
 #include "daq.h"                // ADC using DMA and conversion to measurement values
 #include "data_storage.h"             // external I2C EEPROM
 #include "load.h"               // load and USB output management
+#include "load_manager.h"       // priority-based load shedding
+#include "energy_forecast.h"    // predictive load shedding
 #include "leds.h"               // LED switching using charlieplexing
 #include "device_status.h"      // log data (error memory, min/max measurements, etc.)
 #include "data_nodes.h"         // for access to internal data via ThingSet
@@ -33,7 +36,7 @@ PowerPort lv_terminal(&lv_bus, true);   // low voltage terminal (battery for typ
 DcBus hv_bus;
 PowerPort hv_terminal(&hv_bus, true);   // high voltage terminal (solar for typical MPPT)
 #if CONFIG_HV_TERMINAL_NANOGRID
-Dcdc dcdc(&hv_bus, &lv_bus, DCDC_MODE_AUTO);
+Dcdc dcdc(&hv_bus, &lv_bus, DCDC_MODE_NANOGRID);
 #elif CONFIG_HV_TERMINAL_BATTERY
 Dcdc dcdc(&hv_bus, &lv_bus, DCDC_MODE_BOOST);
 #else
@@ -46,13 +49,31 @@ PwmSwitch pwm_switch(&lv_bus);
 #endif
 
 #if BOARD_HAS_LOAD_OUTPUT
-LoadOutput load(&lv_bus, &load_out_set, &load_out_init, NULL);
+LoadOutput load(&lv_bus, &load_out_set, &load_out_init, NULL, CONFIG_LOAD_SOFT_START_TIME);
 #endif
 
 #if BOARD_HAS_USB_OUTPUT
 LoadOutput usb_pwr(&lv_bus, &usb_out_set, &usb_out_init, &pgood_check);
 #endif
 
+#if BOARD_HAS_LOAD_OUTPUT || BOARD_HAS_USB_OUTPUT
+// SOC-based shedding disabled by default, only the LVD of each output is active
+LoadChannel load_channels[] = {
+#if BOARD_HAS_LOAD_OUTPUT
+    { &load, 1, 0, 0, 0, 0, false },
+#endif
+#if BOARD_HAS_USB_OUTPUT
+    { &usb_pwr, 0, 0, 0, 0, 0, false },     // USB is kept on longer than load by default
+#endif
+};
+
+LoadManager load_manager(load_channels, sizeof(load_channels) / sizeof(load_channels[0]));
+#endif
+
+#if CONFIG_LOAD_ENERGY_FORECAST
+EnergyForecast energy_forecast;
+#endif
+
 #if CONFIG_HV_TERMINAL_SOLAR
 PowerPort &solar_terminal = hv_terminal;
 #elif CONFIG_LV_TERMINAL_SOLAR
@@ -73,6 +94,10 @@ PowerPort &bat_terminal = hv_terminal;
 
 Charger charger(&bat_terminal);
 
+#if CONFIG_CURRENT_SHARING
+CurrentSharing current_sharing(&bat_terminal);
+#endif
+
 BatConf bat_conf;               // actual (used) battery configuration
 BatConf bat_conf_user;          // temporary storage where the user can write to
 
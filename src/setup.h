@@ -11,10 +11,20 @@
 #include "bat_charger.h"
 #include "device_status.h"
 #include "load.h"
+#include "load_manager.h"
+#include "energy_forecast.h"
 #include "power_port.h"
 #include "pwm_switch.h"
 #include "thingset.h"
 #include "board.h"
+#include "control_graph.h"
+#include "current_sharing.h"
+#include "dcdc.h"
+#include "half_bridge.h"
+
+#define HAS_SOLAR_TERMINAL  (IS_ENABLED(CONFIG_HV_TERMINAL_SOLAR) || \
+    IS_ENABLED(CONFIG_LV_TERMINAL_SOLAR) || IS_ENABLED(CONFIG_PWM_TERMINAL_SOLAR))
+#define HAS_GRID_TERMINAL   IS_ENABLED(CONFIG_HV_TERMINAL_NANOGRID)
 
 extern DcBus lv_bus;
 extern PowerPort lv_terminal;
@@ -35,6 +45,10 @@ extern PowerPort &grid_terminal;
 
 extern DeviceStatus dev_stat;
 extern Charger charger;
+
+#if CONFIG_CURRENT_SHARING
+extern CurrentSharing current_sharing;
+#endif
 extern BatConf bat_conf;
 extern BatConf bat_conf_user;
 
@@ -46,8 +60,140 @@ extern LoadOutput load;
 extern LoadOutput usb_pwr;
 #endif
 
+#define HAS_LOAD_MANAGER    (BOARD_HAS_LOAD_OUTPUT || BOARD_HAS_USB_OUTPUT)
+
+#if HAS_LOAD_MANAGER
+// position of the outputs in load_channels
+#define LOAD_CHANNEL_LOAD   0
+#define LOAD_CHANNEL_USB    (BOARD_HAS_LOAD_OUTPUT ? 1 : 0)
+
+extern LoadChannel load_channels[];
+extern LoadManager load_manager;
+#endif
+
+// night detection requires a solar terminal
+#define HAS_ENERGY_FORECAST (HAS_LOAD_MANAGER && HAS_SOLAR_TERMINAL && \
+    IS_ENABLED(CONFIG_LOAD_ENERGY_FORECAST))
+
+#if HAS_ENERGY_FORECAST
+extern EnergyForecast energy_forecast;
+#endif
+
 extern ThingSet ts;             // defined in data_objects.cpp
 
+/*
+ * Power components of the control graph
+ *
+ * Components not existing on the board are replaced by NoComponent, so that the control loop
+ * does not need any preprocessor branching or runtime checks.
+ */
+
+#if BOARD_HAS_PWM_PORT
+struct PwmSwitchComponent
+{
+    static constexpr bool exists = true;
+
+    static inline void control()
+    {
+        pwm_switch.control();
+    }
+
+    static inline void energy_balance()
+    {
+        if (pwm_switch.active()) {
+            pwm_switch.energy_balance();
+        }
+    }
+
+    static inline bool charging()
+    {
+        return pwm_switch.active();
+    }
+};
+#else
+using PwmSwitchComponent = NoComponent;
+#endif
+
+#if BOARD_HAS_DCDC
+struct DcdcComponent
+{
+    static constexpr bool exists = true;
+
+    static inline void control()
+    {
+        hv_terminal.update_bus_current_margins();
+        dcdc.control();     // control of DC/DC including MPPT algorithm
+    }
+
+    static inline void energy_balance()
+    {
+        if (dcdc.state != DCDC_CONTROL_OFF) {
+            hv_terminal.energy_balance();
+        }
+    }
+
+    static inline bool charging()
+    {
+        return half_bridge_enabled();
+    }
+};
+#else
+using DcdcComponent = NoComponent;
+#endif
+
+#if BOARD_HAS_LOAD_OUTPUT
+struct LoadComponent
+{
+    static constexpr bool exists = true;
+
+    static inline void control()
+    {
+        load.control();
+    }
+
+    static inline void energy_balance()
+    {
+        if (load.state != LOAD_STATE_OFF) {
+            load.energy_balance();
+        }
+    }
+
+    static inline bool charging()
+    {
+        return false;
+    }
+};
+#else
+using LoadComponent = NoComponent;
+#endif
+
+#if BOARD_HAS_USB_OUTPUT
+struct UsbComponent
+{
+    static constexpr bool exists = true;
+
+    static inline void control()
+    {
+        usb_pwr.control();
+    }
+
+    static inline void energy_balance() {}
+
+    static inline bool charging()
+    {
+        return false;
+    }
+};
+#else
+using UsbComponent = NoComponent;
+#endif
+
+/**
+ * Power components of the board in the order they are controlled
+ */
+using PowerComponents = ControlGraph<PwmSwitchComponent, DcdcComponent, LoadComponent,
+    UsbComponent>;
+
 extern uint32_t timestamp;
 
 /**
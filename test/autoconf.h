@@ -23,6 +23,7 @@
 #define CONFIG_BAT_TYPE_GEL 1
 #define CONFIG_BAT_TYPE 2
 #define CONFIG_BAT_CAPACITY_AH 50
+#define CONFIG_BAT_BMS_TIMEOUT 5
 #define CONFIG_BAT_NUM_CELLS 6
 #define CONFIG_CELL_ABS_MAX_VOLTAGE_MV 2450
 #define CONFIG_CELL_TOPPING_VOLTAGE_MV 2400
@@ -45,5 +46,11 @@
 #define CONFIG_BAT_CHARGE_TEMP_MIN 0
 #define CONFIG_BAT_DISCHARGE_TEMP_MAX 50
 #define CONFIG_BAT_DISCHARGE_TEMP_MIN -10
+#define CONFIG_PWM_FREQUENCY 0
 #define CONFIG_LOAD_OC_RECOVERY_DELAY 300
 #define CONFIG_LOAD_LVD_RECOVERY_DELAY 300
+#define CONFIG_LOAD_SOFT_START_TIME 50
+#define CONFIG_LOAD_RECONNECT_STAGGER 10
+#define CONFIG_LOAD_ENERGY_FORECAST 1
+#define CONFIG_LOAD_FORECAST_SOC_RESERVE 20
+#define CONFIG_LOAD_FUSE_TRIP_TIME 100
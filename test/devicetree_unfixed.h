@@ -26,6 +26,12 @@
 #define DT_N_S_soc_S_timers_40016800_S_halfbridge_P_frequency 70000
 #define DT_N_S_soc_S_timers_40016800_S_halfbridge_P_deadtime 300
 
+// interleaved phases can be tested with a separate build (see env:unit_test_multiphase)
+#ifndef TEST_HALF_BRIDGE_PHASES
+#define TEST_HALF_BRIDGE_PHASES 1
+#endif
+#define DT_N_S_soc_S_timers_40016800_S_halfbridge_P_phases TEST_HALF_BRIDGE_PHASES
+
 #define DT_N_S_outputs_S_pwm_switch_EXISTS 1
 #define DT_N_S_outputs_S_pwm_switch_P_current_max 20
 #define DT_N_S_outputs_S_pwm_switch_P_pwms_IDX_0_VAL_period 20000000
@@ -20,11 +20,21 @@ int main()
 {
     daq_tests();
     bat_charger_tests();
+    bat_ekf_tests();
+    current_sharing_tests();
     power_port_tests();
+    pwm_switch_tests();
+    restart_policy_tests();
     half_bridge_tests();
+    i2t_fuse_tests();
     dcdc_tests();
     device_status_tests();
+    energy_forecast_tests();
     load_tests();
+    load_manager_tests();
+    control_graph_tests();
+    data_nodes_tests();
+    serial_protocol_tests();
 
 #ifdef CUSTOM_TESTS
     custom_tests();
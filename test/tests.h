@@ -9,18 +9,38 @@
 
 void bat_charger_tests();
 
+void bat_ekf_tests();
+
+void current_sharing_tests();
+
 void daq_tests();
 
 void power_port_tests();
 
+void pwm_switch_tests();
+
+void restart_policy_tests();
+
 void half_bridge_tests();
 
+void i2t_fuse_tests();
+
 void dcdc_tests();
 
 void device_status_tests();
 
+void energy_forecast_tests();
+
 void load_tests();
 
+void load_manager_tests();
+
+void control_graph_tests();
+
+void data_nodes_tests();
+
+void serial_protocol_tests();
+
 // activate this via build_flags in platformio.ini or custom.ini
 #ifdef CUSTOM_TESTS
 void custom_tests();
@@ -10,10 +10,12 @@
 #include <stdio.h>
 
 #include "setup.h"
+#include "helper.h"
 
 static void init_structs()
 {
     battery_conf_init(&bat_conf, BAT_TYPE_FLOODED, 6, 100);
+    charger.bms_connected = false;
     charger.init_terminal(&bat_conf);
     charger.state = CHG_STATE_IDLE;
     charger.bat_temperature = 25;
@@ -225,7 +227,134 @@ void stop_equalization_after_time_limit()
 
 void restart_bulk_from_trickle_if_voltage_drops()
 {
-    TEST_ASSERT(0);
+    stop_topping_after_time_limit();
+
+    // trickle voltage reached
+    bat_terminal.current = 0;
+    bat_terminal.bus->voltage = bat_conf.trickle_voltage + 0.1;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_TRICKLE, charger.state);
+
+    // voltage dropped, but recharge time not yet passed
+    bat_terminal.bus->voltage = bat_conf.trickle_voltage - 0.5;
+    charger.time_target_voltage_reached = time(NULL) - bat_conf.trickle_recharge_time + 1;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_TRICKLE, charger.state);
+
+    charger.time_target_voltage_reached = time(NULL) - bat_conf.trickle_recharge_time - 1;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_BULK, charger.state);
+    TEST_ASSERT_FALSE(charger.full);
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max, bat_terminal.pos_current_limit);
+}
+
+static void charge_lithium_until_cv(float temperature)
+{
+    init_structs();
+    battery_conf_init(&bat_conf, BAT_TYPE_LFP, 4, 100);
+    charger.init_terminal(&bat_conf);
+    charger.bat_temperature = temperature;
+    charger.time_state_changed = time(NULL) - bat_conf.time_limit_recharge - 1;
+
+    bat_terminal.bus->voltage = bat_conf.voltage_recharge - 0.1;
+    bat_terminal.bus->voltage_filtered = bat_terminal.bus->voltage;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_BULK, charger.state);
+
+    bat_terminal.bus->voltage = bat_conf.topping_voltage + 0.1;
+    bat_terminal.bus->voltage_filtered = bat_terminal.bus->voltage;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_TOPPING, charger.state);
+}
+
+void lithium_cc_cv_without_float_stage()
+{
+    charge_lithium_until_cv(25);
+    charger.apply_bms_limits();     // port limits are updated in the control thread
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max, bat_terminal.pos_current_limit);
+
+    // current tapers off at CV limit until cut-off current is reached
+    bat_terminal.current = bat_conf.topping_current_cutoff + 1;
+    bat_terminal.current_filtered = bat_terminal.current;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_TOPPING, charger.state);
+
+    bat_terminal.current = bat_conf.topping_current_cutoff - 0.1;
+    bat_terminal.current_filtered = bat_terminal.current;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_IDLE, charger.state);
+    TEST_ASSERT_TRUE(charger.full);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL(0, bat_terminal.pos_current_limit);
+
+    // no trickle charging even if enabled by the user
+    bat_conf.trickle_enabled = true;
+    charge_lithium_until_cv(25);
+    bat_conf.trickle_enabled = true;
+    bat_terminal.current_filtered = bat_conf.topping_current_cutoff - 0.1;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_IDLE, charger.state);
+}
+
+void lithium_charge_current_derated_at_low_temperature()
+{
+    charge_lithium_until_cv(5);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max * 0.6F, bat_terminal.pos_current_limit);
+
+    // derating is continuously updated
+    bat_terminal.current_filtered = bat_conf.topping_current_cutoff + 1;
+    charger.bat_temperature = 42;
+    charger.charge_control(&bat_conf);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max * 0.9F, bat_terminal.pos_current_limit);
+}
+
+void charge_current_derating_curve()
+{
+    TEST_ASSERT_EQUAL_FLOAT(1.0, charge_current_derating(&charge_profile_lead_acid, -10));
+    TEST_ASSERT_EQUAL_FLOAT(1.0, charge_current_derating(&charge_profile_lead_acid, 60));
+
+    TEST_ASSERT_EQUAL_FLOAT(0.2, charge_current_derating(&charge_profile_lithium, -5));
+    TEST_ASSERT_EQUAL_FLOAT(0.6, charge_current_derating(&charge_profile_lithium, 5));
+    TEST_ASSERT_EQUAL_FLOAT(1.0, charge_current_derating(&charge_profile_lithium, 25));
+    TEST_ASSERT_EQUAL_FLOAT(0.5, charge_current_derating(&charge_profile_lithium, 55));
+}
+
+// simple CC-only profile to test definition of new profiles without code changes
+static const ChargeProfile charge_profile_cc_only = {
+    {
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+        {
+            &BatConf::topping_voltage, &BatConf::charge_current_max, NULL, NULL,
+            CHG_EXIT_TARGET_VOLTAGE | CHG_EXIT_FULL,
+            CHG_STATE_IDLE, CHG_STATE_BULK, 0
+        },
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+        { NULL, NULL, NULL, NULL, 0, CHG_STATE_IDLE, CHG_STATE_IDLE, 0 },
+    },
+    NULL, 0
+};
+
+void custom_charge_profile()
+{
+    init_structs();
+    bat_conf.charge_profile = &charge_profile_cc_only;
+    charger.time_state_changed = time(NULL) - bat_conf.time_limit_recharge - 1;
+    bat_terminal.bus->voltage = bat_conf.voltage_recharge - 0.1;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_BULK, charger.state);
+
+    bat_terminal.bus->voltage = bat_conf.topping_voltage + 0.1;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_IDLE, charger.state);
+    TEST_ASSERT_TRUE(charger.full);
+
+    // state not defined in the profile
+    charger.state = CHG_STATE_TRICKLE;
+    charger.charge_control(&bat_conf);
+    TEST_ASSERT_EQUAL(CHG_STATE_IDLE, charger.state);
 }
 
 void stop_discharge_at_low_voltage()
@@ -238,6 +367,7 @@ void stop_discharge_at_low_voltage()
 
     bat_terminal.bus->voltage = bat_conf.voltage_absolute_min - 0.1;
     charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
     TEST_ASSERT_EQUAL(0, bat_terminal.neg_current_limit);
 }
 
@@ -248,6 +378,7 @@ void stop_discharge_at_overtemp()
 
     charger.bat_temperature = bat_conf.discharge_temp_max + 1;
     charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
     TEST_ASSERT_EQUAL(0, bat_terminal.neg_current_limit);
 }
 
@@ -258,6 +389,7 @@ void stop_discharge_at_undertemp()
 
     charger.bat_temperature = bat_conf.discharge_temp_min - 1;
     charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
     TEST_ASSERT_EQUAL(0, bat_terminal.neg_current_limit);
 }
 
@@ -268,16 +400,19 @@ void restart_discharge_if_allowed()
     // stop because of undervoltage
     bat_terminal.bus->voltage = bat_conf.voltage_absolute_min - 0.1;
     charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
     TEST_ASSERT_EQUAL(0, bat_terminal.neg_current_limit);
 
     // increase voltage slightly above absolute minimum
     bat_terminal.bus->voltage = bat_conf.voltage_absolute_min + 0.05;
     charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
     TEST_ASSERT_EQUAL(0, bat_terminal.neg_current_limit);
 
     // increase voltage above hysteresis voltage
     bat_terminal.bus->voltage = bat_conf.voltage_absolute_min + 0.15;
     charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
     TEST_ASSERT_LESS_THAN(0, bat_terminal.neg_current_limit);
 }
 
@@ -286,14 +421,418 @@ void battery_values_propagated_to_lv_bus_int()
     TEST_ASSERT(0);
 }
 
+/*
+ * Simple battery model for SOC estimation tests: OCV curve from the battery configuration plus
+ * voltage drop at the internal resistance.
+ */
+static float sim_bat_capacity;      // actual capacity of the simulated battery (Ah)
+static float sim_bat_charge;        // charge stored in the simulated battery (Ah)
+
+static void sim_bat_init(float capacity, float soc)
+{
+    init_structs();
+    sim_bat_capacity = capacity;
+    sim_bat_charge = capacity * soc;
+
+    charger.soc_initialized = false;
+    charger.rest_counter = 0;
+    charger.full_reference = false;
+    charger.charge_acc_As = 0;
+    charger.charge_acc_cycles = 0;
+    charger.usable_capacity = 0;
+    charger.discharged_Ah = 0;
+    charger.soc_reset_pending = 0;
+}
+
+static void sim_bat_run(float current, int seconds)
+{
+    for (int i = 0; i < seconds * CONFIG_CONTROL_FREQUENCY; i++) {
+        sim_bat_charge += current / (3600.0F * CONFIG_CONTROL_FREQUENCY);
+        float ocv = ocv_lookup(&bat_conf, sim_bat_charge / sim_bat_capacity, 25);
+        bat_terminal.bus->voltage = ocv + current * bat_conf.internal_resistance;
+        bat_terminal.current = current;
+        charger.update_soc(&bat_conf);
+    }
+}
+
+void soc_initialized_from_ocv()
+{
+    sim_bat_init(100, 0.5F);
+    sim_bat_run(0, 1);
+    TEST_ASSERT_EQUAL(50, charger.soc);
+}
+
+void soc_coulomb_counting_during_discharge()
+{
+    sim_bat_init(100, 1.0F);
+    sim_bat_run(0, 1);
+    TEST_ASSERT_EQUAL(100, charger.soc);
+
+    // C/10 for one hour
+    sim_bat_run(-10, 60 * 60);
+    TEST_ASSERT_EQUAL(90, charger.soc);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 10.0, charger.discharged_Ah);
+}
+
+void soc_coulomb_counting_small_currents()
+{
+    sim_bat_init(100, 1.0F);
+    sim_bat_run(0, 1);
+
+    // current below rest threshold for 10 hours
+    sim_bat_run(-0.1F, 10 * 60 * 60);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1.0, charger.discharged_Ah);
+}
+
+void soc_not_corrected_by_ocv_under_load()
+{
+    sim_bat_init(100, 0.5F);
+    sim_bat_run(0, 1);
+
+    // introduce an error in the coulomb counter
+    charger.soc_estimate = 0.8F;
+    sim_bat_run(-5, 60 * 60);
+
+    // only the discharged charge of 5 Ah is considered
+    TEST_ASSERT_EQUAL(75, charger.soc);
+}
+
+void soc_recalibrated_with_ocv_at_rest()
+{
+    sim_bat_init(100, 0.5F);
+    sim_bat_run(0, 1);
+    charger.soc_estimate = 0.8F;
+
+    // no correction before battery voltage is relaxed
+    sim_bat_run(0, 5 * 60);
+    TEST_ASSERT_EQUAL(80, charger.soc);
+
+    sim_bat_run(0, 60 * 60);
+    TEST_ASSERT_EQUAL(50, charger.soc);
+}
+
 void no_soc_above_100()
 {
-    TEST_ASSERT(0);
+    sim_bat_init(100, 0.95F);
+    sim_bat_run(0, 1);
+    sim_bat_run(10, 60 * 60);
+    TEST_ASSERT_EQUAL(100, charger.soc);
+    TEST_ASSERT_EQUAL_FLOAT(1.0, charger.soc_estimate);
 }
 
 void no_soc_below_0()
 {
-    TEST_ASSERT(0);
+    sim_bat_init(100, 0.05F);
+    sim_bat_run(0, 1);
+    sim_bat_run(-10, 60 * 60);
+    TEST_ASSERT_EQUAL(0, charger.soc);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, charger.soc_estimate);
+}
+
+void soc_reset_applied_with_next_update()
+{
+    sim_bat_init(100, 0.5F);
+    sim_bat_run(-10, 60 * 60);
+    TEST_ASSERT_EQUAL(40, charger.soc);
+
+    // requested by the state machine in the main thread
+    charger.soc_reset(SOC_RESET_COUNTER | SOC_RESET_FULL);
+    TEST_ASSERT_EQUAL(40, charger.soc);
+
+    charger.update_soc(&bat_conf);
+    TEST_ASSERT_EQUAL(100, charger.soc);
+    TEST_ASSERT_EQUAL(0, charger.discharged_Ah);
+
+    // reset is applied only once
+    sim_bat_run(-10, 60 * 60);
+    TEST_ASSERT_EQUAL(90, charger.soc);
+
+    charger.soc_reset(SOC_RESET_EMPTY);
+    charger.update_soc(&bat_conf);
+    TEST_ASSERT_EQUAL(0, charger.soc);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 10.0, charger.discharged_Ah);
+}
+
+void usable_capacity_measured_after_full_to_empty_cycle()
+{
+    // aged battery with only 80% of nominal capacity left
+    sim_bat_init(80, 1.0F);
+    sim_bat_run(0, 1);
+
+    // reach full state via charger state machine
+    stop_topping_at_cutoff_current();
+    TEST_ASSERT_TRUE(charger.full_reference);
+    charger.discharged_Ah = 5;
+    sim_bat_run(0, 1);
+    TEST_ASSERT_EQUAL(0, charger.discharged_Ah);
+
+    sim_bat_run(-10, 8 * 60 * 60);
+
+    flags_set(&load.error_flags, ERR_LOAD_SHEDDING);
+    charger.discharge_control(&bat_conf);
+    flags_clear(&load.error_flags, ERR_LOAD_SHEDDING);
+    charger.discharge_control(&bat_conf);
+    charger.update_soc(&bat_conf);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 80.0, charger.usable_capacity);
+    TEST_ASSERT_EQUAL(80, charger.soh);
+    TEST_ASSERT_EQUAL(0, charger.soc);
+    TEST_ASSERT_FALSE(charger.full_reference);
+
+    // usable capacity is used for coulomb counting from now on
+    sim_bat_run(0, 60 * 60);
+    sim_bat_run(8, 60 * 60);
+    TEST_ASSERT_EQUAL(10, charger.soc);
+}
+
+void ocv_lookup_is_inverse_of_soc_lookup()
+{
+    const int types[] = {
+        BAT_TYPE_FLOODED, BAT_TYPE_GEL, BAT_TYPE_AGM, BAT_TYPE_LFP, BAT_TYPE_NMC, BAT_TYPE_NMC_HV
+    };
+    const int cells[] = { 6, 6, 6, 4, 3, 3 };
+
+    for (unsigned int i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        battery_conf_init(&bat_conf, types[i], cells[i], 100);
+        for (float soc = 0.0F; soc <= 1.0F; soc += 0.05F) {
+            float voltage = ocv_lookup(&bat_conf, soc, 25);
+            TEST_ASSERT_FLOAT_WITHIN(0.001, soc, ocv_soc_lookup(&bat_conf, voltage, 25));
+        }
+        TEST_ASSERT_EQUAL_FLOAT(bat_conf.ocv_empty, ocv_lookup(&bat_conf, 0, 25));
+        TEST_ASSERT_EQUAL_FLOAT(bat_conf.ocv_full, ocv_lookup(&bat_conf, 1, 25));
+    }
+}
+
+void ocv_soc_lookup_saturated()
+{
+    battery_conf_init(&bat_conf, BAT_TYPE_GEL, 6, 100);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, ocv_soc_lookup(&bat_conf, bat_conf.ocv_empty - 0.5F, 25));
+    TEST_ASSERT_EQUAL_FLOAT(1.0, ocv_soc_lookup(&bat_conf, bat_conf.ocv_full + 0.5F, 25));
+}
+
+void ocv_soc_lookup_lfp_flat_region()
+{
+    battery_conf_init(&bat_conf, BAT_TYPE_LFP, 4, 100);
+
+    // 3.25 V per cell is only 20% SOC (linear curve between 3.0 V and 3.4 V would give 62.5%)
+    TEST_ASSERT_FLOAT_WITHIN(0.005, 0.20, ocv_soc_lookup(&bat_conf, 4 * 3.25F, 25));
+    TEST_ASSERT_FLOAT_WITHIN(0.005, 0.50, ocv_soc_lookup(&bat_conf, 4 * 3.30F, 25));
+}
+
+void ocv_table_temperature_variant()
+{
+    battery_conf_init(&bat_conf, BAT_TYPE_FLOODED, 6, 100);
+
+    // lead-acid OCV is lower at low temperatures
+    float voltage = ocv_lookup(&bat_conf, 0.5F, 25);
+    TEST_ASSERT_TRUE(ocv_lookup(&bat_conf, 0.5F, OCV_TABLE_TEMP_COLD) < voltage);
+    TEST_ASSERT_TRUE(ocv_soc_lookup(&bat_conf, voltage, OCV_TABLE_TEMP_COLD) > 0.5F);
+
+    // interpolation between the variants and saturation beyond their temperatures
+    float v_cold = ocv_lookup(&bat_conf, 0.5F, OCV_TABLE_TEMP_COLD);
+    TEST_ASSERT_EQUAL_FLOAT((voltage + v_cold) / 2,
+        ocv_lookup(&bat_conf, 0.5F, (25 + OCV_TABLE_TEMP_COLD) / 2.0F));
+    TEST_ASSERT_EQUAL_FLOAT(v_cold, ocv_lookup(&bat_conf, 0.5F, OCV_TABLE_TEMP_COLD - 20));
+    TEST_ASSERT_EQUAL_FLOAT(voltage, ocv_lookup(&bat_conf, 0.5F, 45));
+
+    // complete table as used by the battery model
+    float points[OCV_TABLE_POINTS];
+    ocv_table_at(&bat_conf, OCV_TABLE_TEMP_COLD, points);
+    TEST_ASSERT_EQUAL_FLOAT(v_cold, points[(OCV_TABLE_POINTS - 1) / 2]);
+    ocv_table_at(&bat_conf, 25, points);
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.ocv_full, points[OCV_TABLE_POINTS - 1]);
+}
+
+void ocv_table_not_increasing_rejected()
+{
+    battery_conf_init(&bat_conf, BAT_TYPE_GEL, 6, 100);
+    battery_conf_init(&bat_conf_user, BAT_TYPE_GEL, 6, 100);
+    TEST_ASSERT_TRUE(battery_conf_check(&bat_conf_user));
+
+    bat_conf_user.ocv_points[5] = bat_conf_user.ocv_points[4];
+    TEST_ASSERT_FALSE(battery_conf_check(&bat_conf_user));
+    TEST_ASSERT_TRUE(battery_conf_changed(&bat_conf, &bat_conf_user));
+}
+
+void ocv_table_copied_with_conf_overwrite()
+{
+    battery_conf_init(&bat_conf, BAT_TYPE_GEL, 6, 100);
+    battery_conf_init(&bat_conf_user, BAT_TYPE_GEL, 6, 100);
+
+    for (int i = 0; i < OCV_TABLE_POINTS; i++) {
+        bat_conf_user.ocv_points[i] += 0.1F;
+    }
+    battery_conf_overwrite(&bat_conf_user, &bat_conf);
+    TEST_ASSERT_FALSE(battery_conf_changed(&bat_conf, &bat_conf_user));
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf_user.ocv_points[0], bat_conf.ocv_empty);
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf_user.ocv_points[OCV_TABLE_POINTS - 1], bat_conf.ocv_full);
+}
+
+void soc_model_reset_with_conf_overwrite()
+{
+    sim_bat_init(100, 0.5F);
+    sim_bat_run(-10, 60);
+    battery_conf_overwrite(&bat_conf, &bat_conf_user);
+
+    // new config activated via ThingSet
+    battery_conf_overwrite(&bat_conf_user, &bat_conf, &charger);
+    TEST_ASSERT_TRUE(charger.soc_reset_pending & SOC_RESET_MODEL);
+
+    // model is re-initialized in the control thread without losing the SOC estimate
+    uint16_t soc = charger.soc;
+    charger.update_soc(&bat_conf);
+    TEST_ASSERT_EQUAL(0, charger.soc_reset_pending);
+    TEST_ASSERT_EQUAL(soc, charger.soc);
+
+#if CONFIG_BAT_SOC_EKF
+    // OCV table of the model follows the battery temperature
+    float points[OCV_TABLE_POINTS];
+    charger.bat_temperature = OCV_TABLE_TEMP_COLD;
+    sim_bat_run(0, 1);
+    ocv_table_at(&bat_conf, OCV_TABLE_TEMP_COLD, points);
+    TEST_ASSERT_EQUAL_FLOAT(points[OCV_TABLE_POINTS / 2],
+        charger.ekf_ocv_points[OCV_TABLE_POINTS / 2]);
+    charger.bat_temperature = 25;
+#endif
+}
+
+// charger in LFP bulk stage with limits applied by the profile
+static void init_bms_charging()
+{
+    charge_lithium_until_cv(25);
+    charger.state = CHG_STATE_BULK;
+    bat_terminal.bus->voltage = bat_conf.topping_voltage - 1.0F;
+    charger.neg_current_limit = -bat_conf.discharge_current_max;
+    charger.charge_control(&bat_conf);
+    dev_stat.clear_error(ERR_BAT_BMS_TIMEOUT);
+}
+
+void bms_limits_ignored_without_bms()
+{
+    init_bms_charging();
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-bat_conf.discharge_current_max, bat_terminal.neg_current_limit);
+    TEST_ASSERT_FALSE(dev_stat.has_error(ERR_BAT_BMS_TIMEOUT));
+}
+
+void bms_limits_applied_within_one_cycle()
+{
+    init_bms_charging();
+    float cvl = bat_conf.topping_voltage - 0.2F;
+
+    // simulated BMS sending new limits
+    charger.bms_limits_update(cvl, 10.0F, 20.0F);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-20.0F, bat_terminal.neg_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(cvl, bat_terminal.bus->sink_voltage_intercept);
+
+    // limits are kept after the charger state machine update
+    charger.charge_control(&bat_conf);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(cvl, bat_terminal.bus->sink_voltage_intercept);
+}
+
+void bms_limits_only_restrict_charger_limits()
+{
+    init_bms_charging();
+    charger.bms_limits_update(bat_conf.voltage_absolute_max + 1.0F, 1000.0F, 1000.0F);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-bat_conf.discharge_current_max, bat_terminal.neg_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.topping_voltage, bat_terminal.bus->sink_voltage_intercept);
+}
+
+void bms_timeout_stops_charging()
+{
+    init_bms_charging();
+    charger.bms_limits_update(bat_conf.topping_voltage, 10.0F, 20.0F);
+
+    charger.time_bms_limits_received = time(NULL) - CONFIG_BAT_BMS_TIMEOUT;
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, bat_terminal.pos_current_limit);
+
+    charger.time_bms_limits_received = time(NULL) - CONFIG_BAT_BMS_TIMEOUT - 1;
+    charger.charge_control(&bat_conf);
+    charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(0, bat_terminal.pos_current_limit);
+    TEST_ASSERT_TRUE(dev_stat.has_error(ERR_BAT_BMS_TIMEOUT));
+
+    // discharging still restricted to the last received limit
+    TEST_ASSERT_TRUE(bat_conf.discharge_current_max > 20.0F);
+    TEST_ASSERT_EQUAL_FLOAT(-20.0F, bat_terminal.neg_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.topping_voltage, bat_terminal.bus->sink_voltage_intercept);
+
+    // BMS messages received again
+    charger.bms_limits_update(bat_conf.topping_voltage, 10.0F, 20.0F);
+    charger.charge_control(&bat_conf);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_FALSE(dev_stat.has_error(ERR_BAT_BMS_TIMEOUT));
+}
+
+void bms_raising_limits_releases_restriction()
+{
+    init_bms_charging();
+    float cvl = bat_conf.topping_voltage - 0.2F;
+
+    charger.bms_limits_update(cvl, 5.0F, 5.0F);
+    charger.charge_control(&bat_conf);
+    charger.discharge_control(&bat_conf);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(5.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-5.0F, bat_terminal.neg_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(cvl, bat_terminal.bus->sink_voltage_intercept);
+
+    // BMS allows higher currents and voltage again (e.g. after cell balancing)
+    charger.bms_limits_update(bat_conf.topping_voltage + 1.0F, 10.0F, 20.0F);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-20.0F, bat_terminal.neg_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.topping_voltage, bat_terminal.bus->sink_voltage_intercept);
+
+    // limits are kept after the charger state machine and discharge control updates
+    charger.charge_control(&bat_conf);
+    charger.discharge_control(&bat_conf);
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-20.0F, bat_terminal.neg_current_limit);
+
+    // BMS limits above charger limits
+    charger.bms_limits_update(bat_conf.topping_voltage + 1.0F, 1000.0F, 1000.0F);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(bat_conf.charge_current_max, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(-bat_conf.discharge_current_max, bat_terminal.neg_current_limit);
+}
+
+void bms_limits_decoded_from_can_frame()
+{
+    init_bms_charging();
+
+    // CVL 14.0 V, CCL 10.0 A, DCL 20.0 A (little-endian, 0.1 V / 0.1 A resolution)
+    const uint8_t limits[] = { 0x8C, 0x00, 0x64, 0x00, 0xC8, 0x00, 0x00, 0x00 };
+    charger.bms_limits_decode(limits, sizeof(limits));
+    TEST_ASSERT_TRUE(charger.bms_connected);
+    TEST_ASSERT_EQUAL_FLOAT(14.0F, charger.bms_voltage_limit);
+    TEST_ASSERT_EQUAL_FLOAT(10.0F, charger.bms_charge_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(20.0F, charger.bms_discharge_current_limit);
+
+    // negative current limits (CCL -5.0 A, DCL -0.1 A) are clamped to zero
+    const uint8_t negative[] = { 0x8C, 0x00, 0xCE, 0xFF, 0xFF, 0xFF };
+    charger.bms_limits_decode(negative, sizeof(negative));
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, charger.bms_charge_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, charger.bms_discharge_current_limit);
+    charger.apply_bms_limits();
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, bat_terminal.pos_current_limit);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, bat_terminal.neg_current_limit);
+
+    // CVL 56.0 V sent with too short frame is ignored
+    const uint8_t too_short[] = { 0x30, 0x02, 0x64, 0x00, 0xC8 };
+    charger.bms_limits_decode(too_short, sizeof(too_short));
+    TEST_ASSERT_EQUAL_FLOAT(14.0F, charger.bms_voltage_limit);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, charger.bms_charge_current_limit);
 }
 
 void bat_charger_tests()
@@ -322,7 +861,13 @@ void bat_charger_tests()
     RUN_TEST(trickle_to_equalization_if_enabled_and_deep_dis_limit_reached);
     RUN_TEST(stop_equalization_after_time_limit);
 
-    //RUN_TEST(restart_bulk_from_trickle_if_voltage_drops);
+    RUN_TEST(restart_bulk_from_trickle_if_voltage_drops);
+
+    // table-driven charge profiles
+    RUN_TEST(lithium_cc_cv_without_float_stage);
+    RUN_TEST(lithium_charge_current_derated_at_low_temperature);
+    RUN_TEST(charge_current_derating_curve);
+    RUN_TEST(custom_charge_profile);
 
     // TODO: temperature compensation
     // TODO: current compensation
@@ -334,9 +879,33 @@ void bat_charger_tests()
 
     //RUN_TEST(battery_values_propagated_to_lv_bus_int);
 
-    // ToDo: SOC calculation
-    //RUN_TEST(no_soc_above_100);
-    //RUN_TEST(no_soc_below_0);
+    // SOC and SOH estimation
+    RUN_TEST(soc_initialized_from_ocv);
+    RUN_TEST(soc_coulomb_counting_during_discharge);
+    RUN_TEST(soc_coulomb_counting_small_currents);
+    RUN_TEST(soc_not_corrected_by_ocv_under_load);
+    RUN_TEST(soc_recalibrated_with_ocv_at_rest);
+    RUN_TEST(no_soc_above_100);
+    RUN_TEST(no_soc_below_0);
+    RUN_TEST(soc_reset_applied_with_next_update);
+    RUN_TEST(usable_capacity_measured_after_full_to_empty_cycle);
+
+    // OCV-SOC lookup tables
+    RUN_TEST(ocv_lookup_is_inverse_of_soc_lookup);
+    RUN_TEST(ocv_soc_lookup_saturated);
+    RUN_TEST(ocv_soc_lookup_lfp_flat_region);
+    RUN_TEST(ocv_table_temperature_variant);
+    RUN_TEST(ocv_table_not_increasing_rejected);
+    RUN_TEST(ocv_table_copied_with_conf_overwrite);
+    RUN_TEST(soc_model_reset_with_conf_overwrite);
+
+    // limits from external BMS
+    RUN_TEST(bms_limits_ignored_without_bms);
+    RUN_TEST(bms_limits_applied_within_one_cycle);
+    RUN_TEST(bms_limits_only_restrict_charger_limits);
+    RUN_TEST(bms_timeout_stops_charging);
+    RUN_TEST(bms_raising_limits_releases_restriction);
+    RUN_TEST(bms_limits_decoded_from_can_frame);
 
     UNITY_END();
 }
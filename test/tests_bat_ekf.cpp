@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+
+#include "bat_ekf.h"
+
+/*
+ * Synthetic 12V lead-acid battery with first-order RC equivalent circuit
+ */
+static const float ocv_points[] = {
+    11.40, 11.56, 11.72, 11.87, 12.02, 12.17, 12.32, 12.46, 12.61, 12.76, 12.90
+};
+
+static BatEkfModel model = {
+    .ocv_points = ocv_points,
+    .ocv_num_points = sizeof(ocv_points) / sizeof(float),
+    .r0_nominal = 0.045F,
+    .rc_resistance = 0.045F,
+    .rc_time_constant = 120.0F,
+};
+
+typedef struct {
+    float capacity;     // Ah
+    float soc;
+    float v_rc;
+    float r0;
+} SimBattery;
+
+typedef struct {
+    float soc_err_max;      // max. SOC error after convergence
+    float soc_err_rms;      // RMS SOC error after convergence
+    float ns_per_update;
+} EkfResult;
+
+static uint32_t noise_state;
+
+// deterministic pseudo-random noise between -1.0 and 1.0
+static float noise()
+{
+    noise_state = noise_state * 1103515245U + 12345U;
+    return static_cast<float>((noise_state >> 16) & 0x7FFF) / 16383.5F - 1.0F;
+}
+
+static float sim_bat_ocv(float soc)
+{
+    int n = model.ocv_num_points - 1;
+    float pos = soc * n;
+    int i = (pos < 0) ? 0 : ((pos >= n) ? n - 1 : (int)pos);
+    return ocv_points[i] + (pos - i) * (ocv_points[i + 1] - ocv_points[i]);
+}
+
+static float sim_bat_step(SimBattery *bat, float current, float dt)
+{
+    float a = expf(-dt / model.rc_time_constant);
+    bat->soc += current * dt / (3600.0F * bat->capacity);
+    bat->v_rc = a * bat->v_rc + model.rc_resistance * (1.0F - a) * current;
+    return sim_bat_ocv(bat->soc) + bat->v_rc + bat->r0 * current;
+}
+
+static float profile_constant(int t)
+{
+    return -5.0F;      // C/20 discharge
+}
+
+static float profile_pulsed(int t)
+{
+    return (t % 300 < 60) ? -20.0F : 0.0F;
+}
+
+static float profile_solar_day(int t)
+{
+    // 8 hours of solar charging followed by constant night load
+    const int day = 8 * 3600;
+    if (t < day) {
+        return 15.0F * sinf(3.14159F * t / day) - 3.0F;
+    }
+    return -3.0F;
+}
+
+static EkfResult run_profile(float (*profile)(int), int duration, SimBattery *bat,
+    float soc_init, BatEkf *ekf)
+{
+    EkfResult res = {};
+    const int t_converged = 3600;
+    double ns_total = 0;
+    double err_sq_sum = 0;
+
+    noise_state = 1;
+    ekf->init(&model, soc_init);
+
+    for (int t = 0; t < duration; t++) {
+        float current = profile(t);
+        float voltage = sim_bat_step(bat, current, 1.0F);
+
+        // current sensor offset and voltage noise
+        float current_meas = current + 0.05F;
+        float voltage_meas = voltage + 0.01F * noise();
+
+        auto start = std::chrono::steady_clock::now();
+        ekf->update(current_meas, voltage_meas, 1.0F, bat->capacity);
+        auto end = std::chrono::steady_clock::now();
+        ns_total += std::chrono::duration<double, std::nano>(end - start).count();
+
+        if (t >= t_converged) {
+            float err = fabsf(ekf->soc - bat->soc);
+            err_sq_sum += err * err;
+            if (err > res.soc_err_max) {
+                res.soc_err_max = err;
+            }
+        }
+    }
+
+    res.soc_err_rms = sqrt(err_sq_sum / (duration - t_converged));
+    res.ns_per_update = ns_total / duration;
+    return res;
+}
+
+void ekf_soc_converges_from_wrong_init()
+{
+    SimBattery bat = { 100.0F, 0.8F, 0.0F, model.r0_nominal };
+    BatEkf ekf;
+    EkfResult res = run_profile(profile_constant, 4 * 3600, &bat, 0.4F, &ekf);
+    TEST_ASSERT_FLOAT_WITHIN(0.03, bat.soc, ekf.soc);
+    TEST_ASSERT_LESS_THAN(5, (int)(res.soc_err_max * 100));
+}
+
+void ekf_no_soc_drift_with_current_offset()
+{
+    // 0.05 A current sensor offset would cause 0.6 Ah error after 12 hours
+    SimBattery bat = { 100.0F, 0.9F, 0.0F, model.r0_nominal };
+    BatEkf ekf;
+    EkfResult res = run_profile(profile_pulsed, 12 * 3600, &bat, 0.9F, &ekf);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, bat.soc, ekf.soc);
+    TEST_ASSERT_LESS_THAN(2, (int)(res.soc_err_rms * 100));
+}
+
+void ekf_soh_from_increased_resistance()
+{
+    // aged battery with 50% increased series resistance
+    SimBattery bat = { 100.0F, 0.9F, 0.0F, 1.5F * model.r0_nominal };
+    BatEkf ekf;
+    run_profile(profile_pulsed, 6 * 3600, &bat, 0.9F, &ekf);
+    TEST_ASSERT_FLOAT_WITHIN(0.1 * model.r0_nominal, bat.r0, ekf.r0);
+    TEST_ASSERT_INT_WITHIN(10, 50, ekf.soh());
+}
+
+void ekf_soc_limited_to_valid_range()
+{
+    SimBattery bat = { 100.0F, 0.98F, 0.0F, model.r0_nominal };
+    BatEkf ekf;
+    ekf.init(&model, 0.98F);
+    for (int t = 0; t < 3600; t++) {
+        // charging beyond full state (simulated battery reaches > 100%)
+        float voltage = sim_bat_step(&bat, 10.0F, 1.0F);
+        ekf.update(10.0F, voltage, 1.0F, bat.capacity);
+        TEST_ASSERT(ekf.soc <= 1.0F && ekf.soc >= 0.0F);
+    }
+}
+
+void ekf_benchmark_synthetic_profiles()
+{
+    struct {
+        const char *name;
+        float (*profile)(int);
+        int duration;
+        float soc_start;
+    } profiles[] = {
+        { "constant C/20", profile_constant, 8 * 3600, 0.9F },
+        { "pulsed 20 A", profile_pulsed, 12 * 3600, 0.9F },
+        { "solar day", profile_solar_day, 24 * 3600, 0.4F },
+    };
+
+    printf("\nEKF benchmark (update rate 1 Hz, initial SOC error -10%%, RAM %d bytes):\n",
+        (int)sizeof(BatEkf));
+    for (unsigned int i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        SimBattery bat = { 100.0F, profiles[i].soc_start, 0.0F, model.r0_nominal };
+        BatEkf ekf;
+        EkfResult res = run_profile(profiles[i].profile, profiles[i].duration, &bat,
+            profiles[i].soc_start - 0.1F, &ekf);
+        printf("  %-14s SOC error max %.2f %%, RMS %.2f %%, %.0f ns per update\n",
+            profiles[i].name, res.soc_err_max * 100, res.soc_err_rms * 100, res.ns_per_update);
+        TEST_ASSERT_LESS_THAN(5, (int)(res.soc_err_max * 100));
+    }
+}
+
+void bat_ekf_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(ekf_soc_converges_from_wrong_init);
+    RUN_TEST(ekf_no_soc_drift_with_current_offset);
+    RUN_TEST(ekf_soh_from_increased_resistance);
+    RUN_TEST(ekf_soc_limited_to_valid_range);
+    RUN_TEST(ekf_benchmark_synthetic_profiles);
+
+    UNITY_END();
+}
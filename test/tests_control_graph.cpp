@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include "control_graph.h"
+#include "half_bridge.h"
+#include "setup.h"
+
+static char call_log[10];
+static int call_count;
+static bool mock_charging;
+
+template <char id>
+struct MockComponent
+{
+    static constexpr bool exists = true;
+
+    static void control()
+    {
+        call_log[call_count++] = id;
+    }
+
+    static void energy_balance()
+    {
+        call_log[call_count++] = id + 1;
+    }
+
+    static bool charging()
+    {
+        return mock_charging;
+    }
+};
+
+static void reset_log()
+{
+    call_count = 0;
+    for (unsigned int i = 0; i < sizeof(call_log); i++) {
+        call_log[i] = 0;
+    }
+}
+
+void control_graph_calls_components_in_order()
+{
+    using Graph = ControlGraph<MockComponent<'a'>, NoComponent, MockComponent<'x'>>;
+
+    reset_log();
+    Graph::control();
+    TEST_ASSERT_EQUAL_STRING("ax", call_log);
+
+    reset_log();
+    Graph::energy_balance();
+    TEST_ASSERT_EQUAL_STRING("by", call_log);
+}
+
+void control_graph_charging_if_any_component_charging()
+{
+    using Graph = ControlGraph<NoComponent, MockComponent<'a'>>;
+
+    mock_charging = false;
+    TEST_ASSERT_FALSE(Graph::charging());
+    mock_charging = true;
+    TEST_ASSERT_TRUE(Graph::charging());
+
+    TEST_ASSERT_FALSE(ControlGraph<>::charging());
+    TEST_ASSERT_FALSE(ControlGraph<NoComponent>::charging());
+}
+
+void control_graph_size_without_missing_components()
+{
+    TEST_ASSERT_EQUAL(0, ControlGraph<>::size);
+    TEST_ASSERT_EQUAL(1, (ControlGraph<NoComponent, MockComponent<'a'>>::size));
+}
+
+void power_components_match_board()
+{
+    // the test board has all components
+    static_assert(PowerComponents::size == BOARD_HAS_PWM_PORT + BOARD_HAS_DCDC +
+        BOARD_HAS_LOAD_OUTPUT + BOARD_HAS_USB_OUTPUT, "Missing power components");
+    TEST_ASSERT_EQUAL(4, PowerComponents::size);
+}
+
+void power_components_charging_with_dcdc()
+{
+    half_bridge_stop();
+    TEST_ASSERT_FALSE(PowerComponents::charging());
+
+    half_bridge_set_duty_cycle(0.5);
+    half_bridge_start();
+    TEST_ASSERT_TRUE(PowerComponents::charging());
+    half_bridge_stop();
+}
+
+void control_graph_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(control_graph_calls_components_in_order);
+    RUN_TEST(control_graph_charging_if_any_component_charging);
+    RUN_TEST(control_graph_size_without_missing_components);
+    RUN_TEST(power_components_match_board);
+    RUN_TEST(power_components_charging_with_dcdc);
+
+    UNITY_END();
+}
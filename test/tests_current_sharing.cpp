@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include <math.h>
+
+#include "current_sharing.h"
+
+#define NUM_UNITS 3
+
+/*
+ * Simulation of multiple charge controllers in CV mode connected to the same battery via wires
+ * with different resistance
+ */
+struct SimUnit {
+    DcBus bus;
+    PowerPort port;
+    CurrentSharing sharing;
+    float wire_resistance;
+    float mppt_current;         // current of a power-limited unit (0 if in CV mode)
+
+    SimUnit() : port(&bus, true), sharing(&port) {}
+};
+
+static const float bat_ocv = 14.0F;
+static const float bat_resistance = 0.01F;
+
+static SimUnit sim_units[NUM_UNITS];
+
+static void sim_init(const float *wire_resistance)
+{
+    for (int i = 0; i < NUM_UNITS; i++) {
+        SimUnit *u = &sim_units[i];
+        u->bus.series_multiplier = 1;
+        u->bus.sink_voltage_intercept = 14.4F;
+        u->bus.sink_voltage_offset = 0;
+        u->bus.sink_droop_res = 0;
+        u->port.pos_current_limit = 20.0F;
+        u->port.current = 0;
+        u->sharing = CurrentSharing(&u->port);
+        u->wire_resistance = wire_resistance[i];
+        u->mppt_current = 0;
+    }
+}
+
+static float sim_unit_current(SimUnit *u, float bat_voltage)
+{
+    if (u->mppt_current > 0) {
+        return u->mppt_current;
+    }
+
+    // CV control of the terminal voltage (droop neglected, as current is not known in advance)
+    float current = (u->bus.sink_control_voltage() - bat_voltage) / u->wire_resistance;
+    if (current < 0) {
+        return 0;
+    }
+    else if (current > u->port.pos_current_limit) {
+        return u->port.pos_current_limit;
+    }
+    return current;
+}
+
+// determines the steady-state currents for the actual voltage references
+static void sim_step()
+{
+    float v_low = bat_ocv;
+    float v_high = bat_ocv + 1.0F;
+    for (int n = 0; n < 40; n++) {
+        float v_bat = (v_low + v_high) / 2;
+        float current_total = 0;
+        for (int i = 0; i < NUM_UNITS; i++) {
+            current_total += sim_unit_current(&sim_units[i], v_bat);
+        }
+        if (v_bat > bat_ocv + bat_resistance * current_total) {
+            v_high = v_bat;
+        }
+        else {
+            v_low = v_bat;
+        }
+    }
+
+    for (int i = 0; i < NUM_UNITS; i++) {
+        sim_units[i].port.current = sim_unit_current(&sim_units[i], v_low);
+    }
+}
+
+static void sim_run(int cycles)
+{
+    for (int n = 0; n < cycles; n++) {
+        sim_step();
+
+        for (int i = 0; i < NUM_UNITS; i++) {
+            sim_units[i].sharing.control(sim_units[i].mppt_current > 0);
+        }
+
+        // exchange data via simulated CAN bus
+        for (int i = 0; i < NUM_UNITS; i++) {
+            uint8_t data[8];
+            int len = sim_units[i].sharing.encode(data);
+            for (int j = 0; j < NUM_UNITS; j++) {
+                if (j != i) {
+                    sim_units[j].sharing.decode(i + 1, data, len);
+                }
+            }
+        }
+    }
+    sim_step();
+}
+
+void unbalanced_currents_without_sharing()
+{
+    const float wire_resistance[NUM_UNITS] = { 0.005F, 0.01F, 0.02F };
+    sim_init(wire_resistance);
+    for (int i = 0; i < NUM_UNITS; i++) {
+        sim_units[i].sharing.enable = false;
+    }
+    sim_run(300);
+
+    TEST_ASSERT_TRUE(sim_units[0].port.current > 3 * sim_units[2].port.current);
+}
+
+void currents_balanced_with_different_wire_resistance()
+{
+    const float wire_resistance[NUM_UNITS] = { 0.005F, 0.01F, 0.02F };
+    sim_init(wire_resistance);
+    sim_run(300);
+
+    float current_avg = 0;
+    for (int i = 0; i < NUM_UNITS; i++) {
+        current_avg += sim_units[i].port.current / NUM_UNITS;
+    }
+    TEST_ASSERT_TRUE(current_avg > 1.0F);
+    for (int i = 0; i < NUM_UNITS; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.05F * current_avg, current_avg, sim_units[i].port.current);
+
+        // charge voltage must never be exceeded
+        TEST_ASSERT_TRUE(sim_units[i].bus.sink_voltage_offset <= 0.0F);
+    }
+}
+
+void power_limited_unit_not_balanced()
+{
+    const float wire_resistance[NUM_UNITS] = { 0.005F, 0.01F, 0.02F };
+    sim_init(wire_resistance);
+    sim_units[2].mppt_current = 2.0F;
+    sim_run(300);
+
+    TEST_ASSERT_EQUAL_FLOAT(2.0F, sim_units[2].port.current);
+    TEST_ASSERT_FLOAT_WITHIN(0.05F * sim_units[1].port.current, sim_units[1].port.current,
+        sim_units[0].port.current);
+}
+
+void sharing_offset_reset_without_peers()
+{
+    const float wire_resistance[NUM_UNITS] = { 0.005F, 0.01F, 0.02F };
+    sim_init(wire_resistance);
+    sim_run(300);
+    TEST_ASSERT_TRUE(sim_units[0].bus.sink_voltage_offset < 0.0F);
+
+    // other units disappeared from the bus
+    for (int i = 0; i < CURRENT_SHARING_MAX_PEERS; i++) {
+        sim_units[0].sharing.peers[i].time_received -= sim_units[0].sharing.timeout + 1;
+    }
+    sim_units[0].sharing.control(false);
+    TEST_ASSERT_EQUAL_FLOAT(0.0F, sim_units[0].bus.sink_voltage_offset);
+}
+
+void sharing_data_encoded_for_can()
+{
+    const float wire_resistance[NUM_UNITS] = { 0.005F, 0.01F, 0.02F };
+    sim_init(wire_resistance);
+    sim_units[0].port.current = 12.34F;
+    sim_units[0].sharing.control(false);
+
+    uint8_t data[8];
+    int len = sim_units[0].sharing.encode(data);
+    TEST_ASSERT_EQUAL(4, len);
+
+    sim_units[1].sharing.decode(42, data, len);
+    TEST_ASSERT_EQUAL(42, sim_units[1].sharing.peers[0].node_id);
+    TEST_ASSERT_FLOAT_WITHIN(0.01F, 12.34F, sim_units[1].sharing.peers[0].current);
+    TEST_ASSERT_FLOAT_WITHIN(0.01F, 20.0F - 12.34F, sim_units[1].sharing.peers[0].headroom);
+
+    // frames with invalid length are ignored
+    sim_units[1].sharing.decode(43, data, 3);
+    TEST_ASSERT_FALSE(sim_units[1].sharing.peers[1].valid);
+}
+
+void current_sharing_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(unbalanced_currents_without_sharing);
+    RUN_TEST(currents_balanced_with_different_wire_resistance);
+    RUN_TEST(power_limited_unit_not_balanced);
+    RUN_TEST(sharing_offset_reset_without_peers);
+    RUN_TEST(sharing_data_encoded_for_can);
+
+    UNITY_END();
+}
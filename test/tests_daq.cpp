@@ -14,6 +14,10 @@
 
 static AdcValues adcval;
 
+extern volatile uint16_t adc_readings[];
+extern volatile bool adc_pwm_sync;
+extern volatile bool adc_timer_sync;
+
 void test_adc_voltage_to_raw()
 {
     int32_t raw;
@@ -167,6 +171,71 @@ void adc_alert_hv_overvoltage_triggering()
     TEST_ASSERT_EQUAL(DCDC_CONTROL_OFF, dcdc.state);
 }
 
+void adc_pwm_readings_synchronized_with_on_phase()
+{
+    clear_adc_filtered();
+    adc_readings[ADC_POS(i_pwm)] = 1000 << 4;
+    pwm_signal_start(0.5F);
+
+    // conversions triggered by the 1 kHz timer are ignored while switching
+    adc_update_value(ADC_POS(i_pwm));
+    TEST_ASSERT_EQUAL(0, get_adc_filtered(ADC_POS(i_pwm)));
+
+    adc_pwm_sync = true;
+    adc_timer_sync = false;
+    adc_update_value(ADC_POS(i_pwm));
+    adc_pwm_sync = false;
+    adc_timer_sync = true;
+    uint32_t filtered = get_adc_filtered(ADC_POS(i_pwm));
+    TEST_ASSERT_TRUE(filtered > 0);
+
+    // all conversions are used if the switch is permanently off
+    pwm_signal_stop();
+    adc_update_value(ADC_POS(i_pwm));
+    TEST_ASSERT_TRUE(get_adc_filtered(ADC_POS(i_pwm)) > filtered);
+
+    adc_readings[ADC_POS(i_pwm)] = 0;
+    prepare_adc_filtered();
+}
+
+void adc_pwm_sync_conversions_ignored_for_other_channels()
+{
+    dev_stat.clear_error(ERR_ANY_ERROR);
+    battery_conf_init(&bat_conf, BAT_TYPE_LFP, 4, 100);
+    daq_set_lv_limits(bat_conf.voltage_absolute_max, bat_conf.voltage_absolute_min);
+    prepare_adc_filtered();
+    adc_update_value(ADC_POS(v_low));
+    uint32_t filtered = get_adc_filtered(ADC_POS(v_low));
+
+    // additional conversions in the PWM on-phase must neither change the filtered values nor
+    // count for the alert debouncing, as both assume the 1 kHz sample rate
+    adcval.battery_voltage = bat_conf.voltage_absolute_max + 0.1;
+    prepare_adc_readings(adcval);
+    adc_pwm_sync = true;
+    adc_timer_sync = false;
+    for (int i = 0; i < 3; i++) {
+        adc_update_value(ADC_POS(v_low));
+    }
+    TEST_ASSERT_EQUAL(filtered, get_adc_filtered(ADC_POS(v_low)));
+    TEST_ASSERT_EQUAL(false, dev_stat.has_error(ERR_BAT_OVERVOLTAGE));
+
+    // conversion triggered by the timer and synchronized with the PWM at the same time
+    adc_timer_sync = true;
+    adc_update_value(ADC_POS(v_low));
+    adc_pwm_sync = false;
+    TEST_ASSERT_TRUE(get_adc_filtered(ADC_POS(v_low)) != filtered);
+    TEST_ASSERT_EQUAL(false, dev_stat.has_error(ERR_BAT_OVERVOLTAGE));
+    adc_update_value(ADC_POS(v_low));
+    TEST_ASSERT_EQUAL(true, dev_stat.has_error(ERR_BAT_OVERVOLTAGE));
+
+    // reset values
+    dev_stat.clear_error(ERR_ANY_ERROR);
+    adcval.battery_voltage = 12;
+    prepare_adc_readings(adcval);
+    prepare_adc_filtered();
+    daq_update();
+}
+
 void adc_alert_overflow_prevention()
 {
     // try to set an alert that overflows the 12-bit ADC resolution
@@ -210,5 +279,8 @@ void daq_tests()
     RUN_TEST(adc_alert_hv_overvoltage_triggering);
     RUN_TEST(adc_alert_overflow_prevention);
 
+    RUN_TEST(adc_pwm_readings_synchronized_with_on_phase);
+    RUN_TEST(adc_pwm_sync_conversions_ignored_for_other_channels);
+
     UNITY_END();
 }
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include "data_nodes.h"
+#include "data_storage.h"
+#include "pub_channel.h"
+#include "pub_template.h"
+#include "setup.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_NODES_MAX 4096
+
+static DataNode bench_nodes[BENCH_NODES_MAX];
+static char bench_names[BENCH_NODES_MAX][8];
+
+void pub_channel_due_at_interval()
+{
+    PubChannel ch(PUB_SER, true, 1000);
+
+    TEST_ASSERT_TRUE(ch.due(0));
+    TEST_ASSERT_FALSE(ch.due(999));
+    TEST_ASSERT_TRUE(ch.due(1000));
+    TEST_ASSERT_FALSE(ch.due(1000));
+
+    // late call must not shift the phase of the following publications
+    TEST_ASSERT_TRUE(ch.due(2050));
+    TEST_ASSERT_FALSE(ch.due(2999));
+    TEST_ASSERT_TRUE(ch.due(3000));
+}
+
+void pub_channel_skips_missed_publications()
+{
+    PubChannel ch(PUB_SER, true, 100);
+
+    TEST_ASSERT_TRUE(ch.due(0));
+
+    // thread blocked for a long time: only one publication instead of a burst
+    TEST_ASSERT_TRUE(ch.due(1050));
+    TEST_ASSERT_FALSE(ch.due(1051));
+    TEST_ASSERT_EQUAL(1150, ch.next(1051));
+}
+
+void pub_channel_disabled()
+{
+    PubChannel ch(PUB_SER, false, 1000);
+
+    TEST_ASSERT_FALSE(ch.due(0));
+    TEST_ASSERT_FALSE(ch.due(5000));
+    TEST_ASSERT_TRUE(ch.next(5000) == INT64_MAX);
+
+    // publish immediately after enabling
+    ch.enable = true;
+    TEST_ASSERT_TRUE(ch.due(5500));
+    TEST_ASSERT_FALSE(ch.due(6000));
+    TEST_ASSERT_TRUE(ch.due(6500));
+}
+
+void pub_channel_interval_limited_to_control_rate()
+{
+    PubChannel ch(PUB_SER, true, 1);
+
+    TEST_ASSERT_TRUE(ch.due(0));
+    TEST_ASSERT_FALSE(ch.due(PUB_INTERVAL_MIN - 1));
+    TEST_ASSERT_TRUE(ch.due(PUB_INTERVAL_MIN));
+}
+
+void pub_channels_next_earliest()
+{
+    PubChannel channels[] = {
+        PubChannel(PUB_SER, true, 1000),
+        PubChannel(PUB_SER_FAST, true, 100),
+        PubChannel(PUB_SER_SLOW, false, 60000),
+    };
+
+    for (int i = 0; i < 3; i++) {
+        channels[i].due(0);
+    }
+    TEST_ASSERT_EQUAL(100, pub_channels_next(channels, 3, 10));
+
+    channels[0].enable = false;
+    channels[1].enable = false;
+    TEST_ASSERT_TRUE(pub_channels_next(channels, 3, 10) == INT64_MAX);
+}
+
+static float tmpl_float = 14.1F;
+static float tmpl_float_int = -2.6F;
+static int32_t tmpl_int32 = -1234;
+static uint32_t tmpl_uint32 = 100000;
+static uint16_t tmpl_uint16 = 300;
+static bool tmpl_bool = true;
+static char tmpl_string[] = "abc";
+static float tmpl_array_data[2];
+static ArrayInfo tmpl_array = { tmpl_array_data, 2, 2, TS_T_FLOAT32 };
+
+static DataNode tmpl_nodes[] = {
+    TS_NODE_PATH(0x70, "output", 0, NULL),
+    TS_NODE_FLOAT(0x71, "Bat_V", &tmpl_float, 2, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_FLOAT(0x72, "Temp_degC", &tmpl_float_int, 0, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_INT32(0x73, "Int", &tmpl_int32, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_UINT32(0x74, "Uint", &tmpl_uint32, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_UINT16(0x75, "Short", &tmpl_uint16, 0x70, TS_ANY_R, PUB_SER | PUB_CAN),
+    TS_NODE_BOOL(0x76, "Flag", &tmpl_bool, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_STRING(0x77, "Str", tmpl_string, 0, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_ARRAY(0x78, "Arr", &tmpl_array, 2, 0x70, TS_ANY_R, PUB_SER_SLOW),
+    TS_NODE_FLOAT(0x79, "Unused", &tmpl_float, 2, 0x70, TS_ANY_R, 0),
+};
+
+#define TMPL_NUM_NODES (sizeof(tmpl_nodes)/sizeof(DataNode))
+
+static PubTemplateEntry tmpl_entries[BENCH_NODES_MAX];
+
+void pub_template_txt_message()
+{
+    PubTemplate tmpl(tmpl_entries, 16);
+    char buf[200];
+
+    TEST_ASSERT_TRUE(tmpl.build(tmpl_nodes, TMPL_NUM_NODES, PUB_SER));
+    TEST_ASSERT_EQUAL(7, tmpl.size());
+
+    int len = tmpl.txt_pub(buf, sizeof(buf));
+    const char expected[] = "# {\"Bat_V\":14.10,\"Temp_degC\":-3,\"Int\":-1234,\"Uint\":100000,"
+        "\"Short\":300,\"Flag\":true,\"Str\":\"abc\"}";
+    TEST_ASSERT_EQUAL_STRING(expected, buf);
+    TEST_ASSERT_EQUAL(strlen(expected), len);
+
+    // too small buffer
+    TEST_ASSERT_EQUAL(0, tmpl.txt_pub(buf, 20));
+    TEST_ASSERT_EQUAL(0, tmpl.txt_pub(buf, len));
+    TEST_ASSERT_EQUAL(len, tmpl.txt_pub(buf, len + 1));
+
+    // values are read at publication time
+    tmpl_uint16 = 5;
+    tmpl.txt_pub(buf, sizeof(buf));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"Short\":5,"));
+    tmpl_uint16 = 300;
+}
+
+void pub_template_bin_message()
+{
+    PubTemplate tmpl(tmpl_entries, 16);
+    uint8_t buf[50];
+
+    TEST_ASSERT_TRUE(tmpl.build(tmpl_nodes, TMPL_NUM_NODES, PUB_CAN));
+
+    int len = tmpl.bin_pub(buf, sizeof(buf));
+    const uint8_t expected[] = { PUB_TEMPLATE_BIN_PUBMSG, 0xA1, 0x18, 0x75, 0x19, 0x01, 0x2C };
+    TEST_ASSERT_EQUAL(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, sizeof(expected));
+
+    TEST_ASSERT_TRUE(tmpl.build(tmpl_nodes, TMPL_NUM_NODES, PUB_SER));
+    len = tmpl.bin_pub(buf, sizeof(buf));
+    const uint8_t expected_ser[] = {
+        PUB_TEMPLATE_BIN_PUBMSG, 0xA7,
+        0x18, 0x71, 0xFA, 0x41, 0x61, 0x99, 0x9A,       // 14.1F
+        0x18, 0x72, 0x22,                               // -3 (rounded)
+        0x18, 0x73, 0x39, 0x04, 0xD1,                   // -1234
+        0x18, 0x74, 0x1A, 0x00, 0x01, 0x86, 0xA0,       // 100000
+        0x18, 0x75, 0x19, 0x01, 0x2C,                   // 300
+        0x18, 0x76, 0xF5,                               // true
+        0x18, 0x77, 0x63, 'a', 'b', 'c',
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected_ser), len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected_ser, buf, sizeof(expected_ser));
+
+    TEST_ASSERT_EQUAL(0, tmpl.bin_pub(buf, sizeof(expected_ser) - 1));
+}
+
+void pub_template_invalid_for_unsupported_nodes()
+{
+    PubTemplate tmpl(tmpl_entries, 16);
+    char buf[100];
+
+    // array
+    TEST_ASSERT_FALSE(tmpl.build(tmpl_nodes, TMPL_NUM_NODES, PUB_SER_SLOW));
+    TEST_ASSERT_FALSE(tmpl.valid());
+    TEST_ASSERT_EQUAL(0, tmpl.txt_pub(buf, sizeof(buf)));
+
+    // more nodes than template capacity
+    PubTemplate tmpl_small(tmpl_entries, 3);
+    TEST_ASSERT_FALSE(tmpl_small.build(tmpl_nodes, TMPL_NUM_NODES, PUB_SER));
+    TEST_ASSERT_EQUAL(0, tmpl_small.size());
+}
+
+void pub_template_for_data_nodes_channels()
+{
+    PubTemplate tmpl(tmpl_entries, 32);
+
+    // default configuration must be covered by the template in firmware (max. 32 nodes)
+    TEST_ASSERT_TRUE(tmpl.build(data_nodes, num_data_nodes, PUB_SER));
+    TEST_ASSERT_TRUE(tmpl.size() > 0);
+    TEST_ASSERT_TRUE(tmpl.build(data_nodes, num_data_nodes, PUB_SER_FAST));
+    TEST_ASSERT_EQUAL(2, tmpl.size());
+    TEST_ASSERT_TRUE(tmpl.build(data_nodes, num_data_nodes, PUB_SER_SLOW));
+}
+
+static double bench_bytes_per_us(size_t num, bool precompiled)
+{
+    static char buf[4096];
+    PubTemplate tmpl(tmpl_entries, BENCH_NODES_MAX);
+    size_t bytes = 0;
+    int runs = 20000;
+
+    tmpl.build(tmpl_nodes, TMPL_NUM_NODES, PUB_SER);   // warm-up and dummy contents
+
+    clock_t start = clock();
+    for (int i = 0; i < runs; i++) {
+        if (!precompiled || i == 0) {
+            // the library filters the table and selects the encoders for each message
+            tmpl.build(bench_nodes, num, PUB_SER);
+        }
+        bytes += tmpl.txt_pub(buf, sizeof(buf));
+    }
+    clock_t end = clock();
+
+    return bytes / ((double)(end - start) / CLOCKS_PER_SEC * 1e6);
+}
+
+void pub_template_throughput_benchmark()
+{
+    static float values[BENCH_NODES_MAX];
+    double filtered = 0;
+    double precompiled = 0;
+
+    for (size_t num = 128; num <= 2048; num *= 4) {
+        // 20 published float values spread over the table
+        for (size_t i = 0; i < num; i++) {
+            values[i] = i * 0.1F;
+            snprintf(bench_names[i], sizeof(bench_names[i]), "V%u", (unsigned)i);
+            DataNode node = TS_NODE_FLOAT((uint16_t)(0x1000 + i), bench_names[i], &values[i], 2,
+                0, TS_ANY_R, (uint16_t)((i % (num / 20) == 0) ? PUB_SER : 0));
+            memcpy(&bench_nodes[i], &node, sizeof(DataNode));
+        }
+
+        filtered = bench_bytes_per_us(num, false);
+        precompiled = bench_bytes_per_us(num, true);
+
+        printf("Publication with %4u nodes: %6.1f bytes/us precompiled "
+            "(filtered: %6.1f bytes/us)\n", (unsigned)num, precompiled, filtered);
+    }
+
+    TEST_ASSERT_TRUE(precompiled > filtered);
+}
+
+extern ThingSet ts;
+
+void data_nodes_nvm_size_fits_storage_buffer()
+{
+    uint8_t buf[DATA_STORAGE_BUF_SIZE - DATA_STORAGE_HEADER_MAX];
+
+    int len = ts.bin_pub(buf, sizeof(buf), PUB_NVM);
+    TEST_ASSERT_TRUE(len > 0);
+    printf("Serialized NVM data: %d bytes (buffer: %u bytes)\n", len, (unsigned)sizeof(buf));
+}
+
+void data_nodes_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(pub_channel_due_at_interval);
+    RUN_TEST(pub_channel_skips_missed_publications);
+    RUN_TEST(pub_channel_disabled);
+    RUN_TEST(pub_channel_interval_limited_to_control_rate);
+    RUN_TEST(pub_channels_next_earliest);
+
+    RUN_TEST(pub_template_txt_message);
+    RUN_TEST(pub_template_bin_message);
+    RUN_TEST(pub_template_invalid_for_unsupported_nodes);
+    RUN_TEST(pub_template_for_data_nodes_channels);
+    RUN_TEST(pub_template_throughput_benchmark);
+
+    RUN_TEST(data_nodes_nvm_size_fits_storage_buffer);
+
+    UNITY_END();
+}
@@ -14,6 +14,8 @@
 
 #include "setup.h"
 
+extern uint16_t tim_ccr_step;  // dummy register of the half bridge driver for unit tests
+
 static void init_structs_buck(int num_batteries = 1)
 {
     dev_stat.error_flags = 0;
@@ -26,6 +28,7 @@ static void init_structs_buck(int num_batteries = 1)
 
     battery_conf_init(&bat_conf, BAT_TYPE_GEL, 6, 100);
     charger.port = &lv_terminal;
+    charger.bms_connected = false;
     charger.init_terminal(&bat_conf);
     lv_terminal.bus->voltage = 14 * num_batteries;
     lv_terminal.bus->series_multiplier = num_batteries;
@@ -35,11 +38,14 @@ static void init_structs_buck(int num_batteries = 1)
     dcdc.mode = DCDC_MODE_BUCK;
     dcdc.temp_mosfets = 25;
     dcdc.off_timestamp = 0;
+    dcdc.restart = RestartPolicy();
     dcdc.inductor_current = 0;
     dcdc.power = 0;
     dcdc.power_prev = 0;
     dcdc.pwm_delta = 1;
     dcdc.enable = true;
+    dcdc.power_good = false;
+    dcdc.burst = false;
 }
 
 static void start_buck()
@@ -68,6 +74,7 @@ static void init_structs_boost(int num_batteries = 1)
     int num_cells = (num_batteries == 1) ? 10 : 5;
     battery_conf_init(&bat_conf, BAT_TYPE_NMC, num_cells, 9);
     charger.port = &hv_terminal;
+    charger.bms_connected = false;
     charger.init_terminal(&bat_conf);
     hv_terminal.bus->voltage = 3.7 * num_cells * num_batteries;
     hv_terminal.bus->series_multiplier = num_batteries;
@@ -78,6 +85,7 @@ static void init_structs_boost(int num_batteries = 1)
     dcdc.mode = DCDC_MODE_BOOST;
     dcdc.temp_mosfets = 25;
     dcdc.off_timestamp = 0;
+    dcdc.restart = RestartPolicy();
     dcdc.power_prev = 0;
     dcdc.pwm_delta = 1;
     dcdc.enable = true;
@@ -120,12 +128,56 @@ void start_valid_mppt_boost_dual_battery()
 void no_start_before_restart_delay()
 {
     init_structs_buck();
-    dcdc.off_timestamp = time(NULL) - dcdc.restart_interval + 1;
+    dcdc.off_timestamp = time(NULL) - dcdc.restart.interval_min + 1;
     TEST_ASSERT_EQUAL(DCDC_MODE_OFF, dcdc.check_start_conditions());
-    dcdc.off_timestamp = time(NULL) - dcdc.restart_interval;
+    dcdc.off_timestamp = time(NULL) - dcdc.restart.interval_min;
+    TEST_ASSERT_EQUAL(DCDC_MODE_BUCK, dcdc.check_start_conditions());
+}
+
+void no_start_before_backoff_interval()
+{
+    init_structs_buck();
+    dcdc.restart.failed_starts = 2;
+    dcdc.off_timestamp = time(NULL) - 4 * dcdc.restart.interval_min + 1;
+    TEST_ASSERT_EQUAL(DCDC_MODE_OFF, dcdc.check_start_conditions());
+    dcdc.off_timestamp = time(NULL) - 4 * dcdc.restart.interval_min;
+    TEST_ASSERT_EQUAL(DCDC_MODE_BUCK, dcdc.check_start_conditions());
+}
+
+void early_start_if_solar_voltage_rising()
+{
+    init_structs_buck();
+    dcdc.restart.failed_starts = 3;
+    dcdc.off_timestamp = time(NULL) - 2 * dcdc.restart.interval_min;
+    TEST_ASSERT_EQUAL(DCDC_MODE_OFF, dcdc.check_start_conditions());
+    hv_terminal.bus->voltage = 21;
     TEST_ASSERT_EQUAL(DCDC_MODE_BUCK, dcdc.check_start_conditions());
 }
 
+void auto_mode_restart_uses_voltage_of_start_direction()
+{
+    // solar panel at low side, battery at high side: only boost mode possible
+    init_structs_boost();
+    dcdc.mode = DCDC_MODE_AUTO;
+    dcdc.restart.failed_starts = 3;
+    dcdc.off_timestamp = time(NULL) - 2 * dcdc.restart.interval_min;
+    TEST_ASSERT_EQUAL(DCDC_MODE_OFF, dcdc.check_start_conditions());
+
+    // rising solar voltage at low side (not the battery voltage) allows the early start
+    lv_terminal.bus->voltage = 21;
+    TEST_ASSERT_EQUAL(DCDC_MODE_BOOST, dcdc.check_start_conditions());
+
+    dcdc.control();
+    dcdc.control();
+    TEST_ASSERT_TRUE(half_bridge_enabled());
+
+    // start without output power increases the required start voltage of the low side
+    dcdc.stop();
+    TEST_ASSERT_EQUAL(4, dcdc.restart.failed_starts);
+    TEST_ASSERT_TRUE(dcdc.restart.voltage_start > 21);
+    TEST_ASSERT_TRUE(dcdc.restart.voltage_start < hv_terminal.bus->voltage);
+}
+
 void no_start_if_dcdc_disabled()
 {
     init_structs_buck();
@@ -313,6 +365,341 @@ void buck_correct_mppt_operation()
     TEST_ASSERT(pwm3 < pwm2);
 }
 
+void buck_burst_mode_at_low_power()
+{
+    start_buck();
+
+    // no burst mode directly after the start, as the power is still close to zero
+    dcdc.power = 0.1F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL_FLOAT(1.0, half_bridge_get_burst_duty());
+
+    dcdc.power = dcdc.burst_power * 0.3F;
+    dcdc.control();
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0.3, half_bridge_get_burst_duty());
+    TEST_ASSERT_TRUE(dcdc.burst);
+
+    // burst mode is left with hysteresis
+    dcdc.power = dcdc.burst_power + 0.5F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL_FLOAT(1.0, half_bridge_get_burst_duty());
+    TEST_ASSERT_TRUE(dcdc.burst);
+
+    dcdc.power = dcdc.burst_power * 1.5F;
+    dcdc.control();
+    TEST_ASSERT_FALSE(dcdc.burst);
+
+    dcdc.power = dcdc.burst_power + 0.5F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL_FLOAT(1.0, half_bridge_get_burst_duty());
+    TEST_ASSERT_FALSE(dcdc.burst);
+}
+
+void buck_no_stop_below_min_power_in_burst_mode()
+{
+    start_buck();
+    dcdc.power = dcdc.output_power_min * 2;
+    dcdc.control();
+
+    dcdc.power = dcdc.output_power_min * 0.5F;
+    dcdc.power_good_timestamp = time(NULL) - 11;
+    dcdc.control();
+    TEST_ASSERT(half_bridge_enabled() == true);
+    TEST_ASSERT(half_bridge_get_burst_duty() < 1.0F);
+
+    // absolute minimum power in burst mode
+    dcdc.power = dcdc.burst_power_min * 0.5F;
+    dcdc.power_good_timestamp = time(NULL) - 11;
+    dcdc.control();
+    TEST_ASSERT(half_bridge_enabled() == false);
+}
+
+void buck_stop_at_low_power_without_burst_after_start()
+{
+    start_buck();
+    dcdc.power = dcdc.output_power_min * 0.5F;
+    dcdc.power_good_timestamp = time(NULL) - 11;
+    dcdc.control();
+    TEST_ASSERT(half_bridge_enabled() == false);
+}
+
+/*
+ * Loss model of the DC/DC for low power: Constant switching losses (gate driver, inductor core)
+ * while the half bridge is switching and conduction losses at the low-side voltage.
+ *
+ * The solar panel input power is assumed to be independent of the burst duty cycle, as the
+ * input capacitor stores the energy between the bursts.
+ */
+static const float sim_loss_switching = 0.4F;       // W
+static const float sim_loss_resistance = 0.05F;     // Ohm
+
+static float sim_output_power(float input_power, float burst_duty)
+{
+    float current_burst = input_power / (lv_terminal.bus->voltage * burst_duty);
+    float losses = sim_loss_switching * burst_duty +
+        sim_loss_resistance * current_burst * current_burst * burst_duty;
+    return input_power - losses;
+}
+
+// output power with burst duty cycle set by the DC/DC control, 0 if the DC/DC was stopped
+static float sim_burst_output_power(float input_power, bool burst)
+{
+    start_buck();
+    dcdc.burst_power = burst ? 5 : 0;
+    for (int i = 0; i < 10; i++) {
+        dcdc.power = sim_output_power(input_power, half_bridge_get_burst_duty());
+        dcdc.power_good_timestamp = time(NULL) - 11;    // assume long operation at this power
+        dcdc.control();
+    }
+    return half_bridge_enabled() ? sim_output_power(input_power, half_bridge_get_burst_duty()) : 0;
+}
+
+void buck_burst_mode_efficiency_benchmark()
+{
+    const float input_power[] = { 0.5, 1, 1.5, 2, 3, 5, 10 };
+
+    for (unsigned int i = 0; i < sizeof(input_power) / sizeof(float); i++) {
+        float eff_cont = sim_burst_output_power(input_power[i], false) / input_power[i];
+        float eff_burst = sim_burst_output_power(input_power[i], true) / input_power[i];
+        printf("Burst mode efficiency at %4.1f W input: %5.1f %% (continuous: %5.1f %%), "
+            "burst duty %.1f\n", input_power[i], eff_burst * 100, eff_cont * 100,
+            half_bridge_get_burst_duty());
+        TEST_ASSERT_TRUE(eff_burst >= eff_cont);
+    }
+
+    // day with small 5 W solar panel, calculated with 1 minute resolution
+    float energy_cont = 0;
+    float energy_burst = 0;
+    for (int t = 0; t < 12 * 60; t++) {
+        float input_power = 5.0F * sinf((float)M_PI * t / (12 * 60));
+        energy_cont += sim_burst_output_power(input_power, false) / 60;
+        energy_burst += sim_burst_output_power(input_power, true) / 60;
+    }
+    printf("Burst mode with 5 W panel: %.1f Wh per day (continuous: %.1f Wh), %.1f Wh extra\n",
+        energy_burst, energy_cont, energy_burst - energy_cont);
+    TEST_ASSERT_TRUE(energy_burst > energy_cont);
+
+    dcdc.burst_power = 5;
+}
+
+void buck_frequency_adjusted_to_load()
+{
+    start_buck();
+    dcdc.inductor_current = 0;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(dcdc.freq_min, half_bridge_get_frequency());
+
+    dcdc.inductor_current = dcdc.inductor_current_max;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(dcdc.freq_max, half_bridge_get_frequency());
+
+    // no update for small changes
+    dcdc.inductor_current = dcdc.inductor_current_max * 0.95F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(dcdc.freq_max, half_bridge_get_frequency());
+}
+
+void buck_deadtime_changed_during_operation()
+{
+    start_buck();
+    uint16_t deadtime_default = dcdc.deadtime;
+    dcdc.deadtime = 500;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(500, half_bridge_get_deadtime());
+    TEST_ASSERT(half_bridge_enabled() == true);
+    dcdc.deadtime = deadtime_default;
+}
+
+void buck_pwm_step_independent_of_timer_resolution()
+{
+    start_buck();
+    uint16_t freq_min_default = dcdc.freq_min;
+    uint16_t freq_max_default = dcdc.freq_max;
+
+    // low frequency results in a period of 4800 counts, similar to a high resolution timer
+    dcdc.freq_min = 5;
+    dcdc.freq_max = 5;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(5, half_bridge_get_frequency());
+
+    half_bridge_set_duty_cycle(0.8);
+    uint16_t ccr_before = half_bridge_get_ccr();
+    dcdc.control();
+    TEST_ASSERT_EQUAL(half_bridge_get_arr() / 800, half_bridge_get_ccr() - ccr_before);
+
+    dcdc.freq_min = freq_min_default;
+    dcdc.freq_max = freq_max_default;
+}
+
+void buck_pwm_step_fixed_for_system_clock_timers()
+{
+    start_buck();
+    uint16_t freq_min_default = dcdc.freq_min;
+    uint16_t freq_max_default = dcdc.freq_max;
+
+    // TIM1 and TIM3 keep the single count step also for long periods
+    tim_ccr_step = 1;
+    dcdc.freq_min = 5;
+    dcdc.freq_max = 5;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(5, half_bridge_get_frequency());
+
+    half_bridge_set_duty_cycle(0.8);
+    uint16_t ccr_before = half_bridge_get_ccr();
+    dcdc.control();
+    TEST_ASSERT_EQUAL(1, half_bridge_get_ccr() - ccr_before);
+
+    tim_ccr_step = 0;
+    dcdc.freq_min = freq_min_default;
+    dcdc.freq_max = freq_max_default;
+}
+
+void buck_diode_emulation_at_light_load()
+{
+    start_buck();
+    float threshold = dcdc.diode_emulation_current;
+
+    dcdc.inductor_current = threshold * 0.5F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(true, half_bridge_get_diode_emulation());
+
+    // hysteresis
+    dcdc.inductor_current = threshold * 1.5F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(true, half_bridge_get_diode_emulation());
+
+    dcdc.inductor_current = threshold * 2.5F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(false, half_bridge_get_diode_emulation());
+
+    dcdc.inductor_current = threshold * 1.5F;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(false, half_bridge_get_diode_emulation());
+
+    // negative current (e.g. battery discharging into the solar panel) is prevented
+    dcdc.inductor_current = -threshold;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(true, half_bridge_get_diode_emulation());
+}
+
+void buck_no_diode_emulation_if_disabled()
+{
+    start_buck();
+    dcdc.diode_emulation_current = 0;
+    dcdc.inductor_current = 0;
+    dcdc.control();
+    TEST_ASSERT_EQUAL(false, half_bridge_get_diode_emulation());
+    dcdc.diode_emulation_current = 0.1F;
+}
+
+// simplified loss model of a buck converter at light load (20 V to 14 V, 70 kHz)
+static const float sim_de_vin = 20.0F;
+static const float sim_de_vout = 14.0F;
+static const float sim_de_inductance = 22e-6F;      // H
+static const float sim_de_freq = 70e3F;             // Hz
+static const float sim_de_resistance = 0.03F;       // Ohm, MOSFET + inductor
+static const float sim_de_diode_voltage = 0.7F;     // V, MOSFET body diode
+static const float sim_de_gate_loss = 0.02F;        // W per driven MOSFET
+
+static float sim_diode_emulation_losses(float current, bool diode_emulation)
+{
+    float duty = sim_de_vout / sim_de_vin;
+    float ripple = (sim_de_vin - sim_de_vout) * duty / (sim_de_inductance * sim_de_freq);
+
+    if (!diode_emulation) {
+        // continuous conduction, the ripple current circulates also at zero load
+        return (current * current + ripple * ripple / 12) * sim_de_resistance
+            + 2 * sim_de_gate_loss;
+    }
+    else if (current >= ripple / 2) {
+        // continuous conduction, freewheeling current flows through the body diode
+        return (current * current + ripple * ripple / 12) * sim_de_resistance * duty
+            + sim_de_diode_voltage * current * (1 - duty) + sim_de_gate_loss;
+    }
+    else {
+        // discontinuous conduction: triangular current pulses with idle time in between
+        float peak = sqrtf(2 * current / (sim_de_inductance * sim_de_freq *
+            (1 / (sim_de_vin - sim_de_vout) + 1 / sim_de_vout)));
+        float t_rise = sim_de_inductance * peak / (sim_de_vin - sim_de_vout);
+        float t_fall = sim_de_inductance * peak / sim_de_vout;
+        return sim_de_resistance * peak * peak * t_rise * sim_de_freq / 3
+            + sim_de_diode_voltage * peak / 2 * t_fall * sim_de_freq + sim_de_gate_loss;
+    }
+}
+
+void buck_diode_emulation_efficiency_benchmark()
+{
+    const float current[] = { 0.02, 0.05, 0.1, 0.15, 0.2, 0.5, 1.0 };
+    float threshold = dcdc.diode_emulation_current;
+
+    for (unsigned int i = 0; i < sizeof(current) / sizeof(float); i++) {
+        float power = current[i] * sim_de_vout;
+        float loss_sync = sim_diode_emulation_losses(current[i], false);
+        float loss_de = sim_diode_emulation_losses(current[i], true);
+        printf("Diode emulation at %4.2f A: %5.1f %% efficiency (synchronous: %5.1f %%)\n",
+            current[i], power / (power + loss_de) * 100, power / (power + loss_sync) * 100);
+    }
+
+    // diode emulation must be beneficial below the threshold and synchronous switching above
+    // the upper limit of the hysteresis band
+    TEST_ASSERT_TRUE(sim_diode_emulation_losses(threshold, true) <
+        sim_diode_emulation_losses(threshold, false));
+    TEST_ASSERT_TRUE(sim_diode_emulation_losses(threshold * 2, true) >
+        sim_diode_emulation_losses(threshold * 2, false));
+
+    // energy per day at light load, e.g. during dawn/dusk or with a very small solar panel
+    float energy_sync = 0;
+    float energy_de = 0;
+    bool de = true;
+    for (int t = 0; t < 12 * 60; t++) {
+        float input_current = 0.2F * sinf((float)M_PI * t / (12 * 60));
+        if (input_current < threshold) {
+            de = true;
+        }
+        else if (input_current > threshold * 2) {
+            de = false;
+        }
+        energy_sync += sim_diode_emulation_losses(input_current, false) / 60;
+        energy_de += sim_diode_emulation_losses(input_current, de) / 60;
+    }
+    printf("Diode emulation losses with 0.2 A peak current: %.2f Wh per day "
+        "(synchronous: %.2f Wh)\n", energy_de, energy_sync);
+    TEST_ASSERT_TRUE(energy_de < energy_sync);
+}
+
+#if HALF_BRIDGE_PHASES > 1
+
+void buck_phase_currents_balanced()
+{
+    start_buck();
+
+    // simplified model of two phases with different equivalent resistance
+    const float resistance[2] = { 0.2F, 0.3F };
+    for (int t = 0; t < 300; t++) {
+        dcdc.inductor_current = 0;
+        for (int i = 0; i < 2; i++) {
+            float duty = (float)half_bridge_get_phase_ccr(i) / half_bridge_get_arr();
+            dcdc.phase_current[i] =
+                (hv_terminal.bus->voltage * duty - lv_terminal.bus->voltage) / resistance[i];
+            dcdc.inductor_current += dcdc.phase_current[i];
+        }
+        dcdc.power = dcdc.inductor_current * lv_terminal.bus->voltage;
+        dcdc.control();
+    }
+
+    printf("Phase currents: %.2f A / %.2f A, offsets: %d / %d\n", dcdc.phase_current[0],
+        dcdc.phase_current[1], half_bridge_get_phase_offset(0), half_bridge_get_phase_offset(1));
+    TEST_ASSERT_FLOAT_WITHIN(1.0F, dcdc.phase_current[0], dcdc.phase_current[1]);
+    TEST_ASSERT_TRUE(half_bridge_get_phase_offset(0) < half_bridge_get_phase_offset(1));
+
+    half_bridge_set_phase_offset(0, 0);
+    half_bridge_set_phase_offset(1, 0);
+    dcdc.phase_current[0] = 0;
+    dcdc.phase_current[1] = 0;
+}
+
+#endif /* HALF_BRIDGE_PHASES > 1 */
+
 // boost operation
 
 void boost_increasing_power()
@@ -413,6 +800,347 @@ void boost_correct_mppt_operation()
     TEST_ASSERT(pwm3 > pwm2);
 }
 
+// nanogrid mode
+
+#define NUM_GRID_NODES 3
+
+/*
+ * Simulated nanogrid with the DC/DC under test (node 0) and further nodes with ideal droop
+ * characteristics, a resistive load and an optional constant current source
+ */
+static DcBus grid_nodes[NUM_GRID_NODES];
+static float grid_node_current[NUM_GRID_NODES];    // current supplied to the grid
+static float grid_load_resistance;
+static float grid_source_current;
+
+static const float sim_bat_voltage = 12.8F;
+static const float sim_dcdc_resistance = 0.5F;    // series resistance of simulated converter
+
+// current supplied to the grid by the DC/DC under test for given grid voltage
+static float sim_dcdc_grid_current(float grid_voltage)
+{
+    float inductor_current = (half_bridge_get_duty_cycle() * grid_voltage - sim_bat_voltage) /
+        sim_dcdc_resistance;
+    return -inductor_current * sim_bat_voltage / grid_voltage;
+}
+
+static void init_nanogrid(float droop_res_dcdc)
+{
+    init_structs_buck();
+    dcdc.mode = DCDC_MODE_NANOGRID;
+    dcdc.grid_export_power_max = 200;
+    dcdc.grid_import_power_max = 200;
+
+    lv_terminal.bus->voltage = sim_bat_voltage;
+    lv_terminal.pos_current_limit = 50;
+    lv_terminal.neg_current_limit = -50;
+
+    hv_terminal.init_nanogrid();
+    hv_terminal.pos_current_limit = 20;
+    hv_terminal.neg_current_limit = -20;
+    hv_bus.sink_voltage_intercept = 24;
+    hv_bus.src_voltage_intercept = 24;
+    hv_bus.sink_droop_res = droop_res_dcdc;
+    hv_bus.src_droop_res = droop_res_dcdc;
+
+    for (int i = 1; i < NUM_GRID_NODES; i++) {
+        grid_nodes[i].series_multiplier = 1;
+        grid_nodes[i].sink_voltage_intercept = 24;
+        grid_nodes[i].src_voltage_intercept = 24;
+        grid_nodes[i].sink_droop_res = 0.4F;
+        grid_nodes[i].src_droop_res = 0.4F;
+    }
+    grid_load_resistance = 2.0F;
+    grid_source_current = 0;
+
+    // converter running at zero current
+    half_bridge_init(70, 200, 12 / dcdc.hs_voltage_max, 0.97);
+    half_bridge_set_duty_cycle(sim_bat_voltage / 24);
+    half_bridge_start();
+}
+
+static float sim_grid_voltage_balance(float voltage)
+{
+    float current = grid_source_current + sim_dcdc_grid_current(voltage) -
+        voltage / grid_load_resistance;
+    for (int i = 1; i < NUM_GRID_NODES; i++) {
+        grid_nodes[i].voltage = voltage;
+        current += grid_nodes[i].droop_current();
+    }
+    return current;
+}
+
+static void sim_nanogrid(int cycles)
+{
+    for (int n = 0; n < cycles; n++) {
+        // grid voltage where supplied and consumed current are balanced
+        float v_low = 1;
+        float v_high = 60;
+        for (int k = 0; k < 40; k++) {
+            float v = (v_low + v_high) / 2;
+            if (sim_grid_voltage_balance(v) > 0) {
+                v_low = v;
+            }
+            else {
+                v_high = v;
+            }
+        }
+        hv_bus.voltage = v_low;
+
+        grid_node_current[0] = sim_dcdc_grid_current(v_low);
+        hv_terminal.current = grid_node_current[0];
+        hv_terminal.update_bus_current_margins();
+        dcdc.power = -grid_node_current[0] * v_low;
+        dcdc.inductor_current = dcdc.power / sim_bat_voltage;
+        lv_terminal.current = dcdc.inductor_current;
+        lv_terminal.update_bus_current_margins();
+
+        for (int i = 1; i < NUM_GRID_NODES; i++) {
+            grid_nodes[i].voltage = v_low;
+            grid_node_current[i] = grid_nodes[i].droop_current();
+        }
+
+        dcdc.control();
+        TEST_ASSERT_TRUE(half_bridge_enabled());
+    }
+}
+
+void nanogrid_droop_characteristic()
+{
+    DcBus bus;
+    bus.series_multiplier = 1;
+    bus.sink_voltage_intercept = 24;
+    bus.src_voltage_intercept = 24;
+    bus.sink_droop_res = 0.5;
+    bus.src_droop_res = 0.5;
+
+    bus.voltage = 23;
+    TEST_ASSERT_EQUAL_FLOAT(2.0, bus.droop_current());
+    bus.voltage = 25;
+    TEST_ASSERT_EQUAL_FLOAT(-2.0, bus.droop_current());
+
+    // no power exchange in the deadband between both intercepts
+    bus.sink_voltage_intercept = 23.5;
+    bus.src_voltage_intercept = 24.5;
+    bus.voltage = 24;
+    TEST_ASSERT_EQUAL_FLOAT(0.0, bus.droop_current());
+}
+
+void nanogrid_power_sharing_multiple_nodes()
+{
+    init_nanogrid(0.2F);
+    sim_nanogrid(300);
+
+    // node with half the droop resistance provides twice the current
+    float v_expected = 24.0F * 10.0F / (10.0F + 1.0F / grid_load_resistance);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, v_expected, hv_bus.voltage);
+    TEST_ASSERT_FLOAT_WITHIN(0.1 * grid_node_current[1], 2 * grid_node_current[1],
+        grid_node_current[0]);
+    TEST_ASSERT_EQUAL(DCDC_CONTROL_CV_HS, dcdc.state);
+}
+
+void nanogrid_seamless_power_flow_reversal()
+{
+    init_nanogrid(0.2F);
+    sim_nanogrid(300);
+    TEST_ASSERT_TRUE(grid_node_current[0] > 1.0F);
+
+    // strong source (e.g. solar) connected to the grid: battery is charged instead
+    grid_source_current = 25;
+    sim_nanogrid(300);
+    TEST_ASSERT_TRUE(grid_node_current[0] < -1.0F);
+    TEST_ASSERT_TRUE(hv_bus.voltage > hv_bus.src_voltage_intercept);
+    TEST_ASSERT_NOT_EQUAL(DCDC_CONTROL_OFF, dcdc.state);
+
+    // reversal through zero current requires synchronous switching
+    TEST_ASSERT_EQUAL(false, half_bridge_get_diode_emulation());
+}
+
+void nanogrid_import_power_limited()
+{
+    init_nanogrid(0.2F);
+    dcdc.grid_import_power_max = 50;
+    grid_source_current = 40;
+    sim_nanogrid(300);
+    TEST_ASSERT_FLOAT_WITHIN(0.3, -50 / hv_bus.voltage, grid_node_current[0]);
+    TEST_ASSERT_EQUAL(DCDC_CONTROL_CC_HS, dcdc.state);
+}
+
+void nanogrid_fixed_restart_interval()
+{
+    init_nanogrid(0.2F);
+    half_bridge_stop();
+    hv_bus.voltage = 22;      // grid not yet started up
+    hv_terminal.update_bus_current_margins();
+    lv_terminal.update_bus_current_margins();
+
+    // restart policy would already allow a start, but grid voltage is no indicator for power
+    dcdc.off_timestamp = time(NULL) - dcdc.restart.interval_min;
+    TEST_ASSERT_EQUAL(DCDC_MODE_OFF, dcdc.check_start_conditions());
+
+    dcdc.off_timestamp = time(NULL) - dcdc.restart_interval;
+    TEST_ASSERT_TRUE(dcdc.check_start_conditions() != DCDC_MODE_OFF);
+}
+
+void nanogrid_no_export_if_battery_discharge_not_allowed()
+{
+    init_nanogrid(0.2F);
+    lv_terminal.neg_current_limit = 0;
+    sim_nanogrid(300);
+    TEST_ASSERT_FLOAT_WITHIN(0.3, 0, grid_node_current[0]);
+    TEST_ASSERT_EQUAL(DCDC_CONTROL_CC_LS, dcdc.state);
+}
+
+/*
+ * Auto mode with the DC/DC boosting into a grid with other nodes until a strong source (e.g.
+ * solar) raises the grid voltage above the buck mode start point
+ */
+static void init_auto_mode_reversal()
+{
+    init_nanogrid(0);
+    dcdc.mode = DCDC_MODE_AUTO;
+    dcdc.active_mode = DCDC_MODE_BOOST;
+    hv_terminal.init_nanogrid();
+    hv_terminal.pos_current_limit = 20;
+    hv_terminal.neg_current_limit = -20;
+    hv_bus.sink_droop_res = 0;
+    hv_bus.src_droop_res = 0;
+
+    for (int i = 1; i < NUM_GRID_NODES; i++) {
+        grid_nodes[i].sink_droop_res = 2.0F;
+        grid_nodes[i].src_droop_res = 2.0F;
+    }
+    grid_load_resistance = 10.0F;
+
+    sim_nanogrid(600);
+    TEST_ASSERT_TRUE(grid_node_current[0] > 1.0F);
+}
+
+// number of control cycles until power flows in buck direction, -1 if not reached
+static int sim_auto_mode_reversal(int max_cycles, float *power_buck)
+{
+    for (int n = 0; n < max_cycles; n++) {
+        sim_nanogrid(1);
+        if (dcdc.active_mode == DCDC_MODE_BUCK && dcdc.power > 0) {
+            *power_buck = dcdc.power;
+            return n + 1;
+        }
+    }
+    return -1;
+}
+
+void auto_mode_seamless_reversal_boost_to_buck()
+{
+    float power_buck;
+    init_auto_mode_reversal();
+
+    grid_source_current = 15;
+    int cycles = sim_auto_mode_reversal(100, &power_buck);
+    TEST_ASSERT_TRUE(cycles > 0);
+    TEST_ASSERT_FALSE(dcdc.reversing);
+
+    // normal control continues in buck mode without restart of the half bridge
+    sim_nanogrid(600);
+    TEST_ASSERT_TRUE(grid_node_current[0] < -1.0F);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, hv_bus.src_control_voltage(), hv_bus.voltage);
+}
+
+void auto_mode_seamless_reversal_buck_to_boost()
+{
+    init_auto_mode_reversal();
+    grid_source_current = 15;
+    sim_nanogrid(600);
+    TEST_ASSERT_EQUAL(DCDC_MODE_BUCK, dcdc.active_mode);
+
+    grid_source_current = 0;
+    int n = 0;
+    while (n < 100 && (dcdc.active_mode != DCDC_MODE_BOOST || dcdc.power > 0)) {
+        sim_nanogrid(1);
+        n++;
+    }
+    TEST_ASSERT_TRUE(n < 100);
+    TEST_ASSERT_FALSE(dcdc.reversing);
+}
+
+/*
+ * Auto mode charging a battery with internal resistance from a stiff DC bus, so that the
+ * charger holds the battery voltage at the CV target while discharging into the bus would
+ * also be allowed
+ */
+void auto_mode_no_reversal_in_cv_at_threshold()
+{
+    const float hv_voltage = 24.0F;
+    const float bat_ocv = 14.2F;
+    const float bat_resistance = 0.05F;
+
+    init_auto_mode_reversal();
+    dcdc.active_mode = DCDC_MODE_BUCK;
+    hv_bus.voltage = hv_voltage;
+    hv_bus.sink_voltage_intercept = 30;
+    hv_bus.src_voltage_intercept = 20;
+    half_bridge_set_duty_cycle(bat_ocv / hv_voltage);
+
+    int reversals = 0;
+    for (int n = 0; n < 600; n++) {
+        float current = (half_bridge_get_duty_cycle() * hv_voltage - bat_ocv) /
+            (sim_dcdc_resistance + bat_resistance);
+        lv_bus.voltage = bat_ocv + current * bat_resistance;
+        lv_terminal.current = current;
+        lv_terminal.update_bus_current_margins();
+        dcdc.inductor_current = current;
+        dcdc.power = current * lv_bus.voltage;
+        hv_terminal.current = -dcdc.power / hv_voltage;
+        hv_terminal.update_bus_current_margins();
+
+        bool reversing = dcdc.reversing;
+        dcdc.control();
+        if (!reversing && dcdc.reversing) {
+            reversals++;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, reversals);
+    TEST_ASSERT_EQUAL(DCDC_MODE_BUCK, dcdc.active_mode);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, lv_bus.sink_control_voltage(), lv_bus.voltage);
+}
+
+void auto_mode_reversal_benchmark()
+{
+    static float power[600];
+    init_auto_mode_reversal();
+    float power_boost = dcdc.power;
+
+    grid_source_current = 15;
+    int cycles = -1;
+    for (int n = 0; n < 600; n++) {
+        sim_nanogrid(1);
+        power[n] = dcdc.power;
+        if (cycles < 0 && dcdc.active_mode == DCDC_MODE_BUCK && dcdc.power > 0) {
+            cycles = n + 1;
+        }
+    }
+    TEST_ASSERT_TRUE(cycles > 0);
+
+    // energy not transferred compared to an immediate step change of the power flow
+    float power_settled = power[599];
+    float energy_lost = 0;
+    for (int n = 0; n < 600; n++) {
+        energy_lost += (power_settled - power[n]) / CONFIG_CONTROL_FREQUENCY / 3600;
+    }
+    float time_reversal = (float)cycles / CONFIG_CONTROL_FREQUENCY;
+
+    // previous behaviour: stop at low power and wait for restart interval before starting again
+    float energy_lost_restart = (power_settled - power_boost) * dcdc.restart_interval / 3600;
+
+    printf("Power flow reversal from %.1f W to %.1f W: %.1f s, %.2f Wh lost "
+        "(%.2f Wh with restart)\n", power_boost, power_settled, time_reversal,
+        energy_lost, energy_lost_restart);
+
+    TEST_ASSERT_TRUE(time_reversal < 1.5F);
+    TEST_ASSERT_TRUE(energy_lost < 0.35F);
+    TEST_ASSERT_TRUE(energy_lost < 0.1F * energy_lost_restart);
+}
+
 void dcdc_tests()
 {
     UNITY_BEGIN();
@@ -426,6 +1154,9 @@ void dcdc_tests()
     RUN_TEST(start_valid_mppt_boost_dual_battery);
 
     RUN_TEST(no_start_before_restart_delay);
+    RUN_TEST(no_start_before_backoff_interval);
+    RUN_TEST(early_start_if_solar_voltage_rising);
+    RUN_TEST(auto_mode_restart_uses_voltage_of_start_direction);
     RUN_TEST(no_start_if_dcdc_disabled);
     RUN_TEST(no_start_if_dcdc_lv_voltage_low);
 
@@ -460,6 +1191,20 @@ void dcdc_tests()
     RUN_TEST(buck_stop_input_power_too_low);
     RUN_TEST(buck_stop_high_voltage_emergency);
     RUN_TEST(buck_correct_mppt_operation);
+    RUN_TEST(buck_burst_mode_at_low_power);
+    RUN_TEST(buck_no_stop_below_min_power_in_burst_mode);
+    RUN_TEST(buck_stop_at_low_power_without_burst_after_start);
+    RUN_TEST(buck_burst_mode_efficiency_benchmark);
+    RUN_TEST(buck_frequency_adjusted_to_load);
+    RUN_TEST(buck_deadtime_changed_during_operation);
+    RUN_TEST(buck_pwm_step_independent_of_timer_resolution);
+    RUN_TEST(buck_pwm_step_fixed_for_system_clock_timers);
+    RUN_TEST(buck_diode_emulation_at_light_load);
+    RUN_TEST(buck_no_diode_emulation_if_disabled);
+    RUN_TEST(buck_diode_emulation_efficiency_benchmark);
+#if HALF_BRIDGE_PHASES > 1
+    RUN_TEST(buck_phase_currents_balanced);
+#endif
 
     // boost mode
     RUN_TEST(boost_increasing_power);
@@ -472,5 +1217,19 @@ void dcdc_tests()
     RUN_TEST(boost_stop_high_voltage_emergency);
     RUN_TEST(boost_correct_mppt_operation);
 
+    // nanogrid mode
+    RUN_TEST(nanogrid_droop_characteristic);
+    RUN_TEST(nanogrid_power_sharing_multiple_nodes);
+    RUN_TEST(nanogrid_seamless_power_flow_reversal);
+    RUN_TEST(nanogrid_import_power_limited);
+    RUN_TEST(nanogrid_no_export_if_battery_discharge_not_allowed);
+    RUN_TEST(nanogrid_fixed_restart_interval);
+
+    // auto mode
+    RUN_TEST(auto_mode_seamless_reversal_boost_to_buck);
+    RUN_TEST(auto_mode_seamless_reversal_buck_to_boost);
+    RUN_TEST(auto_mode_no_reversal_in_cv_at_threshold);
+    RUN_TEST(auto_mode_reversal_benchmark);
+
     UNITY_END();
 }
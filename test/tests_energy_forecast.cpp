@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include "energy_forecast.h"
+
+#define CAPACITY_WH         1200.0F     // 100 Ah 12V battery
+#define NIGHT_DURATION      (12 * 3600)
+#define NIGHT_POWER         10.0F       // W
+
+static EnergyForecast forecast;
+
+/*
+ * Simulates the given time with constant discharge power and SOC
+ */
+static void run(uint32_t *night_time, int seconds, float power, uint16_t soc, bool night)
+{
+    for (int i = 0; i < seconds; i++) {
+        *night_time = night ? *night_time + 1 : 0;
+        forecast.update(*night_time, power, soc, CAPACITY_WH);
+    }
+}
+
+/*
+ * Simulates one day (solar charging) and one full night with constant load power
+ */
+static void run_day_and_night(float night_power)
+{
+    uint32_t night_time = 0;
+    run(&night_time, 12 * 3600, -50, 90, false);
+    run(&night_time, NIGHT_DURATION, night_power, 90, true);
+    run(&night_time, 1, -50, 90, false);
+}
+
+void forecast_learns_night_consumption()
+{
+    forecast = EnergyForecast();
+
+    run_day_and_night(NIGHT_POWER);
+    TEST_ASSERT_EQUAL(NIGHT_DURATION, forecast.night_duration);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, NIGHT_POWER * 12, forecast.night_energy);
+
+    // averaged with following night
+    run_day_and_night(NIGHT_POWER * 2);
+    TEST_ASSERT_FLOAT_WITHIN(0.5, NIGHT_POWER * 12 * 1.3F, forecast.night_energy);
+}
+
+void forecast_time_to_empty()
+{
+    forecast = EnergyForecast();
+    uint32_t night_time = 0;
+
+    TEST_ASSERT_EQUAL(0, forecast.time_to_empty);
+
+    // no discharging
+    run(&night_time, 10, 0, 50, false);
+    TEST_ASSERT_EQUAL(UINT32_MAX, forecast.time_to_empty);
+
+    // wait for power filter to settle
+    run(&night_time, 3 * 3600, NIGHT_POWER, 50, false);
+    TEST_ASSERT_FLOAT_WITHIN(1, (50 - 20) / 100.0F * CAPACITY_WH, forecast.energy_usable);
+    TEST_ASSERT_INT_WITHIN(360, 36 * 3600, forecast.time_to_empty);
+}
+
+void forecast_no_reduction_if_battery_lasts_until_sunrise()
+{
+    forecast = EnergyForecast();
+    run_day_and_night(NIGHT_POWER);
+
+    uint32_t night_time = 0;
+    run(&night_time, 3600, NIGHT_POWER, 40, true);
+    TEST_ASSERT_EQUAL(NIGHT_DURATION - 3600, forecast.time_to_sunrise);
+    TEST_ASSERT_FLOAT_WITHIN(1, NIGHT_POWER * 11, forecast.energy_required);
+    TEST_ASSERT_FALSE(forecast.reduce_loads);
+}
+
+void forecast_reduction_if_battery_empty_before_sunrise()
+{
+    forecast = EnergyForecast();
+    run_day_and_night(NIGHT_POWER);
+
+    // only 1% = 12 Wh usable
+    uint32_t night_time = 0;
+    run(&night_time, 3600, NIGHT_POWER, 21, true);
+    TEST_ASSERT_TRUE(forecast.reduce_loads);
+
+    // battery still not sufficient after critical loads only consume 2 W
+    run(&night_time, 3600, 2, 21, true);
+    TEST_ASSERT_TRUE(forecast.reduce_loads);
+
+    // loads not switched on again before sunrise, even if just enough energy is available
+    run(&night_time, 60, 2, 29, true);
+    TEST_ASSERT_TRUE(forecast.reduce_loads);
+
+    // sufficient energy incl. hysteresis
+    run(&night_time, 60, 2, 40, true);
+    TEST_ASSERT_FALSE(forecast.reduce_loads);
+}
+
+void forecast_no_reduction_during_day()
+{
+    forecast = EnergyForecast();
+    run_day_and_night(NIGHT_POWER);
+
+    uint32_t night_time = 0;
+    run(&night_time, 3600, 100, 21, false);
+    TEST_ASSERT_EQUAL(0, forecast.time_to_sunrise);
+    TEST_ASSERT_FALSE(forecast.reduce_loads);
+}
+
+void forecast_higher_trend_than_learned_consumption()
+{
+    forecast = EnergyForecast();
+    run_day_and_night(NIGHT_POWER);
+
+    // today's loads consume 5 times more than usual
+    uint32_t night_time = 0;
+    run(&night_time, 3 * 3600, NIGHT_POWER * 5, 40, true);
+    TEST_ASSERT_TRUE(forecast.energy_required > NIGHT_POWER * 9 * 4);
+    TEST_ASSERT_TRUE(forecast.reduce_loads);
+}
+
+void energy_forecast_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(forecast_learns_night_consumption);
+    RUN_TEST(forecast_time_to_empty);
+    RUN_TEST(forecast_no_reduction_if_battery_lasts_until_sunrise);
+    RUN_TEST(forecast_reduction_if_battery_empty_before_sunrise);
+    RUN_TEST(forecast_no_reduction_during_day);
+    RUN_TEST(forecast_higher_trend_than_learned_consumption);
+
+    UNITY_END();
+}
@@ -5,6 +5,7 @@
  */
 
 #include "tests.h"
+#include "board.h"
 #include "half_bridge.h"
 
 #include <time.h>
@@ -20,6 +21,8 @@
 const float duty_epsilon = 0.006;
 // calculated duty cycle float may deviate +/- duty_epsilon from test target value
 
+extern bool pwm_enabled;    // dummy register of the half bridge driver for unit tests
+
 static void init_structs()
 {
     half_bridge_init(PWM_F_KHZ, PWM_DEADTIME_NS, MIN_PWM_DUTY, MAX_PWM_DUTY);
@@ -71,6 +74,143 @@ void half_bridge_ccr_limits_not_violated()
     TEST_ASSERT_FLOAT_WITHIN(duty_epsilon, MIN_PWM_DUTY, half_bridge_get_duty_cycle());
 }
 
+void half_bridge_burst_mode_switches_outputs()
+{
+    half_bridge_set_duty_cycle(MID_PWM_DUTY);
+    half_bridge_start();
+    half_bridge_set_burst_duty(0.3);
+
+    int ticks_on = 0;
+    for (int i = 0; i < 100; i++) {
+        half_bridge_burst_tick();
+        ticks_on += pwm_enabled ? 1 : 0;
+        TEST_ASSERT_EQUAL(true, half_bridge_enabled());
+    }
+    TEST_ASSERT_EQUAL(30, ticks_on);
+
+    // continuous switching again
+    half_bridge_set_burst_duty(1.0);
+    TEST_ASSERT_EQUAL(true, pwm_enabled);
+    half_bridge_burst_tick();
+    TEST_ASSERT_EQUAL(true, pwm_enabled);
+    half_bridge_stop();
+}
+
+void half_bridge_burst_duty_limits_not_violated()
+{
+    half_bridge_set_burst_duty(0.0);
+    TEST_ASSERT_EQUAL_FLOAT(0.1, half_bridge_get_burst_duty());
+    half_bridge_set_burst_duty(1.5);
+    TEST_ASSERT_EQUAL_FLOAT(1.0, half_bridge_get_burst_duty());
+}
+
+void half_bridge_no_burst_after_stop()
+{
+    half_bridge_set_duty_cycle(MID_PWM_DUTY);
+    half_bridge_start();
+    half_bridge_set_burst_duty(0.5);
+    half_bridge_stop();
+
+    for (int i = 0; i < 10; i++) {
+        half_bridge_burst_tick();
+        TEST_ASSERT_EQUAL(false, pwm_enabled);
+    }
+    TEST_ASSERT_EQUAL(false, half_bridge_enabled());
+    half_bridge_set_burst_duty(1.0);
+}
+
+void half_bridge_frequency_change_keeps_duty_cycle()
+{
+    half_bridge_set_duty_cycle(MID_PWM_DUTY);
+    TEST_ASSERT_TRUE(half_bridge_set_frequency(PWM_F_KHZ / 2));
+    TEST_ASSERT_EQUAL(PWM_F_KHZ / 2, half_bridge_get_frequency());
+    TEST_ASSERT_EQUAL(24000000 / (PWM_F_KHZ / 2 * 1000), half_bridge_get_arr());
+    TEST_ASSERT_FLOAT_WITHIN(duty_epsilon, MID_PWM_DUTY, half_bridge_get_duty_cycle());
+
+    // limits scaled with new period
+    half_bridge_set_duty_cycle(1.0);
+    TEST_ASSERT_FLOAT_WITHIN(duty_epsilon, MAX_PWM_DUTY, half_bridge_get_duty_cycle());
+    half_bridge_set_duty_cycle(0.0);
+    TEST_ASSERT_FLOAT_WITHIN(duty_epsilon, MIN_PWM_DUTY, half_bridge_get_duty_cycle());
+
+    TEST_ASSERT_TRUE(half_bridge_set_frequency(PWM_F_KHZ));
+    TEST_ASSERT_EQUAL(24000000 / (PWM_F_KHZ * 1000), half_bridge_get_arr());
+}
+
+void half_bridge_invalid_frequency_rejected()
+{
+    TEST_ASSERT_FALSE(half_bridge_set_frequency(0));
+    TEST_ASSERT_FALSE(half_bridge_set_frequency(300));     // resolution too low
+    TEST_ASSERT_EQUAL(PWM_F_KHZ, half_bridge_get_frequency());
+}
+
+void half_bridge_deadtime_change()
+{
+    // 24 MHz timer clock: 41.7 ns resolution
+    TEST_ASSERT_TRUE(half_bridge_set_deadtime(500));
+    TEST_ASSERT_EQUAL(500, half_bridge_get_deadtime());
+    TEST_ASSERT_TRUE(half_bridge_set_deadtime(PWM_DEADTIME_NS));
+    TEST_ASSERT_EQUAL(291, half_bridge_get_deadtime());
+
+    TEST_ASSERT_FALSE(half_bridge_set_deadtime(-1));
+    TEST_ASSERT_FALSE(half_bridge_set_deadtime(10000));
+    TEST_ASSERT_EQUAL(291, half_bridge_get_deadtime());
+}
+
+void half_bridge_phases_use_common_duty_cycle()
+{
+    TEST_ASSERT_EQUAL(HALF_BRIDGE_PHASES, half_bridge_get_phases());
+    half_bridge_set_duty_cycle(MID_PWM_DUTY);
+    for (int i = 0; i < half_bridge_get_phases(); i++) {
+        TEST_ASSERT_EQUAL(half_bridge_get_ccr(), half_bridge_get_phase_ccr(i));
+    }
+}
+
+void half_bridge_phase_offset_limits_not_violated()
+{
+    half_bridge_set_duty_cycle(MAX_PWM_DUTY);
+    half_bridge_set_phase_offset(0, 10);
+    TEST_ASSERT_FLOAT_WITHIN(duty_epsilon, MAX_PWM_DUTY,
+        (float)half_bridge_get_phase_ccr(0) / half_bridge_get_arr());
+
+    half_bridge_set_duty_cycle(MIN_PWM_DUTY);
+    half_bridge_set_phase_offset(0, -10);
+    TEST_ASSERT_FLOAT_WITHIN(duty_epsilon, MIN_PWM_DUTY,
+        (float)half_bridge_get_phase_ccr(0) / half_bridge_get_arr());
+
+    half_bridge_set_phase_offset(0, 0);
+}
+
+#if HALF_BRIDGE_PHASES > 1
+
+void half_bridge_phase_offset_applied()
+{
+    half_bridge_set_duty_cycle(MID_PWM_DUTY);
+    uint16_t ccr = half_bridge_get_ccr();
+    half_bridge_set_phase_offset(1, 5);
+    TEST_ASSERT_EQUAL(ccr, half_bridge_get_phase_ccr(0));
+    TEST_ASSERT_EQUAL(ccr + 5, half_bridge_get_phase_ccr(1));
+
+    // offset kept for changes of the common duty cycle
+    half_bridge_set_ccr(ccr + 1);
+    TEST_ASSERT_EQUAL(ccr + 6, half_bridge_get_phase_ccr(1));
+
+    half_bridge_set_phase_offset(1, 0);
+}
+
+void half_bridge_phase_offset_scaled_with_frequency()
+{
+    half_bridge_set_duty_cycle(MID_PWM_DUTY);
+    half_bridge_set_phase_offset(1, 10);
+    half_bridge_set_frequency(PWM_F_KHZ / 2);
+    TEST_ASSERT_INT_WITHIN(1, 20, half_bridge_get_phase_offset(1));
+
+    half_bridge_set_frequency(PWM_F_KHZ);
+    half_bridge_set_phase_offset(1, 0);
+}
+
+#endif /* HALF_BRIDGE_PHASES > 1 */
+
 void half_bridge_tests()
 {
     init_structs();
@@ -84,5 +224,20 @@ void half_bridge_tests()
     RUN_TEST(half_bridge_duty_limits_not_violated);
     RUN_TEST(half_bridge_ccr_limits_not_violated);
 
+    RUN_TEST(half_bridge_burst_mode_switches_outputs);
+    RUN_TEST(half_bridge_burst_duty_limits_not_violated);
+    RUN_TEST(half_bridge_no_burst_after_stop);
+
+    RUN_TEST(half_bridge_frequency_change_keeps_duty_cycle);
+    RUN_TEST(half_bridge_invalid_frequency_rejected);
+    RUN_TEST(half_bridge_deadtime_change);
+
+    RUN_TEST(half_bridge_phases_use_common_duty_cycle);
+    RUN_TEST(half_bridge_phase_offset_limits_not_violated);
+#if HALF_BRIDGE_PHASES > 1
+    RUN_TEST(half_bridge_phase_offset_applied);
+    RUN_TEST(half_bridge_phase_offset_scaled_with_frequency);
+#endif
+
     UNITY_END();
 }
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "i2t_fuse.h"
+
+#define CURRENT_NOM     20.0F
+#define TRIP_TIME_2X    0.1F                // s
+#define I2T_LIMIT       (3 * CURRENT_NOM * CURRENT_NOM * TRIP_TIME_2X)
+#define SAMPLE_TIME     0.001F              // 1 kHz ADC sampling
+
+struct TripTimeEntry
+{
+    float current;          // multiple of nominal current
+    int trip_time_ms;       // expected trip time (rounded up to the next sample)
+};
+
+/*
+ * Trip-time table for I²t = 3 * I_nom² * 100 ms
+ */
+static const TripTimeEntry trip_table[] = {
+    { 1.2F, 682 },
+    { 1.5F, 240 },
+    { 2.0F, 100 },
+    { 3.0F, 38 },
+    { 5.0F, 13 },
+    { 10.0F, 4 },
+    { 20.0F, 1 },
+};
+
+/*
+ * Number of samples until the fuse trips (or 0 if it did not trip within max_samples)
+ */
+static int samples_until_trip(I2tFuse *fuse, float current, int max_samples)
+{
+    for (int i = 1; i <= max_samples; i++) {
+        if (fuse->update(current)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void i2t_trip_times_match_table()
+{
+    for (unsigned int i = 0; i < sizeof(trip_table) / sizeof(trip_table[0]); i++) {
+        I2tFuse fuse(CURRENT_NOM, I2T_LIMIT, SAMPLE_TIME);
+        float current = trip_table[i].current * CURRENT_NOM;
+
+        TEST_ASSERT_EQUAL(trip_table[i].trip_time_ms,
+            (int)ceilf(fuse.trip_time(current) * 1000 - 0.001F));
+
+        // accumulated float rounding may shift the trip by one sample
+        int samples = samples_until_trip(&fuse, current, 10000);
+        TEST_ASSERT_INT_WITHIN(1, trip_table[i].trip_time_ms, samples);
+    }
+}
+
+void i2t_no_trip_at_nominal_current()
+{
+    I2tFuse fuse(CURRENT_NOM, I2T_LIMIT, SAMPLE_TIME);
+
+    TEST_ASSERT_TRUE(fuse.trip_time(CURRENT_NOM) < 0);
+
+    // one hour
+    TEST_ASSERT_EQUAL(0, samples_until_trip(&fuse, CURRENT_NOM, 3600 * 1000));
+    TEST_ASSERT_EQUAL_FLOAT(0, fuse.level());
+}
+
+void i2t_short_pulses_below_average_nominal_do_not_trip()
+{
+    I2tFuse fuse(CURRENT_NOM, I2T_LIMIT, SAMPLE_TIME);
+
+    // 10 ms pulses of 3x nominal current every 100 ms: rms current below nominal
+    for (int i = 0; i < 100 * 1000; i++) {
+        float current = (i % 100 < 10) ? 3 * CURRENT_NOM : 0;
+        TEST_ASSERT_FALSE(fuse.update(current));
+    }
+}
+
+void i2t_cool_down_after_overcurrent()
+{
+    I2tFuse fuse(CURRENT_NOM, I2T_LIMIT, SAMPLE_TIME);
+
+    // half of the trip time at 2x nominal current
+    samples_until_trip(&fuse, 2 * CURRENT_NOM, 50);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 0.5, fuse.level());
+
+    // completely cooled down after I²t / I_nom² without current
+    samples_until_trip(&fuse, 0, I2T_LIMIT / (CURRENT_NOM * CURRENT_NOM) / SAMPLE_TIME / 2);
+    TEST_ASSERT_FLOAT_WITHIN(0.02, 0.0, fuse.level());
+
+    TEST_ASSERT_INT_WITHIN(1, 100, samples_until_trip(&fuse, 2 * CURRENT_NOM, 10000));
+}
+
+void i2t_trips_again_if_overcurrent_persists()
+{
+    I2tFuse fuse(CURRENT_NOM, I2T_LIMIT, SAMPLE_TIME);
+
+    samples_until_trip(&fuse, 3 * CURRENT_NOM, 10000);
+    TEST_ASSERT_TRUE(fuse.update(3 * CURRENT_NOM));
+
+    fuse.reset();
+    TEST_ASSERT_FALSE(fuse.update(3 * CURRENT_NOM));
+}
+
+void i2t_fuse_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(i2t_trip_times_match_table);
+    RUN_TEST(i2t_no_trip_at_nominal_current);
+    RUN_TEST(i2t_short_pulses_below_average_nominal_do_not_trip);
+    RUN_TEST(i2t_cool_down_after_overcurrent);
+    RUN_TEST(i2t_trips_again_if_overcurrent_persists);
+
+    UNITY_END();
+}
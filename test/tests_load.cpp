@@ -149,6 +149,33 @@ void control_on_to_off_overcurrent()
     TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
 }
 
+void control_on_to_off_i2t_fuse()
+{
+    DcBus bus = {};
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL);
+    load_init(&load_out, true);
+
+    // short peak of 5x nominal current, fuse trips after 12.5 ms
+    float current = DT_PROP(DT_CHILD(DT_PATH(outputs), load), current_max) * 5;
+    for (int i = 0; i < 10; i++) {
+        load_out.fast_control(current);
+    }
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, load_out.state);
+
+    for (int i = 0; i < 10; i++) {
+        load_out.fast_control(current);
+    }
+    TEST_ASSERT_EQUAL(ERR_LOAD_OVERCURRENT, load_out.error_flags);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
+    TEST_ASSERT_EQUAL(false, output_on);
+
+    // fuse cools down while load is off
+    for (int i = 0; i < 1000; i++) {
+        load_out.fast_control(0);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(0, load_out.fuse.level());
+}
+
 void control_on_to_off_voltage_dip()
 {
     DcBus bus = {};
@@ -288,6 +315,203 @@ void control_off_short_circuit_flag_reset()
     TEST_ASSERT_EQUAL(LOAD_STATE_ON, load_out.state);
 }
 
+/*
+ * Simple model of a capacitive load (e.g. inverter input capacitors) connected to a battery with
+ * internal and wiring resistance
+ */
+struct CapacitiveLoadSim
+{
+    float v_bat = 12.8;         // battery open circuit voltage
+    float r_src = 0.2;          // resistance of battery, wiring and load switch
+    float capacitance = 10e-3;
+    float r_load = 10;          // resistive part of the load
+    float v_cap = 0;
+    int uv_debounce = 0;
+};
+
+#define SIM_UNDERVOLTAGE_LIMIT  11.0F
+
+/*
+ * Simulates 1 ms (one ADC sample) with the current switch state, feeds the load current into
+ * fast_control and emulates the undervoltage ADC alert
+ */
+static void capacitive_load_step(LoadOutput *l, CapacitiveLoadSim *sim)
+{
+    const int steps = 100;
+    const float dt = 1e-3 / steps;
+    float i_src = 0;
+
+    for (int k = 0; k < steps; k++) {
+        i_src = output_on ? (sim->v_bat - sim->v_cap) / sim->r_src : 0;
+        sim->v_cap += (i_src - sim->v_cap / sim->r_load) * dt / sim->capacitance;
+    }
+    float v_bus = sim->v_bat - i_src * sim->r_src;
+
+    // control() only sees the low-pass filtered voltage (same filter constant as in DAQ)
+    l->bus->voltage += (v_bus - l->bus->voltage) / 32;
+
+    // same debouncing as ADC alerts in daq.cpp
+    if (v_bus < SIM_UNDERVOLTAGE_LIMIT) {
+        sim->uv_debounce++;
+        if (sim->uv_debounce > 1) {
+            l->voltage_dip();
+        }
+    }
+    else {
+        sim->uv_debounce = 0;
+    }
+
+    l->fast_control(i_src);
+}
+
+/*
+ * Runs fast_control at 1 kHz and control at CONFIG_CONTROL_FREQUENCY for the given time
+ */
+static void capacitive_load_run(LoadOutput *l, CapacitiveLoadSim *sim, int duration_ms)
+{
+    for (int t = 0; t < duration_ms; t++) {
+        capacitive_load_step(l, sim);
+        if (t % (1000 / CONFIG_CONTROL_FREQUENCY) == 0) {
+            l->control();
+        }
+    }
+}
+
+void control_off_to_soft_start()
+{
+    DcBus bus = {};
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 50);
+    load_init(&load_out);
+
+    load_out.control();
+    TEST_ASSERT_EQUAL(LOAD_STATE_SOFT_START, load_out.state);
+    TEST_ASSERT_EQUAL(false, output_on);
+
+    // first pulse
+    load_out.fast_control(0);
+    TEST_ASSERT_EQUAL(true, output_on);
+    load_out.fast_control(0);
+    TEST_ASSERT_EQUAL(false, output_on);
+}
+
+void capacitive_load_dip_without_soft_start()
+{
+    DcBus bus = {};
+    CapacitiveLoadSim sim;
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 0);
+    load_init(&load_out);
+    bus.voltage = sim.v_bat;
+
+    load_out.control();
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, load_out.state);
+
+    capacitive_load_run(&load_out, &sim, 100);
+    TEST_ASSERT_EQUAL(ERR_LOAD_VOLTAGE_DIP, load_out.error_flags);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
+}
+
+void capacitive_load_soft_start_without_dip()
+{
+    DcBus bus = {};
+    CapacitiveLoadSim sim;
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 50);
+    load_init(&load_out);
+    bus.voltage = sim.v_bat;
+
+    load_out.control();
+    capacitive_load_run(&load_out, &sim, 1000);
+    TEST_ASSERT_EQUAL(0, load_out.error_flags);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, load_out.state);
+    TEST_ASSERT_EQUAL(true, output_on);
+
+    // ramp may have been held because of voltage dips, but must not time out
+    TEST_ASSERT_TRUE(load_out.inrush_duration >= 50);
+    TEST_ASSERT_TRUE(load_out.inrush_duration < 50 * 4);
+    TEST_ASSERT_TRUE(load_out.inrush_current_peak > 0);
+    TEST_ASSERT_TRUE(load_out.inrush_current_peak < sim.v_bat / sim.r_src);
+}
+
+void capacitive_load_soft_start_short_circuit_timeout()
+{
+    DcBus bus = {};
+    CapacitiveLoadSim sim;
+    sim.r_load = 0.01;
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 50);
+    load_init(&load_out);
+    bus.voltage = sim.v_bat;
+
+    // the short circuit pulls down the simulated bus voltage, which would trigger the LVD
+    // before the soft-start timeout
+    load_out.disconnect_voltage = 0.1F;
+
+    load_out.control();
+    capacitive_load_run(&load_out, &sim, 1000);
+    TEST_ASSERT_TRUE(load_out.error_flags != 0);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
+    TEST_ASSERT_EQUAL(false, output_on);
+    TEST_ASSERT_EQUAL(50 * 4 + 1, load_out.inrush_duration);
+}
+
+void soft_start_to_off_if_enable_false()
+{
+    DcBus bus = {};
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 50);
+    load_init(&load_out);
+
+    load_out.control();
+    load_out.fast_control(0);
+    TEST_ASSERT_EQUAL(true, output_on);
+
+    load_out.enable = false;
+    load_out.control();
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
+    TEST_ASSERT_EQUAL(false, output_on);
+
+    // no further switching by fast_control
+    load_out.fast_control(0);
+    TEST_ASSERT_EQUAL(false, output_on);
+}
+
+void soft_start_to_off_if_low_voltage()
+{
+    DcBus bus = {};
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 50);
+    load_init(&load_out);
+
+    load_out.control();
+    load_out.fast_control(0);
+    TEST_ASSERT_EQUAL(LOAD_STATE_SOFT_START, load_out.state);
+
+    bus.voltage = bus.src_control_voltage(load_out.disconnect_voltage) - 0.1F;
+    load_out.control();
+    TEST_ASSERT_EQUAL(ERR_LOAD_SHEDDING, load_out.error_flags);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
+    TEST_ASSERT_EQUAL(false, output_on);
+}
+
+void soft_start_to_off_if_overvoltage()
+{
+    DcBus bus = {};
+    LoadOutput load_out(&bus, &load_drv_set, &load_drv_init, NULL, 50);
+    load_init(&load_out);
+
+    load_out.control();
+    load_out.fast_control(0);
+    TEST_ASSERT_EQUAL(LOAD_STATE_SOFT_START, load_out.state);
+
+    // overvoltage is debounced for 1s like in on state
+    bus.voltage = load_out.overvoltage + 0.1F;
+    for (int i = 0; i < CONFIG_CONTROL_FREQUENCY; i++) {
+        load_out.control();
+    }
+    TEST_ASSERT_EQUAL(LOAD_STATE_SOFT_START, load_out.state);
+
+    load_out.control();
+    TEST_ASSERT_EQUAL(ERR_LOAD_OVERVOLTAGE, load_out.error_flags);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, load_out.state);
+    TEST_ASSERT_EQUAL(false, output_on);
+}
+
 void load_tests()
 {
     UNITY_BEGIN();
@@ -299,6 +523,7 @@ void load_tests()
     RUN_TEST(control_on_to_off_overvoltage);
     RUN_TEST(control_on_to_off_overvoltage_dual_battery);
     RUN_TEST(control_on_to_off_overcurrent);
+    RUN_TEST(control_on_to_off_i2t_fuse);
     RUN_TEST(control_on_to_off_voltage_dip);
     RUN_TEST(control_on_to_off_bus_limit);
     RUN_TEST(control_on_to_off_if_enable_false);
@@ -309,6 +534,15 @@ void load_tests()
     RUN_TEST(control_off_overvoltage_to_on_at_lower_voltage_dual_battery);
     RUN_TEST(control_off_short_circuit_flag_reset);
 
+    // soft-start tests
+    RUN_TEST(control_off_to_soft_start);
+    RUN_TEST(capacitive_load_dip_without_soft_start);
+    RUN_TEST(capacitive_load_soft_start_without_dip);
+    RUN_TEST(capacitive_load_soft_start_short_circuit_timeout);
+    RUN_TEST(soft_start_to_off_if_enable_false);
+    RUN_TEST(soft_start_to_off_if_low_voltage);
+    RUN_TEST(soft_start_to_off_if_overvoltage);
+
     // ToDo: What to do if port current is above the limit, but the hardware can still handle it?
 
     UNITY_END();
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include <time.h>
+
+#include "load.h"
+#include "load_manager.h"
+#include "helper.h"
+
+static bool critical_on;
+static bool noncritical_on;
+
+static void critical_set(bool status) { critical_on = status; }
+static void noncritical_set(bool status) { noncritical_on = status; }
+static void drv_init() {}
+
+static DcBus bus;
+static LoadOutput *critical;
+static LoadOutput *noncritical;
+static LoadChannel channels[2];
+static LoadManager *manager;
+
+static void bus_init()
+{
+    bus = {};
+    bus.series_multiplier = 1;
+    bus.voltage = 13;
+    bus.sink_voltage_intercept = 14.4;
+    bus.src_voltage_intercept = 12;
+    bus.sink_current_margin = 10;
+    bus.src_current_margin = -10;
+}
+
+static void output_init(LoadOutput *l)
+{
+    l->set_voltage_limits(11.5, 12.5, 14.6);
+    l->lvd_timestamp = 0;
+    l->lvd_recovery_delay = -1;     // reconnect as soon as voltage is above threshold
+    l->junction_temperature = 25;
+
+    l->control();
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, l->state);
+}
+
+/*
+ * Channel 0: critical load with low SOC thresholds
+ * Channel 1: non-critical load with high SOC thresholds
+ */
+static void manager_init()
+{
+    static LoadOutput critical_out(&bus, &critical_set, &drv_init, NULL);
+    static LoadOutput noncritical_out(&bus, &noncritical_set, &drv_init, NULL);
+    static LoadManager load_manager(channels, 2);
+
+    bus_init();
+
+    critical = &critical_out;
+    noncritical = &noncritical_out;
+    *critical = LoadOutput(&bus, &critical_set, &drv_init, NULL);
+    *noncritical = LoadOutput(&bus, &noncritical_set, &drv_init, NULL);
+
+    channels[0] = { critical, 0, 20, 30, 0, 0, false };
+    channels[1] = { noncritical, 1, 50, 60, 0, 0, false };
+
+    load_manager = LoadManager(channels, 2);
+    load_manager.reconnect_stagger = 10;
+    manager = &load_manager;
+
+    output_init(critical);
+    output_init(noncritical);
+}
+
+/*
+ * Simulates the 1 s main loop and the 10 Hz control loop
+ */
+static void run(int seconds, uint16_t soc)
+{
+    for (int s = 0; s < seconds; s++) {
+        manager->update(soc);
+        for (int i = 0; i < CONFIG_CONTROL_FREQUENCY; i++) {
+            critical->control();
+            noncritical->control();
+        }
+    }
+}
+
+void shedding_by_soc_in_priority_order()
+{
+    manager_init();
+
+    run(1, 45);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, critical->state);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+    TEST_ASSERT_EQUAL(ERR_LOAD_SHEDDING, noncritical->error_flags);
+    TEST_ASSERT_EQUAL(false, noncritical_on);
+
+    run(1, 15);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, critical->state);
+    TEST_ASSERT_EQUAL(ERR_LOAD_SHEDDING, critical->error_flags);
+    TEST_ASSERT_EQUAL(false, critical_on);
+}
+
+void shedding_by_soc_with_hysteresis()
+{
+    manager_init();
+
+    run(1, 45);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    // above disconnect, but below reconnect threshold
+    run(60, 55);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    run(1, 60);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, noncritical->state);
+    TEST_ASSERT_EQUAL(0, noncritical->error_flags);
+}
+
+void reconnect_staggered_by_priority()
+{
+    manager_init();
+
+    run(1, 10);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, critical->state);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    // wait longer than stagger delay
+    run(20, 10);
+
+    // critical load first
+    run(1, 80);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, critical->state);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    run(10, 80);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    run(1, 80);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, noncritical->state);
+    TEST_ASSERT_EQUAL(0, noncritical->error_flags);
+}
+
+void reconnect_staggered_after_lvd()
+{
+    manager_init();
+
+    // both outputs disconnected by their own LVD
+    bus.voltage = 11;
+    run(1, 100);
+    TEST_ASSERT_EQUAL(ERR_LOAD_SHEDDING, critical->error_flags);
+    TEST_ASSERT_EQUAL(ERR_LOAD_SHEDDING, noncritical->error_flags);
+
+    // manager takes over: critical output released first, the other one held back
+    run(1, 100);
+    TEST_ASSERT_EQUAL(false, critical->shed);
+    TEST_ASSERT_EQUAL(true, noncritical->shed);
+
+    // voltage recovered, but reconnect must not happen simultaneously
+    bus.voltage = 13;
+    run(2, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, critical->state);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    run(5, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    run(10, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, noncritical->state);
+}
+
+void shedding_by_time_of_day()
+{
+    manager_init();
+
+    // non-critical load off from 23:00 to 05:00
+    channels[1].off_start = 23 * 60;
+    channels[1].off_end = 5 * 60;
+
+    // no shedding as long as time is unknown
+    run(1, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, noncritical->state);
+
+    manager->time_of_day = 23 * 3600 - 1;
+    run(1, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, critical->state);
+
+    // time wraps around midnight
+    run(3600, 100);
+    TEST_ASSERT_EQUAL(0, manager->time_of_day);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    manager->time_of_day = 5 * 3600 - 1;
+    run(1, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, noncritical->state);
+}
+
+void shedding_by_priority_limit()
+{
+    manager_init();
+
+    // e.g. requested by energy forecast
+    manager->priority_limit = 0;
+    run(1, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, critical->state);
+    TEST_ASSERT_EQUAL(LOAD_STATE_OFF, noncritical->state);
+
+    manager->priority_limit = UINT16_MAX;
+    run(1, 100);
+    TEST_ASSERT_EQUAL(LOAD_STATE_ON, noncritical->state);
+}
+
+void load_manager_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(shedding_by_soc_in_priority_order);
+    RUN_TEST(shedding_by_soc_with_hysteresis);
+    RUN_TEST(reconnect_staggered_by_priority);
+    RUN_TEST(reconnect_staggered_after_lvd);
+    RUN_TEST(shedding_by_time_of_day);
+    RUN_TEST(shedding_by_priority_limit);
+
+    UNITY_END();
+}
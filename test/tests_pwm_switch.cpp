@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include <math.h>
+
+#include "pwm_switch.h"
+#include "device_status.h"
+
+extern DeviceStatus dev_stat;
+
+#define SIM_STEPS_PER_MS 10     // PWM signal resolution of the simulation
+
+static DcBus bus;
+static PwmSwitch *pwm;
+
+/*
+ * Simplified model of a 12V solar panel charging a battery via the PWM switch
+ *
+ * The battery is modelled by its open circuit voltage, the internal resistance and one RC
+ * element for polarization effects. Measurements are filtered like in the ADC driver.
+ */
+struct PvBatterySim
+{
+    float pv_isc = 8.0F;            ///< Short circuit current of the panel (A)
+    float pv_voc = 21.6F;           ///< Open circuit voltage of the panel (V)
+    float pv_vt = 1.5F;             ///< Slope of the panel current near Voc (V)
+    float bat_ocv = 13.0F;          ///< Battery open circuit voltage (V)
+    float bat_r = 0.05F;            ///< Battery internal resistance (Ohm)
+    float bat_rp = 0.1F;            ///< Battery polarization resistance (Ohm)
+    float bat_tau = 5.0F;           ///< Battery polarization time constant (s)
+
+    float bat_vp;                   ///< Voltage across polarization RC element
+    float bat_voltage;
+    float voltage_filtered;         ///< Bus voltage as seen by the ADC
+    float current_filtered;         ///< On-phase switch current as seen by the ADC
+    float voltage_max;              ///< Maximum measured bus voltage
+    uint32_t time_ms;
+};
+
+static PvBatterySim sim;
+
+static void sim_init(float bat_ocv)
+{
+    sim = {};
+    sim.bat_ocv = bat_ocv;
+    sim.bat_voltage = bat_ocv;
+    sim.voltage_filtered = bat_ocv;
+
+    bus = {};
+    bus.series_multiplier = 1;
+    bus.voltage = bat_ocv;
+    bus.sink_voltage_intercept = 14.4;
+    bus.sink_current_margin = 10;
+
+    static PwmSwitch pwm_switch_sim(&bus);
+    pwm = &pwm_switch_sim;
+    pwm->stop();
+    pwm->off_timestamp = -10000;
+    pwm->neg_current_limit = -20;
+    pwm->ext_voltage = sim.pv_voc;
+
+    dev_stat.clear_error(ERR_PWM_SWITCH_OVERVOLTAGE);
+}
+
+static void sim_run(int duration_ms)
+{
+    int period_steps = SIM_STEPS_PER_MS * 1000 / pwm->frequency;
+
+    for (int ms = 0; ms < duration_ms; ms++) {
+        bool on = false;
+        float pv_current = 0;
+        for (int i = 0; i < SIM_STEPS_PER_MS; i++) {
+            int phase = (sim.time_ms * SIM_STEPS_PER_MS + i) % period_steps;
+            on = pwm->active() && phase < pwm->get_duty_cycle() * period_steps;
+            pv_current = on ?
+                sim.pv_isc * (1.0F - expf((sim.bat_voltage - sim.pv_voc) / sim.pv_vt)) : 0;
+            sim.bat_vp += (sim.bat_rp * pv_current - sim.bat_vp) /
+                (sim.bat_tau * 1000 * SIM_STEPS_PER_MS);
+            sim.bat_voltage = sim.bat_ocv + sim.bat_vp + sim.bat_r * pv_current;
+        }
+
+        // ADC samples with 1 kHz and filter constant 5, switch current only during on-phase
+        sim.voltage_filtered += (sim.bat_voltage - sim.voltage_filtered) / 32;
+        if (on) {
+            sim.current_filtered += (pv_current - sim.current_filtered) / 32;
+        }
+        if (sim.voltage_filtered > sim.voltage_max) {
+            sim.voltage_max = sim.voltage_filtered;
+        }
+
+        sim.time_ms++;
+        if (sim.time_ms % (1000 / CONFIG_CONTROL_FREQUENCY) == 0) {
+            bus.voltage = sim.voltage_filtered;
+            pwm->ext_voltage = pwm->active() ? sim.bat_voltage : sim.pv_voc;
+            pwm->current = pwm->active() ? -pwm->get_duty_cycle() * sim.current_filtered : 0;
+            pwm->control();
+        }
+    }
+}
+
+void pwm_voltage_regulated_without_overshoot()
+{
+    // battery almost full: full solar current would result in 14.6V
+    sim_init(13.4);
+    sim_run(30000);
+
+    TEST_ASSERT_TRUE(pwm->active());
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 14.4, sim.voltage_filtered);
+    TEST_ASSERT_TRUE(sim.voltage_max < 14.4 + 0.2);
+    TEST_ASSERT_TRUE(pwm->get_duty_cycle() > 0.5 && pwm->get_duty_cycle() < 0.95);
+    TEST_ASSERT_FALSE(dev_stat.has_error(ERR_PWM_SWITCH_OVERVOLTAGE));
+
+    pwm->stop();
+}
+
+void pwm_full_duty_if_voltage_below_target()
+{
+    sim_init(12.5);
+    sim_run(5000);
+
+    TEST_ASSERT_TRUE(pwm->active());
+    TEST_ASSERT_EQUAL_FLOAT(1.0, pwm->get_duty_cycle());
+    TEST_ASSERT_FLOAT_WITHIN(0.1, -8.0, pwm->current);
+
+    pwm->stop();
+}
+
+void pwm_current_limited()
+{
+    sim_init(12.5);
+    pwm->neg_current_limit = -4;
+    sim_run(10000);
+
+    TEST_ASSERT_TRUE(pwm->active());
+    TEST_ASSERT_FLOAT_WITHIN(0.2, -4.0, pwm->current);
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 0.5, pwm->get_duty_cycle());
+
+    pwm->stop();
+}
+
+void pwm_stops_if_no_further_derating_possible()
+{
+    sim_init(14.0);
+    sim_run(1000);
+    TEST_ASSERT_TRUE(pwm->active());
+
+    // battery voltage rises above target even without charging current
+    sim.bat_ocv = 14.6;
+    sim_run(10000);
+
+    TEST_ASSERT_FALSE(pwm->active());
+    TEST_ASSERT_TRUE(dev_stat.has_error(ERR_PWM_SWITCH_OVERVOLTAGE));
+
+    dev_stat.clear_error(ERR_PWM_SWITCH_OVERVOLTAGE);
+}
+
+void pwm_switch_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(pwm_voltage_regulated_without_overshoot);
+    RUN_TEST(pwm_full_duty_if_voltage_below_target);
+    RUN_TEST(pwm_current_limited);
+    RUN_TEST(pwm_stops_if_no_further_derating_possible);
+
+    UNITY_END();
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "restart_policy.h"
+
+#define INTERVAL_MAX 60
+
+static RestartPolicy restart;
+
+static void fail_start(float voltage)
+{
+    restart.started(voltage);
+    restart.stopped();
+}
+
+void restart_after_min_interval()
+{
+    restart = RestartPolicy();
+    TEST_ASSERT_FALSE(restart.allowed(restart.interval_min - 1, 20, INTERVAL_MAX));
+    TEST_ASSERT_TRUE(restart.allowed(restart.interval_min, 20, INTERVAL_MAX));
+}
+
+void restart_backoff_doubled_after_failed_start()
+{
+    restart = RestartPolicy();
+    fail_start(20);
+    fail_start(20);
+    TEST_ASSERT_EQUAL(2, restart.failed_starts);
+    TEST_ASSERT_FALSE(restart.allowed(4 * restart.interval_min - 1, 21, INTERVAL_MAX));
+    TEST_ASSERT_TRUE(restart.allowed(4 * restart.interval_min, 21, INTERVAL_MAX));
+
+    // backoff limited by maximum interval
+    for (int i = 0; i < 20; i++) {
+        fail_start(20);
+    }
+    TEST_ASSERT_FALSE(restart.allowed(INTERVAL_MAX - 1, 25, INTERVAL_MAX));
+    TEST_ASSERT_TRUE(restart.allowed(INTERVAL_MAX, 25, INTERVAL_MAX));
+}
+
+void restart_backoff_reset_after_successful_start()
+{
+    restart = RestartPolicy();
+    fail_start(20);
+    fail_start(20);
+    restart.started(21);
+    restart.power_good();
+    restart.stopped();
+    TEST_ASSERT_EQUAL(0, restart.failed_starts);
+    TEST_ASSERT_TRUE(restart.allowed(restart.interval_min, 21, INTERVAL_MAX));
+}
+
+void restart_early_if_voltage_rising()
+{
+    restart = RestartPolicy();
+    for (int i = 0; i < 3; i++) {
+        fail_start(15);
+    }
+    TEST_ASSERT_FALSE(restart.allowed(restart.interval_min, 18, INTERVAL_MAX));
+    TEST_ASSERT_FALSE(restart.allowed(restart.interval_min + 1, 18.2, INTERVAL_MAX));
+    TEST_ASSERT_TRUE(restart.allowed(restart.interval_min + 2, 18.6, INTERVAL_MAX));
+}
+
+void restart_learned_start_voltage()
+{
+    restart = RestartPolicy();
+    fail_start(18);
+    TEST_ASSERT_TRUE(restart.voltage_start > 18);
+
+    // no restart below learned voltage before maximum interval
+    TEST_ASSERT_FALSE(restart.allowed(INTERVAL_MAX - 1, 18, INTERVAL_MAX));
+    TEST_ASSERT_TRUE(restart.allowed(INTERVAL_MAX, 18, INTERVAL_MAX));
+
+    // successful start at lower voltage decreases learned voltage again
+    restart.started(17);
+    restart.power_good();
+    restart.stopped();
+    TEST_ASSERT_EQUAL_FLOAT(17, restart.voltage_start);
+}
+
+/*
+ * Simulated day with a 100 W solar panel and dark clouds passing by around noon
+ */
+static float sim_irradiance(int t)
+{
+    const int sunrise = 6 * 3600;
+    const int sunset = 18 * 3600;
+
+    if (t < sunrise || t > sunset) {
+        return 0;
+    }
+
+    float irr = 1000.0F * sinf((float)M_PI * (t - sunrise) / (sunset - sunrise));
+    if (t > 9 * 3600 && t < 16 * 3600 && t % 600 < 120) {
+        irr *= 0.005F;
+    }
+    return irr;
+}
+
+typedef struct {
+    float energy;       // Wh
+    int starts;
+} SimDayResult;
+
+static SimDayResult sim_day(bool adaptive)
+{
+    const float power_min = 1.0F;
+    const float voltage_start = 14.8F;      // battery voltage + offset
+    SimDayResult res = {};
+    bool on = false;
+    int off_timestamp = -10000;
+    int power_good_timestamp = 0;
+
+    restart = RestartPolicy();
+
+    for (int t = 0; t < 24 * 3600; t++) {
+        float irr = sim_irradiance(t);
+        float power = 0.1F * irr;
+        float voc = (irr > 0.1F) ? 22.0F + 0.9F * logf(irr / 1000.0F) : 0;
+
+        if (on) {
+            if (power >= power_min) {
+                power_good_timestamp = t;
+                restart.power_good();
+            }
+            if (t - power_good_timestamp > 10) {
+                on = false;
+                off_timestamp = t;
+                restart.stopped();
+            }
+            else {
+                res.energy += power / 3600;
+            }
+        }
+        else if (voc > voltage_start) {
+            bool start = adaptive ?
+                restart.allowed(t - off_timestamp, voc, INTERVAL_MAX) :
+                (t - off_timestamp >= INTERVAL_MAX);
+            if (start) {
+                on = true;
+                power_good_timestamp = t;
+                restart.started(voc);
+                res.starts++;
+            }
+        }
+    }
+    return res;
+}
+
+void restart_energy_recovered_per_day()
+{
+    SimDayResult fixed = sim_day(false);
+    SimDayResult adaptive = sim_day(true);
+
+    printf("Simulated day: %.1f Wh with %d starts (fixed %ds interval), "
+        "%.1f Wh with %d starts (adaptive), %.1f Wh recovered\n",
+        fixed.energy, fixed.starts, INTERVAL_MAX, adaptive.energy, adaptive.starts,
+        adaptive.energy - fixed.energy);
+
+    TEST_ASSERT_TRUE(adaptive.energy > fixed.energy);
+
+    // no chattering
+    TEST_ASSERT_TRUE(adaptive.starts < 2 * fixed.starts);
+}
+
+void restart_policy_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(restart_after_min_interval);
+    RUN_TEST(restart_backoff_doubled_after_failed_start);
+    RUN_TEST(restart_backoff_reset_after_successful_start);
+    RUN_TEST(restart_early_if_voltage_rising);
+    RUN_TEST(restart_learned_start_voltage);
+    RUN_TEST(restart_energy_recovered_per_day);
+
+    UNITY_END();
+}
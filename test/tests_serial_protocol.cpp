@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) The Libre Solar Project Contributors
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "tests.h"
+
+#include "data_nodes.h"
+#include "pub_template.h"
+#include "serial_protocol.h"
+#include "setup.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Fake UART: bytes written by the device are stored in a FIFO and can be fed to the receiver
+ * of the other side byte by byte (like the UART interrupt does).
+ */
+static uint8_t uart_fifo[1024];
+static size_t uart_fifo_len;
+
+static void fake_uart_putc(uint8_t c)
+{
+    if (uart_fifo_len < sizeof(uart_fifo)) {
+        uart_fifo[uart_fifo_len++] = c;
+    }
+}
+
+static void fake_uart_puts(const char *str)
+{
+    while (*str != '\0') {
+        fake_uart_putc(*str++);
+    }
+}
+
+static void fake_uart_clear()
+{
+    uart_fifo_len = 0;
+}
+
+/**
+ * Feed all bytes in the FIFO to the receiver until a request is complete
+ *
+ * @returns Number of bytes consumed
+ */
+static size_t fake_uart_receive(SerialReceiver *rx, size_t start = 0)
+{
+    size_t i;
+    for (i = start; i < uart_fifo_len && !rx->available(); i++) {
+        rx->put(uart_fifo[i]);
+    }
+    return i;
+}
+
+// all node types supported in binary mode
+static bool rt_bool = true;
+static uint16_t rt_uint16 = 0xC0DB;             // contains both SLIP special characters
+static int16_t rt_int16 = -300;
+static uint32_t rt_uint32 = 0xDBC0C0DB;
+static int32_t rt_int32 = -70000;
+static float rt_float = -6.0F;                  // 0xC0C00000
+static float rt_float_int = 1234.4F;
+static char rt_string[] = "Libre Solar";
+
+static DataNode rt_nodes[] = {
+    TS_NODE_PATH(0x70, "output", 0, NULL),
+    TS_NODE_BOOL(0x71, "Bool", &rt_bool, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_UINT16(0x72, "Uint16", &rt_uint16, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_INT16(0x73, "Int16", &rt_int16, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_UINT32(0x74, "Uint32", &rt_uint32, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_INT32(0x75, "Int32", &rt_int32, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_FLOAT(0x76, "Float", &rt_float, 2, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_FLOAT(0xC0, "FloatRounded", &rt_float_int, 0, 0x70, TS_ANY_R, PUB_SER),
+    TS_NODE_STRING(0xDB, "String", rt_string, 0, 0x70, TS_ANY_R, PUB_SER),
+};
+
+#define RT_NUM_NODES (sizeof(rt_nodes)/sizeof(DataNode))
+
+static PubTemplateEntry rt_entries[16];
+
+static const DataNode *rt_get_node(uint32_t id)
+{
+    for (size_t i = 0; i < RT_NUM_NODES; i++) {
+        if (rt_nodes[i].id == id) {
+            return &rt_nodes[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Minimal CBOR decoder for the data items generated by the publication templates
+ */
+static size_t cbor_decode_head(const uint8_t *buf, uint8_t *major, uint32_t *value)
+{
+    *major = buf[0] & 0xE0;
+    uint8_t info = buf[0] & 0x1F;
+    if (info < 24) {
+        *value = info;
+        return 1;
+    }
+    else if (info == 24) {
+        *value = buf[1];
+        return 2;
+    }
+    else if (info == 25) {
+        *value = buf[1] << 8 | buf[2];
+        return 3;
+    }
+    else {
+        *value = (uint32_t)buf[1] << 24 | buf[2] << 16 | buf[3] << 8 | buf[4];
+        return 5;
+    }
+}
+
+static size_t cbor_decode_int(const uint8_t *buf, int64_t *value)
+{
+    uint8_t major;
+    uint32_t raw;
+    size_t len = cbor_decode_head(buf, &major, &raw);
+    *value = (major == 0x20) ? -1 - (int64_t)raw : raw;
+    return len;
+}
+
+static size_t cbor_decode_float(const uint8_t *buf, float *value)
+{
+    uint32_t raw = (uint32_t)buf[1] << 24 | buf[2] << 16 | buf[3] << 8 | buf[4];
+    memcpy(value, &raw, sizeof(raw));
+    return 5;
+}
+
+void slip_escapes_special_characters()
+{
+    const uint8_t data[] = { 0x01, SLIP_END, 0x02, SLIP_ESC, 0x03 };
+    const uint8_t expected[] = {
+        SLIP_END, 0x01, SLIP_ESC, SLIP_ESC_END, 0x02, SLIP_ESC, SLIP_ESC_ESC, 0x03, SLIP_END
+    };
+
+    fake_uart_clear();
+    slip_write(data, sizeof(data), fake_uart_putc);
+
+    TEST_ASSERT_EQUAL(sizeof(expected), uart_fifo_len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, uart_fifo, sizeof(expected));
+}
+
+void text_request_received()
+{
+    uint8_t buf[20];
+    SerialReceiver rx(buf, sizeof(buf));
+
+    fake_uart_clear();
+    fake_uart_puts("?infx\bo\r\n");
+    fake_uart_receive(&rx);
+
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_FALSE(rx.binary());
+    TEST_ASSERT_EQUAL(5, rx.length());
+    TEST_ASSERT_EQUAL_STRING("?info", (char *)buf);
+
+    // no further bytes accepted before reset
+    TEST_ASSERT_TRUE(rx.put('x'));
+    TEST_ASSERT_EQUAL_STRING("?info", (char *)buf);
+
+    rx.reset();
+    TEST_ASSERT_FALSE(rx.available());
+}
+
+void text_request_truncated_to_buffer_size()
+{
+    uint8_t buf[8];
+    SerialReceiver rx(buf, sizeof(buf));
+
+    fake_uart_clear();
+    fake_uart_puts("?0123456789\n");
+    fake_uart_receive(&rx);
+
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_EQUAL_STRING("?012345", (char *)buf);
+}
+
+void binary_request_received()
+{
+    uint8_t buf[20];
+    SerialReceiver rx(buf, sizeof(buf));
+    const uint8_t req[] = { 0x01, 0x18, 0xC0, 0xDB };     // GET with escaped bytes
+
+    fake_uart_clear();
+    slip_write(req, sizeof(req), fake_uart_putc);
+    fake_uart_receive(&rx);
+
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_TRUE(rx.binary());
+    TEST_ASSERT_EQUAL(sizeof(req), rx.length());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(req, buf, sizeof(req));
+
+    // mode is kept after reset for publication messages, until a text request is received
+    rx.reset();
+    TEST_ASSERT_TRUE(rx.binary());
+    fake_uart_clear();
+    fake_uart_puts("?info\n");
+    fake_uart_receive(&rx);
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_FALSE(rx.binary());
+}
+
+void binary_requests_back_to_back()
+{
+    uint8_t buf[20];
+    SerialReceiver rx(buf, sizeof(buf));
+    const uint8_t req1[] = { 0x01, 0x70 };
+    const uint8_t req2[] = { 0x01, 0xA0 };
+
+    fake_uart_clear();
+    slip_write(req1, sizeof(req1), fake_uart_putc);
+    slip_write(req2, sizeof(req2), fake_uart_putc);
+
+    size_t pos = fake_uart_receive(&rx);
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(req1, buf, sizeof(req1));
+
+    rx.reset();
+    fake_uart_receive(&rx, pos);
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_EQUAL(sizeof(req2), rx.length());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(req2, buf, sizeof(req2));
+}
+
+void binary_request_too_long_dropped()
+{
+    uint8_t buf[4];
+    SerialReceiver rx(buf, sizeof(buf));
+    const uint8_t req_long[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+    const uint8_t req[] = { 0x01, 0x02 };
+
+    fake_uart_clear();
+    slip_write(req_long, sizeof(req_long), fake_uart_putc);
+    slip_write(req, sizeof(req), fake_uart_putc);
+    fake_uart_receive(&rx);
+
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_EQUAL(sizeof(req), rx.length());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(req, buf, sizeof(req));
+}
+
+void binary_publication_round_trip_all_types()
+{
+    PubTemplate tmpl(rt_entries, 16);
+    uint8_t msg[200];
+    uint8_t rx_buf[200];
+    SerialReceiver rx(rx_buf, sizeof(rx_buf));
+
+    TEST_ASSERT_TRUE(tmpl.build(rt_nodes, RT_NUM_NODES, PUB_SER));
+
+    int len = tmpl.bin_pub(msg, sizeof(msg));
+    TEST_ASSERT_TRUE(len > 0);
+
+    fake_uart_clear();
+    slip_write(msg, len, fake_uart_putc);
+    fake_uart_receive(&rx);
+
+    TEST_ASSERT_TRUE(rx.available());
+    TEST_ASSERT_TRUE(rx.binary());
+    TEST_ASSERT_EQUAL(len, rx.length());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(msg, rx_buf, len);
+
+    // decode received message and compare with data node values
+    const uint8_t *pos = rx_buf;
+    TEST_ASSERT_EQUAL_HEX8(PUB_TEMPLATE_BIN_PUBMSG, *pos++);
+
+    uint8_t major;
+    uint32_t num;
+    pos += cbor_decode_head(pos, &major, &num);
+    TEST_ASSERT_EQUAL_HEX8(0xA0, major);
+    TEST_ASSERT_EQUAL(tmpl.size(), num);
+
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t id;
+        pos += cbor_decode_head(pos, &major, &id);
+        const DataNode *node = rt_get_node(id);
+        TEST_ASSERT_NOT_NULL(node);
+
+        int64_t int_value;
+        float float_value;
+        switch (node->type) {
+            case TS_T_BOOL:
+                TEST_ASSERT_EQUAL(*((bool *)node->data) ? 0xF5 : 0xF4, *pos++);
+                break;
+            case TS_T_UINT16:
+                pos += cbor_decode_int(pos, &int_value);
+                TEST_ASSERT_TRUE(*((uint16_t *)node->data) == int_value);
+                break;
+            case TS_T_INT16:
+                pos += cbor_decode_int(pos, &int_value);
+                TEST_ASSERT_TRUE(*((int16_t *)node->data) == int_value);
+                break;
+            case TS_T_UINT32:
+                pos += cbor_decode_int(pos, &int_value);
+                TEST_ASSERT_TRUE(*((uint32_t *)node->data) == int_value);
+                break;
+            case TS_T_INT32:
+                pos += cbor_decode_int(pos, &int_value);
+                TEST_ASSERT_TRUE(*((int32_t *)node->data) == int_value);
+                break;
+            case TS_T_FLOAT32:
+                if (node->detail == 0) {
+                    pos += cbor_decode_int(pos, &int_value);
+                    TEST_ASSERT_TRUE(lroundf(*((float *)node->data)) == int_value);
+                }
+                else {
+                    TEST_ASSERT_EQUAL_HEX8(0xFA, *pos);
+                    pos += cbor_decode_float(pos, &float_value);
+                    TEST_ASSERT_EQUAL_FLOAT(*((float *)node->data), float_value);
+                }
+                break;
+            case TS_T_STRING:
+                uint32_t str_len;
+                pos += cbor_decode_head(pos, &major, &str_len);
+                TEST_ASSERT_EQUAL_HEX8(0x60, major);
+                TEST_ASSERT_EQUAL(strlen((char *)node->data), str_len);
+                TEST_ASSERT_EQUAL(0, memcmp(node->data, pos, str_len));
+                pos += str_len;
+                break;
+            default:
+                TEST_ASSERT_TRUE(false);
+        }
+    }
+    TEST_ASSERT_EQUAL(len, pos - rx_buf);
+}
+
+void binary_publication_smaller_than_text()
+{
+    static PubTemplateEntry entries[32];
+    PubTemplate tmpl(entries, 32);
+    static char txt[1024];
+    static uint8_t bin[1024];
+
+    TEST_ASSERT_TRUE(tmpl.build(data_nodes, num_data_nodes, PUB_SER));
+
+    int txt_len = tmpl.txt_pub(txt, sizeof(txt));
+    int bin_len = tmpl.bin_pub(bin, sizeof(bin));
+
+    // SLIP framing adds 2 bytes and the escaped characters
+    fake_uart_clear();
+    slip_write(bin, bin_len, fake_uart_putc);
+
+    printf("Serial publication with %u nodes: %d bytes binary (text: %d bytes)\n",
+        (unsigned)tmpl.size(), (int)uart_fifo_len, txt_len + 1);
+
+    TEST_ASSERT_TRUE(uart_fifo_len * 2 < (size_t)txt_len);
+}
+
+void serial_protocol_tests()
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(slip_escapes_special_characters);
+    RUN_TEST(text_request_received);
+    RUN_TEST(text_request_truncated_to_buffer_size);
+    RUN_TEST(binary_request_received);
+    RUN_TEST(binary_requests_back_to_back);
+    RUN_TEST(binary_request_too_long_dropped);
+    RUN_TEST(binary_publication_round_trip_all_types);
+    RUN_TEST(binary_publication_smaller_than_text);
+
+    UNITY_END();
+}
@@ -43,6 +43,12 @@
 #define LOG_MODULE_REGISTER(a, b)
 
 
+/* from irq.h (no interrupts in unit tests) */
+
+#define irq_lock() 0
+#define irq_unlock(key) ((void)(key))
+
+
 /* from gpio.h */
 
 typedef uint8_t gpio_pin_t;